@@ -0,0 +1,677 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  AVRCycleAnalyzer.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#include "AVRCycleAnalyzer.h"
+#include "AVRDisassembler.h"
+#include "AVRElfFile.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+enum EFlow
+{
+	eFlowNext,
+	eFlowBranch,		// +1 cycle when taken
+	eFlowSkip,			// +1 cycle per word skipped
+	eFlowJump,
+	eFlowCall,
+	eFlowReturn,
+	eFlowIndirectJump,
+	eFlowIndirectCall,
+	eFlowInvalid
+};
+
+struct STiming
+{
+	const char*	mnemonic;
+	uint8_t		flow;
+	uint8_t		cycles[eNumAVRCores];	// With a 16 bit PC
+	uint8_t		pcCycles;	// Added with a 22 bit PC (3 byte PC push or pop)
+};
+
+/*
+*	Sorted by mnemonic.  "ld-" and "st-" are the pre-decrement forms of ld
+*	and st.
+*/
+static const STiming	kTimings[] =
+{
+	{".word", eFlowInvalid, {1, 1, 1}, 0},
+	{"adc", eFlowNext, {1, 1, 1}, 0},
+	{"add", eFlowNext, {1, 1, 1}, 0},
+	{"adiw", eFlowNext, {2, 2, 2}, 0},
+	{"and", eFlowNext, {1, 1, 1}, 0},
+	{"andi", eFlowNext, {1, 1, 1}, 0},
+	{"asr", eFlowNext, {1, 1, 1}, 0},
+	{"bld", eFlowNext, {1, 1, 1}, 0},
+	{"brcc", eFlowBranch, {1, 1, 1}, 0},
+	{"brcs", eFlowBranch, {1, 1, 1}, 0},
+	{"break", eFlowNext, {1, 1, 1}, 0},
+	{"breq", eFlowBranch, {1, 1, 1}, 0},
+	{"brge", eFlowBranch, {1, 1, 1}, 0},
+	{"brhc", eFlowBranch, {1, 1, 1}, 0},
+	{"brhs", eFlowBranch, {1, 1, 1}, 0},
+	{"brid", eFlowBranch, {1, 1, 1}, 0},
+	{"brie", eFlowBranch, {1, 1, 1}, 0},
+	{"brlt", eFlowBranch, {1, 1, 1}, 0},
+	{"brmi", eFlowBranch, {1, 1, 1}, 0},
+	{"brne", eFlowBranch, {1, 1, 1}, 0},
+	{"brpl", eFlowBranch, {1, 1, 1}, 0},
+	{"brtc", eFlowBranch, {1, 1, 1}, 0},
+	{"brts", eFlowBranch, {1, 1, 1}, 0},
+	{"brvc", eFlowBranch, {1, 1, 1}, 0},
+	{"brvs", eFlowBranch, {1, 1, 1}, 0},
+	{"bst", eFlowNext, {1, 1, 1}, 0},
+	{"call", eFlowCall, {4, 4, 3}, 1},
+	{"cbi", eFlowNext, {2, 2, 1}, 0},
+	{"clc", eFlowNext, {1, 1, 1}, 0},
+	{"clh", eFlowNext, {1, 1, 1}, 0},
+	{"cli", eFlowNext, {1, 1, 1}, 0},
+	{"cln", eFlowNext, {1, 1, 1}, 0},
+	{"cls", eFlowNext, {1, 1, 1}, 0},
+	{"clt", eFlowNext, {1, 1, 1}, 0},
+	{"clv", eFlowNext, {1, 1, 1}, 0},
+	{"clz", eFlowNext, {1, 1, 1}, 0},
+	{"com", eFlowNext, {1, 1, 1}, 0},
+	{"cp", eFlowNext, {1, 1, 1}, 0},
+	{"cpc", eFlowNext, {1, 1, 1}, 0},
+	{"cpi", eFlowNext, {1, 1, 1}, 0},
+	{"cpse", eFlowSkip, {1, 1, 1}, 0},
+	{"dec", eFlowNext, {1, 1, 1}, 0},
+	{"des", eFlowNext, {1, 1, 1}, 0},
+	{"eicall", eFlowIndirectCall, {3, 3, 2}, 1},
+	{"eijmp", eFlowIndirectJump, {2, 2, 2}, 0},
+	{"elpm", eFlowNext, {3, 3, 3}, 0},
+	{"eor", eFlowNext, {1, 1, 1}, 0},
+	{"fmul", eFlowNext, {2, 2, 2}, 0},
+	{"fmuls", eFlowNext, {2, 2, 2}, 0},
+	{"fmulsu", eFlowNext, {2, 2, 2}, 0},
+	{"icall", eFlowIndirectCall, {3, 3, 2}, 1},
+	{"ijmp", eFlowIndirectJump, {2, 2, 2}, 0},
+	{"in", eFlowNext, {1, 1, 1}, 0},
+	{"inc", eFlowNext, {1, 1, 1}, 0},
+	{"jmp", eFlowJump, {3, 3, 3}, 0},
+	{"lac", eFlowNext, {2, 2, 2}, 0},
+	{"las", eFlowNext, {2, 2, 2}, 0},
+	{"lat", eFlowNext, {2, 2, 2}, 0},
+	{"ld", eFlowNext, {2, 2, 2}, 0},
+	{"ld-", eFlowNext, {2, 2, 3}, 0},
+	{"ldd", eFlowNext, {2, 2, 3}, 0},
+	{"ldi", eFlowNext, {1, 1, 1}, 0},
+	{"lds", eFlowNext, {2, 2, 3}, 0},
+	{"lpm", eFlowNext, {3, 3, 3}, 0},
+	{"lsr", eFlowNext, {1, 1, 1}, 0},
+	{"mov", eFlowNext, {1, 1, 1}, 0},
+	{"movw", eFlowNext, {1, 1, 1}, 0},
+	{"mul", eFlowNext, {2, 2, 2}, 0},
+	{"muls", eFlowNext, {2, 2, 2}, 0},
+	{"mulsu", eFlowNext, {2, 2, 2}, 0},
+	{"neg", eFlowNext, {1, 1, 1}, 0},
+	{"nop", eFlowNext, {1, 1, 1}, 0},
+	{"or", eFlowNext, {1, 1, 1}, 0},
+	{"ori", eFlowNext, {1, 1, 1}, 0},
+	{"out", eFlowNext, {1, 1, 1}, 0},
+	{"pop", eFlowNext, {2, 2, 2}, 0},
+	{"push", eFlowNext, {2, 2, 1}, 0},
+	{"rcall", eFlowCall, {3, 3, 2}, 1},
+	{"ret", eFlowReturn, {4, 4, 4}, 1},
+	{"reti", eFlowReturn, {4, 4, 4}, 1},
+	{"rjmp", eFlowJump, {2, 2, 2}, 0},
+	{"ror", eFlowNext, {1, 1, 1}, 0},
+	{"sbc", eFlowNext, {1, 1, 1}, 0},
+	{"sbci", eFlowNext, {1, 1, 1}, 0},
+	{"sbi", eFlowNext, {2, 2, 1}, 0},
+	{"sbic", eFlowSkip, {1, 1, 2}, 0},
+	{"sbis", eFlowSkip, {1, 1, 2}, 0},
+	{"sbiw", eFlowNext, {2, 2, 2}, 0},
+	{"sbrc", eFlowSkip, {1, 1, 1}, 0},
+	{"sbrs", eFlowSkip, {1, 1, 1}, 0},
+	{"sec", eFlowNext, {1, 1, 1}, 0},
+	{"seh", eFlowNext, {1, 1, 1}, 0},
+	{"sei", eFlowNext, {1, 1, 1}, 0},
+	{"sen", eFlowNext, {1, 1, 1}, 0},
+	{"ses", eFlowNext, {1, 1, 1}, 0},
+	{"set", eFlowNext, {1, 1, 1}, 0},
+	{"sev", eFlowNext, {1, 1, 1}, 0},
+	{"sez", eFlowNext, {1, 1, 1}, 0},
+	{"sleep", eFlowNext, {1, 1, 1}, 0},
+	{"spm", eFlowNext, {4, 4, 4}, 0},	// Varies with the operation
+	{"st", eFlowNext, {2, 2, 1}, 0},
+	{"st-", eFlowNext, {2, 2, 2}, 0},
+	{"std", eFlowNext, {2, 2, 2}, 0},
+	{"sts", eFlowNext, {2, 2, 2}, 0},
+	{"sub", eFlowNext, {1, 1, 1}, 0},
+	{"subi", eFlowNext, {1, 1, 1}, 0},
+	{"swap", eFlowNext, {1, 1, 1}, 0},
+	{"wdr", eFlowNext, {1, 1, 1}, 0},
+	{"xch", eFlowNext, {2, 2, 2}, 0}
+};
+
+static_assert(sizeof(kTimings)/sizeof(STiming) < 256, "The timing table entries are 8 bits");
+
+/*
+*	Maps each opcode to its kTimings index, built once on first use the same
+*	way as the disassembler's decode table.
+*/
+struct STimingTable
+{
+	uint8_t	timing[0x10000];
+	STimingTable(void)
+	{
+		const STiming*	timingsEnd = &kTimings[sizeof(kTimings)/sizeof(STiming)];
+		for (uint32_t opcode = 0; opcode < 0x10000; opcode++)
+		{
+			const char*	mnemonic = AVRDisassembler::Mnemonic((uint16_t)opcode);
+			char	preDecMnemonic[4];
+			// ld -X, ld -Y, ld -Z, st -X, st -Y and st -Z
+			if ((opcode & 0xFC03) == 0x9002 &&
+				(strcmp(mnemonic, "ld") == 0 || strcmp(mnemonic, "st") == 0))
+			{
+				snprintf(preDecMnemonic, sizeof(preDecMnemonic), "%s-", mnemonic);
+				mnemonic = preDecMnemonic;
+			}
+			const STiming*	entry = std::lower_bound(kTimings, timingsEnd, mnemonic,
+				[](const STiming& inTiming, const char* inMnemonic){return(strcmp(inTiming.mnemonic, inMnemonic) < 0);});
+			timing[opcode] = (entry != timingsEnd && strcmp(entry->mnemonic, mnemonic) == 0) ?
+				(uint8_t)(entry - kTimings) : 0;
+		}
+	}
+};
+
+static const STimingTable& TimingTable(void)
+{
+	static const STimingTable	sTimingTable;
+	return(sTimingTable);
+}
+
+static const uint32_t	kExitNode = 0xFFFFFFFF;
+static const uint32_t	kNoPath = 0xFFFFFFFF;
+static const uint32_t	kMaxNodes = 0x8000;		// Instructions per routine
+static const uint32_t	kMaxCallDepth = 32;
+
+/****************************** AVRCycleAnalyzer ******************************/
+AVRCycleAnalyzer::AVRCycleAnalyzer(
+	const AVRElfFile&	inElfFile,
+	EAVRCore			inCore,
+	bool				inHas22BitPC)
+	: mElfFile(inElfFile), mText(NULL), mTextAddr(0), mTextSize(0),
+	  mCore(inCore), mHas22BitPC(inHas22BitPC)
+{
+	const SSectEntry*	textSectEntry = inElfFile.GetSectEntry(eText);
+	if (textSectEntry)
+	{
+		mText = (const uint16_t*)inElfFile.GetTextPtr();
+		mTextAddr = textSectEntry->addrInMem;
+		mTextSize = textSectEntry->size & ~1;
+	}
+}
+
+/******************************* CoreForDevice ********************************/
+EAVRCore AVRCycleAnalyzer::CoreForDevice(
+	const char*	inDeviceName,
+	uint32_t	inFlashSize,
+	bool&		outHas22BitPC)
+{
+	outHas22BitPC = inFlashSize > 0x20000;
+	return(strncasecmp(inDeviceName, "atxmega", 7) == 0 ? eAVRxm :
+			(inFlashSize > 0x10000 ? eAVRePlus : eAVRe));
+}
+
+/********************************* CoreName ***********************************/
+const char* AVRCycleAnalyzer::CoreName(
+	EAVRCore	inCore)
+{
+	static const char* const	kCoreName[] = {"AVRe", "AVRe+", "AVRxm"};
+	return(inCore < eNumAVRCores ? kCoreName[inCore] : "?");
+}
+
+/***************************** InstructionCycles ******************************/
+uint32_t AVRCycleAnalyzer::InstructionCycles(
+	uint16_t	inOpcode,
+	EAVRCore	inCore,
+	bool		inHas22BitPC)
+{
+	const STiming&	timing = kTimings[TimingTable().timing[inOpcode]];
+	return(timing.cycles[inCore] + (inHas22BitPC ? timing.pcCycles : 0));
+}
+
+/************************** InterruptResponseCycles ***************************/
+uint32_t AVRCycleAnalyzer::InterruptResponseCycles(
+	EAVRCore	inCore,
+	bool		inHas22BitPC)
+{
+	return(inCore == eAVRxm ? 5 : (inHas22BitPC ? 5 : 4));
+}
+
+/********************************* BuildGraph *********************************/
+/*
+*	Adds a node for each instruction reachable from inAddress without
+*	passing through a ret or reti.  Each edge carries the cycles of the
+*	instruction when execution continues along that edge.
+*/
+void AVRCycleAnalyzer::BuildGraph(
+	uint32_t			inAddress,
+	SCodeCycles&		ioCycles,
+	std::vector<SNode>&	outNodes)
+{
+	std::map<uint32_t, uint32_t>	nodeIndex;
+	std::vector<uint32_t>	worklist;
+	/*
+	*	Returns the index of the node for the address, adding it if needed,
+	*	or kExitNode if the address isn't within .text.
+	*/
+	auto	nodeFor = [&](uint32_t inNodeAddress) -> uint32_t
+	{
+		if (inNodeAddress < mTextAddr ||
+			inNodeAddress >= (mTextAddr + mTextSize) ||
+			(inNodeAddress & 1))
+		{
+			ioCycles.isComplete = false;
+			return(kExitNode);
+		}
+		std::map<uint32_t, uint32_t>::const_iterator	itr = nodeIndex.find(inNodeAddress);
+		if (itr != nodeIndex.end())
+		{
+			return(itr->second);
+		}
+		uint32_t	index = (uint32_t)outNodes.size();
+		SNode	node = {inNodeAddress, 0, {}};
+		outNodes.push_back(node);
+		nodeIndex[inNodeAddress] = index;
+		worklist.push_back(index);
+		return(index);
+	};
+	nodeFor(inAddress);
+	const STimingTable&	timingTable = TimingTable();
+	while (!worklist.empty())
+	{
+		if (outNodes.size() > kMaxNodes)
+		{
+			ioCycles.isComplete = false;
+			break;
+		}
+		uint32_t	index = worklist.back();
+		worklist.pop_back();
+		uint32_t	address = outNodes[index].address;
+		uint32_t	wordIndex = (address - mTextAddr)/2;
+		uint16_t	opcode = mText[wordIndex];
+		uint32_t	length = AVRDisassembler::InstructionLength(opcode);
+		if ((wordIndex + length) * 2 > mTextSize)
+		{
+			ioCycles.isComplete = false;
+			continue;
+		}
+		const STiming&	timing = kTimings[timingTable.timing[opcode]];
+		uint32_t	cycles = InstructionCycles(opcode);
+		uint32_t	nextAddress = address + length * 2;
+		SEdge	edge[2] = {{kExitNode, cycles, cycles}, {kExitNode, cycles, cycles}};
+		uint32_t	numEdges = 1;
+		if ((opcode & 0xFE0F) == 0x920F)
+		{
+			ioCycles.pushCount++;
+		} else if ((opcode & 0xFE0F) == 0x900F)
+		{
+			ioCycles.popCount++;
+		}
+		switch (timing.flow)
+		{
+			case eFlowNext:
+				edge[0].node = nodeFor(nextAddress);
+				break;
+			case eFlowBranch:
+			{
+				int32_t	offset = ((int16_t)(opcode << 6)) >> 9;
+				edge[0].node = nodeFor(nextAddress);
+				edge[1].node = nodeFor(nextAddress + offset * 2);
+				edge[1].best = edge[1].worst = cycles + 1;
+				numEdges = 2;
+				break;
+			}
+			case eFlowSkip:
+			{
+				uint32_t	skipLength = 1;
+				if ((nextAddress - mTextAddr) < mTextSize)
+				{
+					skipLength = AVRDisassembler::InstructionLength(mText[wordIndex + length]);
+				}
+				edge[0].node = nodeFor(nextAddress);
+				edge[1].node = nodeFor(nextAddress + skipLength * 2);
+				edge[1].best = edge[1].worst = cycles + skipLength;
+				numEdges = 2;
+				break;
+			}
+			case eFlowJump:
+			case eFlowCall:
+			{
+				uint32_t	target;
+				if (length == 2)
+				{
+					// jmp and call, 22 bit word address
+					target = (((((opcode >> 3) & 0x3E) | (opcode & 1)) << 16) | mText[wordIndex + 1]) * 2;
+				} else
+				{
+					// rjmp and rcall, 12 bit signed word offset
+					target = nextAddress + (((int16_t)(opcode << 4)) >> 4) * 2;
+				}
+				if (timing.flow == eFlowJump)
+				{
+					edge[0].node = nodeFor(target);
+					break;
+				}
+				const SCodeCycles*	callee = AnalyzeRoutine(target);
+				if (callee)
+				{
+					edge[0].best += callee->bestCycles;
+					edge[0].worst += callee->worstCycles;
+					ioCycles.hasIndirect |= callee->hasIndirect;
+					ioCycles.isComplete &= callee->isComplete;
+					for (const SLoopCost& loop : callee->loops)
+					{
+						AddLoop(loop.address, loop.cycles, ioCycles);
+					}
+				} else
+				{
+					// Recursive
+					ioCycles.isComplete = false;
+				}
+				edge[0].node = nodeFor(nextAddress);
+				break;
+			}
+			case eFlowReturn:
+				break;
+			case eFlowIndirectJump:
+				ioCycles.hasIndirect = true;
+				break;
+			case eFlowIndirectCall:
+				ioCycles.hasIndirect = true;
+				edge[0].node = nodeFor(nextAddress);
+				break;
+			default:	// eFlowInvalid, a dead end
+				ioCycles.isComplete = false;
+				numEdges = 0;
+				break;
+		}
+		SNode&	node = outNodes[index];
+		node.numEdges = numEdges;
+		node.edge[0] = edge[0];
+		node.edge[1] = edge[1];
+	}
+}
+
+/********************************* BestCycles *********************************/
+/*
+*	Dijkstra's shortest path from the entry to the exit.
+*/
+void AVRCycleAnalyzer::BestCycles(
+	const std::vector<SNode>&	inNodes,
+	SCodeCycles&				ioCycles)
+{
+	typedef std::pair<uint32_t, uint32_t> CyclesNode;
+	std::priority_queue<CyclesNode, std::vector<CyclesNode>, std::greater<CyclesNode>>	queue;
+	std::vector<uint32_t>	cycles(inNodes.size(), kNoPath);
+	uint32_t	bestCycles = kNoPath;
+	if (!inNodes.empty())
+	{
+		cycles[0] = 0;
+		queue.push(CyclesNode(0, 0));
+	}
+	while (!queue.empty())
+	{
+		CyclesNode	current = queue.top();
+		queue.pop();
+		if (current.first > cycles[current.second] ||
+			current.first >= bestCycles)
+		{
+			continue;
+		}
+		const SNode&	node = inNodes[current.second];
+		for (uint32_t i = 0; i < node.numEdges; i++)
+		{
+			const SEdge&	edge = node.edge[i];
+			uint32_t	edgeCycles = current.first + edge.best;
+			if (edge.node == kExitNode)
+			{
+				bestCycles = std::min(bestCycles, edgeCycles);
+			} else if (edgeCycles < cycles[edge.node])
+			{
+				cycles[edge.node] = edgeCycles;
+				queue.push(CyclesNode(edgeCycles, edge.node));
+			}
+		}
+	}
+	if (bestCycles == kNoPath)
+	{
+		// Never returns
+		ioCycles.isComplete = false;
+		bestCycles = 0;
+	}
+	ioCycles.bestCycles = bestCycles;
+}
+
+/******************************** WorstCycles *********************************/
+/*
+*	An iterative depth first search.  An edge to a node on the search path
+*	closes a loop and isn't followed, leaving a DAG whose longest path to
+*	the exit is computed as each node is finished.  The cost of one
+*	iteration of the loop is the path cost from the loop head to the edge.
+*/
+void AVRCycleAnalyzer::WorstCycles(
+	const std::vector<SNode>&	inNodes,
+	SCodeCycles&				ioCycles)
+{
+	enum {eUnvisited, eOnPath, eFinished};
+	struct SFrame
+	{
+		uint32_t	node;
+		uint32_t	edgeIndex;
+	};
+	size_t	numNodes = inNodes.size();
+	std::vector<uint8_t>	state(numNodes, eUnvisited);
+	std::vector<uint32_t>	pathCycles(numNodes, 0);	// Entry to node along the search path
+	std::vector<uint32_t>	worstCycles(numNodes, kNoPath);	// Node to exit
+	std::vector<SFrame>	stack;
+	if (numNodes)
+	{
+		SFrame	frame = {0, 0};
+		stack.push_back(frame);
+		state[0] = eOnPath;
+	}
+	while (!stack.empty())
+	{
+		SFrame&	frame = stack.back();
+		const SNode&	node = inNodes[frame.node];
+		if (frame.edgeIndex < node.numEdges)
+		{
+			const SEdge&	edge = node.edge[frame.edgeIndex++];
+			if (edge.node == kExitNode)
+			{
+				continue;
+			}
+			if (state[edge.node] == eUnvisited)
+			{
+				state[edge.node] = eOnPath;
+				pathCycles[edge.node] = pathCycles[frame.node] + edge.worst;
+				SFrame	nextFrame = {edge.node, 0};
+				stack.push_back(nextFrame);	// frame is invalid after this
+			} else if (state[edge.node] == eOnPath)
+			{
+				AddLoop(inNodes[edge.node].address,
+					pathCycles[frame.node] + edge.worst - pathCycles[edge.node], ioCycles);
+			}
+			continue;
+		}
+		uint32_t	cycles = kNoPath;
+		for (uint32_t i = 0; i < node.numEdges; i++)
+		{
+			const SEdge&	edge = node.edge[i];
+			if (edge.node == kExitNode)
+			{
+				cycles = cycles == kNoPath ? edge.worst : std::max(cycles, edge.worst);
+			} else if (state[edge.node] == eFinished &&
+				worstCycles[edge.node] != kNoPath)
+			{
+				uint32_t	edgeCycles = edge.worst + worstCycles[edge.node];
+				cycles = cycles == kNoPath ? edgeCycles : std::max(cycles, edgeCycles);
+			}
+		}
+		worstCycles[frame.node] = cycles;
+		state[frame.node] = eFinished;
+		stack.pop_back();
+	}
+	ioCycles.worstCycles = (numNodes && worstCycles[0] != kNoPath) ? worstCycles[0] : 0;
+}
+
+/********************************** AddLoop ***********************************/
+void AVRCycleAnalyzer::AddLoop(
+	uint32_t		inAddress,
+	uint32_t		inCycles,
+	SCodeCycles&	ioCycles)
+{
+	std::vector<SLoopCost>::iterator	itr = std::find_if(ioCycles.loops.begin(), ioCycles.loops.end(),
+		[inAddress](const SLoopCost& inLoop){return(inLoop.address == inAddress);});
+	if (itr != ioCycles.loops.end())
+	{
+		itr->cycles = std::max(itr->cycles, inCycles);
+	} else
+	{
+		SLoopCost	loop = {inAddress, inCycles};
+		ioCycles.loops.push_back(loop);
+	}
+}
+
+/******************************* AnalyzeRoutine *******************************/
+/*
+*	Returns NULL if the routine is already being analyzed (recursion) or the
+*	calls are nested too deeply.
+*/
+const SCodeCycles* AVRCycleAnalyzer::AnalyzeRoutine(
+	uint32_t	inAddress)
+{
+	std::map<uint32_t, SCodeCycles>::const_iterator	itr = mRoutines.find(inAddress);
+	if (itr != mRoutines.end())
+	{
+		return(&itr->second);
+	}
+	if (mText == NULL ||
+		mCallStack.size() >= kMaxCallDepth ||
+		std::find(mCallStack.begin(), mCallStack.end(), inAddress) != mCallStack.end())
+	{
+		return(NULL);
+	}
+	mCallStack.push_back(inAddress);
+	SCodeCycles	routine;
+	routine.address = inAddress;
+	routine.bestCycles = 0;
+	routine.worstCycles = 0;
+	routine.pushCount = 0;
+	routine.popCount = 0;
+	routine.hasIndirect = false;
+	routine.isComplete = true;
+	std::vector<SNode>	nodes;
+	BuildGraph(inAddress, routine, nodes);
+	BestCycles(nodes, routine);
+	WorstCycles(nodes, routine);
+	routine.pushPopCycles = routine.pushCount * InstructionCycles(0x920F) +
+							routine.popCount * InstructionCycles(0x900F);
+	std::sort(routine.loops.begin(), routine.loops.end(),
+		[](const SLoopCost& inA, const SLoopCost& inB){return(inA.address < inB.address);});
+	mCallStack.pop_back();
+	SCodeCycles&	cycles = mRoutines[inAddress];
+	cycles = std::move(routine);
+	return(&cycles);
+}
+
+/******************************* AnalyzeVectors *******************************/
+bool AVRCycleAnalyzer::AnalyzeVectors(
+	ISRCycles&	outISRCycles)
+{
+	IndexVec	vectorIndexes;
+	bool	success = mText &&
+				mElfFile.GetVectorIndexes(vectorIndexes);
+	outISRCycles.clear();
+	if (success)
+	{
+		const char*	stringTable = mElfFile.GetStringTable();
+		const Runs&	runs = vectorIndexes.GetRuns();
+		for (size_t runIndex = 0; (runIndex + 1) < runs.size(); runIndex++)
+		{
+			if (!vectorIndexes.GetRunValue(runIndex))
+			{
+				continue;
+			}
+			for (uint32_t vectorIndex = runs[runIndex]; vectorIndex < runs[runIndex+1]; vectorIndex++)
+			{
+				const uint16_t*	jmp = &mText[vectorIndex * 2];
+				uint32_t	handlerAddr = (((((jmp[0] >> 3) & 0x3E) | (jmp[0] & 1)) << 16) | jmp[1]) * 2;
+				const SCodeCycles*	handler = AnalyzeRoutine(handlerAddr);
+				if (handler == NULL)
+				{
+					continue;
+				}
+				SISRCycles	isrCycles;
+				uint32_t	offset;
+				const SSymbolTblEntry*	symTblEntry = mElfFile.SymbolForAddress(handlerAddr, eFlashSpace, &offset);
+				isrCycles.vectorIndex = vectorIndex;
+				isrCycles.name = symTblEntry && offset == 0 ? &stringTable[symTblEntry->name] : NULL;
+				isrCycles.entryCycles = InterruptResponseCycles() + InstructionCycles(jmp[0]);
+				isrCycles.handler = *handler;
+				outISRCycles.push_back(isrCycles);
+			}
+		}
+	}
+	return(success);
+}
+
+/*********************************** Report ***********************************/
+void AVRCycleAnalyzer::Report(
+	const ISRCycles&	inISRCycles,
+	std::string&		ioText) const
+{
+	char	line[128];
+	snprintf(line, sizeof(line), "\nISR cycles (%s, %u bit PC):\nVector Handler                     Entry   Best  Worst  Push/Pop\n",
+		CoreName(mCore), mHas22BitPC ? 22 : 16);
+	ioText.append(line);
+	for (const SISRCycles& isrCycles : inISRCycles)
+	{
+		const SCodeCycles&	handler = isrCycles.handler;
+		snprintf(line, sizeof(line), "%6u %-26s %6u %6u %6u  %u/%u (%u)%s%s\n",
+			isrCycles.vectorIndex, isrCycles.name ? isrCycles.name : "?",
+			isrCycles.entryCycles, handler.bestCycles, handler.worstCycles,
+			handler.pushCount, handler.popCount, handler.pushPopCycles,
+			handler.hasIndirect ? " indirect" : "",
+			handler.isComplete ? "" : " incomplete");
+		ioText.append(line);
+		for (const SLoopCost& loop : handler.loops)
+		{
+			snprintf(line, sizeof(line), "       loop at 0x%04x, %u cycles per iteration\n",
+				loop.address, loop.cycles);
+			ioText.append(line);
+		}
+	}
+}
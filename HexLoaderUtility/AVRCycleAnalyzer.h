@@ -0,0 +1,186 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  AVRCycleAnalyzer.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+/*
+*	A static cycle count estimator for the interrupt handlers of a sketch.
+*	Each implemented vector's JMP is followed to its handler, and every path
+*	from the handler's entry to its reti is costed using a per-core cycle
+*	table (from the AVR Instruction Set Manual.)  Calls are costed as the
+*	call plus the callee's own best or worst case.
+*
+*	Loops can't be bounded statically.  The worst case is the longest path
+*	with each loop body executed once, and each loop found is reported with
+*	the worst case cost of one iteration so that it can be multiplied by the
+*	expected trip count.
+*
+*	The XMEGA (AVRxm) load timings assume internal SRAM, which adds a cycle.
+*/
+#ifndef AVRCycleAnalyzer_h
+#define AVRCycleAnalyzer_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class AVRElfFile;
+
+enum EAVRCore
+{
+	eAVRe,			// megaAVR and tinyAVR with MUL
+	eAVRePlus,		// AVRe with ELPM (more than 64KB of flash)
+	eAVRxm,			// XMEGA
+	eNumAVRCores
+};
+
+struct SLoopCost
+{
+	uint32_t	address;	// Flash address of the loop head
+	uint32_t	cycles;		// Worst case cycles of one iteration
+};
+
+struct SCodeCycles
+{
+	uint32_t	address;		// Flash address of the entry
+	uint32_t	bestCycles;		// Entry through the ret or reti, inclusive
+	uint32_t	worstCycles;	// Same, with each loop body executed once
+	uint32_t	pushCount;		// push and pop instructions within the routine,
+	uint32_t	popCount;		// not including those of the routines it calls.
+	uint32_t	pushPopCycles;
+	bool		hasIndirect;	// Contains or calls an ijmp or icall (not costed)
+	bool		isComplete;		// false if a path left .text, hit an invalid
+								// opcode, or the routine is recursive.
+	std::vector<SLoopCost>	loops;	// Including the loops of the routines called
+};
+
+struct SISRCycles
+{
+	uint32_t	vectorIndex;
+	const char*	name;			// The handler's symbol name, NULL if unknown
+	uint32_t	entryCycles;	// Interrupt response plus the vector's jmp
+	SCodeCycles	handler;
+};
+
+typedef std::vector<SISRCycles> ISRCycles;
+
+class AVRCycleAnalyzer
+{
+public:
+							AVRCycleAnalyzer(
+								const AVRElfFile&		inElfFile,
+								EAVRCore				inCore,
+								bool					inHas22BitPC = false);
+							~AVRCycleAnalyzer(void){}
+	/*
+	*	Returns the core of the device given its name (e.g. "ATmega328P")
+	*	and flash size in bytes.  outHas22BitPC is set for devices with more
+	*	than 128KB of flash.
+	*/
+	static EAVRCore			CoreForDevice(
+								const char*				inDeviceName,
+								uint32_t				inFlashSize,
+								bool&					outHas22BitPC);
+	static const char*		CoreName(
+								EAVRCore				inCore);
+	/*
+	*	Returns the cycles of the instruction when the branch isn't taken or
+	*	the skip doesn't skip.
+	*/
+	uint32_t				InstructionCycles(
+								uint16_t				inOpcode) const
+								{return(InstructionCycles(inOpcode, mCore, mHas22BitPC));}
+	static uint32_t			InstructionCycles(
+								uint16_t				inOpcode,
+								EAVRCore				inCore,
+								bool					inHas22BitPC);
+	/*
+	*	The minimum number of cycles from the interrupt being accepted to
+	*	the execution of the vector's instruction.  Up to 4 (5 with a 22 bit
+	*	PC) more are added when a multi-cycle instruction is executing.
+	*/
+	uint32_t				InterruptResponseCycles(void) const
+								{return(InterruptResponseCycles(mCore, mHas22BitPC));}
+	static uint32_t			InterruptResponseCycles(
+								EAVRCore				inCore,
+								bool					inHas22BitPC);
+	/*
+	*	Analyzes the handler of each implemented vector.  Returns false if
+	*	the vectors couldn't be found.
+	*/
+	bool					AnalyzeVectors(
+								ISRCycles&				outISRCycles);
+	/*
+	*	Analyzes the routine at the flash address inAddress.  The result is
+	*	cached, the returned pointer remains valid for the life of the
+	*	analyzer.
+	*/
+	const SCodeCycles*		AnalyzeRoutine(
+								uint32_t				inAddress);
+	/*
+	*	Appends a line per vector and one per loop.
+	*/
+	void					Report(
+								const ISRCycles&		inISRCycles,
+								std::string&			ioText) const;
+protected:
+	struct SEdge
+	{
+		uint32_t	node;		// Index of the successor, kExitNode for ret/reti
+		uint32_t	best;		// Cycles of the instruction along this edge
+		uint32_t	worst;
+	};
+	struct SNode
+	{
+		uint32_t	address;
+		uint32_t	numEdges;
+		SEdge		edge[2];
+	};
+	const AVRElfFile&		mElfFile;
+	const uint16_t*			mText;
+	uint32_t				mTextAddr;
+	uint32_t				mTextSize;		// In bytes
+	EAVRCore				mCore;
+	bool					mHas22BitPC;
+	std::map<uint32_t, SCodeCycles>	mRoutines;
+	std::vector<uint32_t>	mCallStack;		// Routines being analyzed
+
+	void					BuildGraph(
+								uint32_t				inAddress,
+								SCodeCycles&			ioCycles,
+								std::vector<SNode>&		outNodes);
+	static void				BestCycles(
+								const std::vector<SNode>& inNodes,
+								SCodeCycles&			ioCycles);
+	static void				WorstCycles(
+								const std::vector<SNode>& inNodes,
+								SCodeCycles&			ioCycles);
+	static void				AddLoop(
+								uint32_t				inAddress,
+								uint32_t				inCycles,
+								SCodeCycles&			ioCycles);
+};
+
+#endif /* AVRCycleAnalyzer_h */
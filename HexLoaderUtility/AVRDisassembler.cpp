@@ -0,0 +1,815 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  AVRDisassembler.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+#include "AVRDisassembler.h"
+#include "AVRElfFile.h"
+#include <thread>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+enum EOperandFormat
+{
+	eFmtNone,		// nop
+	eFmtRd,			// com r24
+	eFmtRdRr,		// add r24, r22
+	eFmtRdK,		// ldi r24, 0x05
+	eFmtMovw,		// movw r24, r22
+	eFmtMuls,		// muls r16, r17 (r16..r31)
+	eFmtFmul,		// fmul r16, r17 (r16..r23)
+	eFmtAdiw,		// adiw r24, 0x01
+	eFmtBranch,		// brne .-8
+	eFmtRel12,		// rjmp .+2
+	eFmtJmp,		// jmp 0x68 (32 bit)
+	eFmtLds,		// lds r24, 0x0100 (32 bit)
+	eFmtSts,		// sts 0x0100, r24 (32 bit)
+	eFmtIn,			// in r24, 0x3f
+	eFmtOut,		// out 0x3f, r24
+	eFmtIOBit,		// sbi 0x05, 5
+	eFmtRegBit,		// sbrc r24, 3
+	eFmtLdPtr,		// ld r24, X+
+	eFmtStPtr,		// st X+, r24
+	eFmtPtr,		// spm Z+
+	eFmtLdd,		// ldd r24, Y+5
+	eFmtStd,		// std Y+5, r24
+	eFmtDes,		// des 0x0F
+	eFmtWord		// .word 0xffff
+};
+
+struct SInstruction
+{
+	uint16_t	mask;
+	uint16_t	match;
+	const char*	mnemonic;
+	uint8_t		format;
+	const char*	pointer;	// eFmtLdPtr, eFmtStPtr, eFmtPtr, eFmtLdd and eFmtStd
+};
+
+/*
+*	The first matching entry is used, so more specific entries must precede
+*	more general ones.  The last entry matches everything.
+*/
+static const SInstruction	kInstructions[] =
+{
+	{0xFFFF, 0x0000, "nop", eFmtNone, NULL},
+	{0xFF00, 0x0100, "movw", eFmtMovw, NULL},
+	{0xFF00, 0x0200, "muls", eFmtMuls, NULL},
+	{0xFF88, 0x0300, "mulsu", eFmtFmul, NULL},
+	{0xFF88, 0x0308, "fmul", eFmtFmul, NULL},
+	{0xFF88, 0x0380, "fmuls", eFmtFmul, NULL},
+	{0xFF88, 0x0388, "fmulsu", eFmtFmul, NULL},
+	{0xFC00, 0x0400, "cpc", eFmtRdRr, NULL},
+	{0xFC00, 0x0800, "sbc", eFmtRdRr, NULL},
+	{0xFC00, 0x0C00, "add", eFmtRdRr, NULL},
+	{0xFC00, 0x1000, "cpse", eFmtRdRr, NULL},
+	{0xFC00, 0x1400, "cp", eFmtRdRr, NULL},
+	{0xFC00, 0x1800, "sub", eFmtRdRr, NULL},
+	{0xFC00, 0x1C00, "adc", eFmtRdRr, NULL},
+	{0xFC00, 0x2000, "and", eFmtRdRr, NULL},
+	{0xFC00, 0x2400, "eor", eFmtRdRr, NULL},
+	{0xFC00, 0x2800, "or", eFmtRdRr, NULL},
+	{0xFC00, 0x2C00, "mov", eFmtRdRr, NULL},
+	{0xF000, 0x3000, "cpi", eFmtRdK, NULL},
+	{0xF000, 0x4000, "sbci", eFmtRdK, NULL},
+	{0xF000, 0x5000, "subi", eFmtRdK, NULL},
+	{0xF000, 0x6000, "ori", eFmtRdK, NULL},
+	{0xF000, 0x7000, "andi", eFmtRdK, NULL},
+	{0xD208, 0x8000, "ldd", eFmtLdd, "Z"},
+	{0xD208, 0x8008, "ldd", eFmtLdd, "Y"},
+	{0xD208, 0x8200, "std", eFmtStd, "Z"},
+	{0xD208, 0x8208, "std", eFmtStd, "Y"},
+	{0xFE0F, 0x9000, "lds", eFmtLds, NULL},
+	{0xFE0F, 0x9001, "ld", eFmtLdPtr, "Z+"},
+	{0xFE0F, 0x9002, "ld", eFmtLdPtr, "-Z"},
+	{0xFE0F, 0x9004, "lpm", eFmtLdPtr, "Z"},
+	{0xFE0F, 0x9005, "lpm", eFmtLdPtr, "Z+"},
+	{0xFE0F, 0x9006, "elpm", eFmtLdPtr, "Z"},
+	{0xFE0F, 0x9007, "elpm", eFmtLdPtr, "Z+"},
+	{0xFE0F, 0x9009, "ld", eFmtLdPtr, "Y+"},
+	{0xFE0F, 0x900A, "ld", eFmtLdPtr, "-Y"},
+	{0xFE0F, 0x900C, "ld", eFmtLdPtr, "X"},
+	{0xFE0F, 0x900D, "ld", eFmtLdPtr, "X+"},
+	{0xFE0F, 0x900E, "ld", eFmtLdPtr, "-X"},
+	{0xFE0F, 0x900F, "pop", eFmtRd, NULL},
+	{0xFE0F, 0x9200, "sts", eFmtSts, NULL},
+	{0xFE0F, 0x9201, "st", eFmtStPtr, "Z+"},
+	{0xFE0F, 0x9202, "st", eFmtStPtr, "-Z"},
+	{0xFE0F, 0x9204, "xch", eFmtStPtr, "Z"},
+	{0xFE0F, 0x9205, "las", eFmtStPtr, "Z"},
+	{0xFE0F, 0x9206, "lac", eFmtStPtr, "Z"},
+	{0xFE0F, 0x9207, "lat", eFmtStPtr, "Z"},
+	{0xFE0F, 0x9209, "st", eFmtStPtr, "Y+"},
+	{0xFE0F, 0x920A, "st", eFmtStPtr, "-Y"},
+	{0xFE0F, 0x920C, "st", eFmtStPtr, "X"},
+	{0xFE0F, 0x920D, "st", eFmtStPtr, "X+"},
+	{0xFE0F, 0x920E, "st", eFmtStPtr, "-X"},
+	{0xFE0F, 0x920F, "push", eFmtRd, NULL},
+	{0xFE0F, 0x9400, "com", eFmtRd, NULL},
+	{0xFE0F, 0x9401, "neg", eFmtRd, NULL},
+	{0xFE0F, 0x9402, "swap", eFmtRd, NULL},
+	{0xFE0F, 0x9403, "inc", eFmtRd, NULL},
+	{0xFE0F, 0x9405, "asr", eFmtRd, NULL},
+	{0xFE0F, 0x9406, "lsr", eFmtRd, NULL},
+	{0xFE0F, 0x9407, "ror", eFmtRd, NULL},
+	{0xFE0F, 0x940A, "dec", eFmtRd, NULL},
+	{0xFFFF, 0x9408, "sec", eFmtNone, NULL},
+	{0xFFFF, 0x9418, "sez", eFmtNone, NULL},
+	{0xFFFF, 0x9428, "sen", eFmtNone, NULL},
+	{0xFFFF, 0x9438, "sev", eFmtNone, NULL},
+	{0xFFFF, 0x9448, "ses", eFmtNone, NULL},
+	{0xFFFF, 0x9458, "seh", eFmtNone, NULL},
+	{0xFFFF, 0x9468, "set", eFmtNone, NULL},
+	{0xFFFF, 0x9478, "sei", eFmtNone, NULL},
+	{0xFFFF, 0x9488, "clc", eFmtNone, NULL},
+	{0xFFFF, 0x9498, "clz", eFmtNone, NULL},
+	{0xFFFF, 0x94A8, "cln", eFmtNone, NULL},
+	{0xFFFF, 0x94B8, "clv", eFmtNone, NULL},
+	{0xFFFF, 0x94C8, "cls", eFmtNone, NULL},
+	{0xFFFF, 0x94D8, "clh", eFmtNone, NULL},
+	{0xFFFF, 0x94E8, "clt", eFmtNone, NULL},
+	{0xFFFF, 0x94F8, "cli", eFmtNone, NULL},
+	{0xFFFF, 0x9409, "ijmp", eFmtNone, NULL},
+	{0xFFFF, 0x9419, "eijmp", eFmtNone, NULL},
+	{0xFFFF, 0x9508, "ret", eFmtNone, NULL},
+	{0xFFFF, 0x9509, "icall", eFmtNone, NULL},
+	{0xFFFF, 0x9518, "reti", eFmtNone, NULL},
+	{0xFFFF, 0x9519, "eicall", eFmtNone, NULL},
+	{0xFFFF, 0x9588, "sleep", eFmtNone, NULL},
+	{0xFFFF, 0x9598, "break", eFmtNone, NULL},
+	{0xFFFF, 0x95A8, "wdr", eFmtNone, NULL},
+	{0xFFFF, 0x95C8, "lpm", eFmtNone, NULL},
+	{0xFFFF, 0x95D8, "elpm", eFmtNone, NULL},
+	{0xFFFF, 0x95E8, "spm", eFmtNone, NULL},
+	{0xFFFF, 0x95F8, "spm", eFmtPtr, "Z+"},
+	{0xFF0F, 0x940B, "des", eFmtDes, NULL},
+	{0xFE0E, 0x940C, "jmp", eFmtJmp, NULL},
+	{0xFE0E, 0x940E, "call", eFmtJmp, NULL},
+	{0xFF00, 0x9600, "adiw", eFmtAdiw, NULL},
+	{0xFF00, 0x9700, "sbiw", eFmtAdiw, NULL},
+	{0xFF00, 0x9800, "cbi", eFmtIOBit, NULL},
+	{0xFF00, 0x9900, "sbic", eFmtIOBit, NULL},
+	{0xFF00, 0x9A00, "sbi", eFmtIOBit, NULL},
+	{0xFF00, 0x9B00, "sbis", eFmtIOBit, NULL},
+	{0xFC00, 0x9C00, "mul", eFmtRdRr, NULL},
+	{0xF800, 0xB000, "in", eFmtIn, NULL},
+	{0xF800, 0xB800, "out", eFmtOut, NULL},
+	{0xF000, 0xC000, "rjmp", eFmtRel12, NULL},
+	{0xF000, 0xD000, "rcall", eFmtRel12, NULL},
+	{0xF000, 0xE000, "ldi", eFmtRdK, NULL},
+	{0xFC07, 0xF000, "brcs", eFmtBranch, NULL},
+	{0xFC07, 0xF001, "breq", eFmtBranch, NULL},
+	{0xFC07, 0xF002, "brmi", eFmtBranch, NULL},
+	{0xFC07, 0xF003, "brvs", eFmtBranch, NULL},
+	{0xFC07, 0xF004, "brlt", eFmtBranch, NULL},
+	{0xFC07, 0xF005, "brhs", eFmtBranch, NULL},
+	{0xFC07, 0xF006, "brts", eFmtBranch, NULL},
+	{0xFC07, 0xF007, "brie", eFmtBranch, NULL},
+	{0xFC07, 0xF400, "brcc", eFmtBranch, NULL},
+	{0xFC07, 0xF401, "brne", eFmtBranch, NULL},
+	{0xFC07, 0xF402, "brpl", eFmtBranch, NULL},
+	{0xFC07, 0xF403, "brvc", eFmtBranch, NULL},
+	{0xFC07, 0xF404, "brge", eFmtBranch, NULL},
+	{0xFC07, 0xF405, "brhc", eFmtBranch, NULL},
+	{0xFC07, 0xF406, "brtc", eFmtBranch, NULL},
+	{0xFC07, 0xF407, "brid", eFmtBranch, NULL},
+	{0xFE08, 0xF800, "bld", eFmtRegBit, NULL},
+	{0xFE08, 0xFA00, "bst", eFmtRegBit, NULL},
+	{0xFE08, 0xFC00, "sbrc", eFmtRegBit, NULL},
+	{0xFE08, 0xFE00, "sbrs", eFmtRegBit, NULL},
+	{0x0000, 0x0000, ".word", eFmtWord, NULL}
+};
+
+static_assert(sizeof(kInstructions)/sizeof(SInstruction) < 256, "The decode table entries are 8 bits");
+
+/*
+*	The decode table maps each opcode to its kInstructions index.  Computing
+*	all 64K entries exceeds the compile time constexpr evaluation limits, so
+*	the table is built on first use.  Function local static initialization
+*	is thread safe.
+*/
+struct SDecodeTable
+{
+	uint8_t	instruction[0x10000];
+	SDecodeTable(void)
+	{
+		const uint32_t	kNumInstructions = sizeof(kInstructions)/sizeof(SInstruction);
+		for (uint32_t opcode = 0; opcode < 0x10000; opcode++)
+		{
+			uint32_t	i = 0;
+			for (; i < (kNumInstructions - 1) &&
+					(opcode & kInstructions[i].mask) != kInstructions[i].match; i++){}
+			instruction[opcode] = (uint8_t)i;
+		}
+	}
+};
+
+static const SDecodeTable& DecodeTable(void)
+{
+	static const SDecodeTable	sDecodeTable;
+	return(sDecodeTable);
+}
+
+static const char	kHexDigits[] = "0123456789abcdef";
+
+/********************************* AppendHex **********************************/
+/*
+*	Appends inValue as at least inMinDigits lowercase hex digits.
+*/
+static void AppendHex(
+	uint32_t		inValue,
+	uint32_t		inMinDigits,
+	std::string&	ioText)
+{
+	char	digits[8];
+	uint32_t	numDigits = 0;
+	do
+	{
+		digits[numDigits++] = kHexDigits[inValue & 0xF];
+		inValue >>= 4;
+	} while (inValue || numDigits < inMinDigits);
+	while (numDigits)
+	{
+		ioText += digits[--numDigits];
+	}
+}
+
+/******************************* AppendDecimal ********************************/
+static void AppendDecimal(
+	int32_t			inValue,
+	std::string&	ioText)
+{
+	uint32_t	value = inValue < 0 ? -inValue : inValue;
+	char	digits[12];
+	uint32_t	numDigits = 0;
+	do
+	{
+		digits[numDigits++] = '0' + (value % 10);
+		value /= 10;
+	} while (value);
+	if (inValue < 0)
+	{
+		ioText += '-';
+	}
+	while (numDigits)
+	{
+		ioText += digits[--numDigits];
+	}
+}
+
+/******************************* AppendRegister *******************************/
+static void AppendRegister(
+	uint32_t		inRegister,
+	std::string&	ioText)
+{
+	ioText += 'r';
+	AppendDecimal(inRegister, ioText);
+}
+
+/****************************** AppendSymbolName ******************************/
+/*
+*	Appends " <symbol+0xoffset>" when inAddress can be resolved.
+*/
+static void AppendSymbolName(
+	const AVRElfFile*	inElfFile,
+	uint32_t			inAddress,
+	EAVRAddressSpace	inSpace,
+	std::string&		ioText)
+{
+	uint32_t	offset;
+	const SSymbolTblEntry*	symTblEntry = inElfFile ? inElfFile->SymbolForAddress(inAddress, inSpace, &offset) : NULL;
+	if (symTblEntry)
+	{
+		ioText.append(" <");
+		ioText.append(&inElfFile->GetStringTable()[symTblEntry->name]);
+		if (offset)
+		{
+			ioText.append("+0x");
+			AppendHex(offset, 1, ioText);
+		}
+		ioText += '>';
+	}
+}
+
+/****************************** AVRDisassembler *******************************/
+AVRDisassembler::AVRDisassembler(
+	const AVRElfFile&	inElfFile)
+	: mElfFile(inElfFile), mText(NULL), mTextAddr(0), mTextSize(0)
+{
+	const SSectEntry*	textSectEntry = inElfFile.GetSectEntry(eText);
+	if (textSectEntry)
+	{
+		mText = (const uint16_t*)inElfFile.GetTextPtr();
+		mTextAddr = textSectEntry->addrInMem;
+		mTextSize = textSectEntry->size & ~1;
+		/*
+		*	Collect the labels (function, object and untyped symbols) within
+		*	.text.
+		*/
+		uint16_t	textShndx = inElfFile.GetSectionIndex(eText);
+		uint32_t	numSymbols;
+		const SSymbolTblEntry*	symTblEntry = inElfFile.GetSymbolTable(numSymbols);
+		const char*	stringTable = inElfFile.GetStringTable();
+		for (uint32_t i = 0; i < numSymbols; i++, symTblEntry++)
+		{
+			uint8_t	symbolType = symTblEntry->info & 0xF;
+			if (symTblEntry->shndx == textShndx &&
+				symTblEntry->name &&
+				stringTable[symTblEntry->name] &&
+				(symbolType == eSymNoType || symbolType == eSymFunc || symbolType == eSymObject))
+			{
+				SLabel	label = {symTblEntry->value, &stringTable[symTblEntry->name]};
+				mLabels.push_back(label);
+			}
+		}
+		// Stable so the first symbol in the table is used for duplicate addresses.
+		std::stable_sort(mLabels.begin(), mLabels.end(),
+			[](const SLabel& inA, const SLabel& inB){return(inA.address < inB.address);});
+		mLabels.erase(std::unique(mLabels.begin(), mLabels.end(),
+			[](const SLabel& inA, const SLabel& inB){return(inA.address == inB.address);}), mLabels.end());
+		/*
+		*	Build the symbol intervals now, before any formatting threads
+		*	are started.
+		*/
+		inElfFile.SymbolForAddress(0, eFlashSpace);
+	}
+}
+
+/***************************** InstructionLength ******************************/
+uint32_t AVRDisassembler::InstructionLength(
+	uint16_t	inOpcode)
+{
+	uint8_t	format = kInstructions[DecodeTable().instruction[inOpcode]].format;
+	return((format == eFmtJmp || format == eFmtLds || format == eFmtSts) ? 2 : 1);
+}
+
+/********************************** Mnemonic **********************************/
+const char* AVRDisassembler::Mnemonic(
+	uint16_t	inOpcode)
+{
+	return(kInstructions[DecodeTable().instruction[inOpcode]].mnemonic);
+}
+
+/***************************** FormatInstruction ******************************/
+void AVRDisassembler::FormatInstruction(
+	const uint16_t*		inWords,
+	uint32_t			inAddress,
+	const AVRElfFile*	inElfFile,
+	std::string&		ioText)
+{
+	uint16_t	opcode = inWords[0];
+	const SInstruction&	instruction = kInstructions[DecodeTable().instruction[opcode]];
+	uint32_t	rd = (opcode >> 4) & 0x1F;
+	uint32_t	rr = (opcode & 0xF) | ((opcode >> 5) & 0x10);
+	const char*	mnemonic = instruction.mnemonic;
+	/*
+	*	ldd/std with a displacement of 0 are shown as ld/st
+	*/
+	uint32_t	displacement = (opcode & 7) | ((opcode >> 7) & 0x18) | ((opcode >> 8) & 0x20);
+	if (displacement == 0)
+	{
+		if (instruction.format == eFmtLdd)
+		{
+			mnemonic = "ld";
+		} else if (instruction.format == eFmtStd)
+		{
+			mnemonic = "st";
+		}
+	}
+	ioText.append(mnemonic);
+	if (instruction.format != eFmtNone)
+	{
+		ioText += '\t';
+	}
+	switch (instruction.format)
+	{
+		case eFmtNone:
+			break;
+		case eFmtRd:
+			AppendRegister(rd, ioText);
+			break;
+		case eFmtRdRr:
+			AppendRegister(rd, ioText);
+			ioText.append(", ");
+			AppendRegister(rr, ioText);
+			break;
+		case eFmtRdK:
+		{
+			uint32_t	k = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+			AppendRegister(16 + (rd & 0xF), ioText);
+			ioText.append(", 0x");
+			AppendHex(k, 2, ioText);
+			ioText.append("\t; ");
+			AppendDecimal(k, ioText);
+			break;
+		}
+		case eFmtMovw:
+			AppendRegister(((opcode >> 4) & 0xF) * 2, ioText);
+			ioText.append(", ");
+			AppendRegister((opcode & 0xF) * 2, ioText);
+			break;
+		case eFmtMuls:
+			AppendRegister(16 + ((opcode >> 4) & 0xF), ioText);
+			ioText.append(", ");
+			AppendRegister(16 + (opcode & 0xF), ioText);
+			break;
+		case eFmtFmul:
+			AppendRegister(16 + ((opcode >> 4) & 7), ioText);
+			ioText.append(", ");
+			AppendRegister(16 + (opcode & 7), ioText);
+			break;
+		case eFmtAdiw:
+		{
+			uint32_t	k = ((opcode >> 2) & 0x30) | (opcode & 0xF);
+			AppendRegister(24 + ((opcode >> 4) & 3) * 2, ioText);
+			ioText.append(", 0x");
+			AppendHex(k, 2, ioText);
+			ioText.append("\t; ");
+			AppendDecimal(k, ioText);
+			break;
+		}
+		case eFmtBranch:
+		case eFmtRel12:
+		{
+			int32_t	offset = instruction.format == eFmtBranch ?
+							((int32_t)((opcode >> 3) & 0x7F) ^ 0x40) - 0x40 :
+							((int32_t)(opcode & 0xFFF) ^ 0x800) - 0x800;
+			offset *= 2;
+			uint32_t	target = inAddress + 2 + offset;
+			ioText.append(offset < 0 ? ".-" : ".+");
+			AppendDecimal(offset < 0 ? -offset : offset, ioText);
+			ioText.append("\t; 0x");
+			AppendHex(target, 1, ioText);
+			AppendSymbolName(inElfFile, target, eFlashSpace, ioText);
+			break;
+		}
+		case eFmtJmp:
+		{
+			uint32_t	target = (((((opcode >> 3) & 0x3E) | (opcode & 1)) << 16) | inWords[1]) * 2;
+			ioText.append("0x");
+			AppendHex(target, 1, ioText);
+			ioText.append("\t; 0x");
+			AppendHex(target, 1, ioText);
+			AppendSymbolName(inElfFile, target, eFlashSpace, ioText);
+			break;
+		}
+		case eFmtLds:
+		case eFmtSts:
+			if (instruction.format == eFmtLds)
+			{
+				AppendRegister(rd, ioText);
+				ioText.append(", 0x");
+				AppendHex(inWords[1], 4, ioText);
+			} else
+			{
+				ioText.append("0x");
+				AppendHex(inWords[1], 4, ioText);
+				ioText.append(", ");
+				AppendRegister(rd, ioText);
+			}
+			ioText.append("\t; 0x");
+			AppendHex(AVRElfFile::AddressSpaceBase(eSRAMSpace) + inWords[1], 1, ioText);
+			AppendSymbolName(inElfFile, inWords[1], eSRAMSpace, ioText);
+			break;
+		case eFmtIn:
+		case eFmtOut:
+		{
+			uint32_t	ioAddress = (opcode & 0xF) | ((opcode >> 5) & 0x30);
+			if (instruction.format == eFmtIn)
+			{
+				AppendRegister(rd, ioText);
+				ioText.append(", 0x");
+				AppendHex(ioAddress, 2, ioText);
+			} else
+			{
+				ioText.append("0x");
+				AppendHex(ioAddress, 2, ioText);
+				ioText.append(", ");
+				AppendRegister(rd, ioText);
+			}
+			ioText.append("\t; ");
+			AppendDecimal(ioAddress, ioText);
+			break;
+		}
+		case eFmtIOBit:
+		{
+			uint32_t	ioAddress = (opcode >> 3) & 0x1F;
+			ioText.append("0x");
+			AppendHex(ioAddress, 2, ioText);
+			ioText.append(", ");
+			AppendDecimal(opcode & 7, ioText);
+			ioText.append("\t; ");
+			AppendDecimal(ioAddress, ioText);
+			break;
+		}
+		case eFmtRegBit:
+			AppendRegister(rd, ioText);
+			ioText.append(", ");
+			AppendDecimal(opcode & 7, ioText);
+			break;
+		case eFmtLdPtr:
+			AppendRegister(rd, ioText);
+			ioText.append(", ");
+			ioText.append(instruction.pointer);
+			break;
+		case eFmtStPtr:
+			ioText.append(instruction.pointer);
+			ioText.append(", ");
+			AppendRegister(rd, ioText);
+			break;
+		case eFmtPtr:
+			ioText.append(instruction.pointer);
+			break;
+		case eFmtLdd:
+			AppendRegister(rd, ioText);
+			ioText.append(", ");
+			ioText.append(instruction.pointer);
+			if (displacement)
+			{
+				ioText += '+';
+				AppendDecimal(displacement, ioText);
+				ioText.append("\t; 0x");
+				AppendHex(displacement, 2, ioText);
+			}
+			break;
+		case eFmtStd:
+			ioText.append(instruction.pointer);
+			if (displacement)
+			{
+				ioText += '+';
+				AppendDecimal(displacement, ioText);
+			}
+			ioText.append(", ");
+			AppendRegister(rd, ioText);
+			if (displacement)
+			{
+				ioText.append("\t; 0x");
+				AppendHex(displacement, 2, ioText);
+			}
+			break;
+		case eFmtDes:
+			ioText.append("0x");
+			AppendHex((opcode >> 4) & 0xF, 2, ioText);
+			break;
+		case eFmtWord:
+			ioText.append("0x");
+			AppendHex(opcode, 4, ioText);
+			ioText.append("\t; ????");
+			break;
+	}
+}
+
+/****************************** DisassembleRange ******************************/
+/*
+*	inInstructions contains the byte offset within .text of each instruction.
+*/
+void AVRDisassembler::DisassembleRange(
+	const uint32_t*	inInstructions,
+	uint32_t		inNumInstructions,
+	std::string&	outText) const
+{
+	if (inNumInstructions == 0)
+	{
+		return;
+	}
+	outText.reserve(inNumInstructions * 48);
+	std::vector<SLabel>::const_iterator	labelItr =
+		std::lower_bound(mLabels.begin(), mLabels.end(), mTextAddr + inInstructions[0],
+			[](const SLabel& inLabel, uint32_t inAddress){return(inLabel.address < inAddress);});
+	std::vector<SLabel>::const_iterator	labelEnd = mLabels.end();
+	for (uint32_t i = 0; i < inNumInstructions; i++)
+	{
+		uint32_t	offset = inInstructions[i];
+		uint32_t	address = mTextAddr + offset;
+		/*
+		*	Labels are only shown when they fall on an instruction boundary.
+		*/
+		for (; labelItr != labelEnd && labelItr->address <= address; ++labelItr)
+		{
+			if (labelItr->address == address)
+			{
+				outText += '\n';
+				AppendHex(address, 8, outText);
+				outText.append(" <");
+				outText.append(labelItr->name);
+				outText.append(">:\n");
+			}
+		}
+		const uint16_t*	words = &mText[offset/2];
+		uint32_t	length = InstructionLength(words[0]);
+		if ((offset + (length * 2)) > mTextSize)
+		{
+			length = 1;
+		}
+		uint32_t	addressWidth = 1;
+		for (uint32_t value = address >> 4; value; value >>= 4)
+		{
+			addressWidth++;
+		}
+		outText.append(addressWidth < 4 ? 4 - addressWidth : 0, ' ');
+		AppendHex(address, 1, outText);
+		outText.append(":\t");
+		for (uint32_t w = 0; w < length; w++)
+		{
+			AppendHex(words[w] & 0xFF, 2, outText);
+			outText += ' ';
+			AppendHex(words[w] >> 8, 2, outText);
+			outText += ' ';
+		}
+		outText += '\t';
+		if (length == InstructionLength(words[0]))
+		{
+			FormatInstruction(words, address, &mElfFile, outText);
+		} else
+		{
+			// A truncated 32 bit instruction at the end of the section
+			uint16_t	word = 0xFFFF;
+			FormatInstruction(&word, address, NULL, outText);
+		}
+		outText += '\n';
+	}
+}
+
+/******************************** Disassemble *********************************/
+void AVRDisassembler::Disassemble(
+	std::string&	ioText,
+	uint32_t		inNumThreads) const
+{
+	if (mText == NULL)
+	{
+		return;
+	}
+	/*
+	*	Sequential pass to find the instruction boundaries.
+	*/
+	std::vector<uint32_t>	instructions;
+	instructions.reserve(mTextSize/2);
+	for (uint32_t offset = 0; offset < mTextSize; offset += InstructionLength(mText[offset/2]) * 2)
+	{
+		instructions.push_back(offset);
+	}
+	uint32_t	numInstructions = (uint32_t)instructions.size();
+	const uint32_t	kMinInstructionsPerThread = 4096;
+	if (inNumThreads == 0)
+	{
+		inNumThreads = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+	inNumThreads = std::max(std::min(inNumThreads, numInstructions / kMinInstructionsPerThread), 1U);
+	ioText.append("\nDisassembly of section .text:\n");
+	if (inNumThreads == 1)
+	{
+		DisassembleRange(instructions.data(), numInstructions, ioText);
+	} else
+	{
+		std::vector<std::string>	chunks(inNumThreads);
+		std::vector<std::thread>	threads;
+		uint32_t	chunkSize = (numInstructions + inNumThreads - 1) / inNumThreads;
+		for (uint32_t i = 0; i < inNumThreads; i++)
+		{
+			uint32_t	start = std::min(i * chunkSize, numInstructions);
+			uint32_t	count = std::min(chunkSize, numInstructions - start);
+			threads.push_back(std::thread(&AVRDisassembler::DisassembleRange, this,
+				&instructions[start], count, std::ref(chunks[i])));
+		}
+		for (uint32_t i = 0; i < inNumThreads; i++)
+		{
+			threads[i].join();
+			ioText.append(chunks[i]);
+		}
+	}
+}
+
+/******************************** DumpSections ********************************/
+void AVRDisassembler::DumpSections(
+	std::string&	ioText) const
+{
+	ioText.append("\nSections:\nIdx Name          Size      VMA       LMA       File off  Algn\n");
+	uint16_t	numSections = mElfFile.GetNumSections();
+	uint32_t	index = 0;
+	for (uint16_t i = 1; i < numSections; i++)
+	{
+		const SSectEntry*	sectEntry = mElfFile.GetSection(i);
+		const char*	name = mElfFile.GetSectionName(sectEntry);
+		/*
+		*	Only allocated (SHF_ALLOC) sections have addresses.
+		*/
+		if ((sectEntry->flags & 2) == 0)
+		{
+			continue;
+		}
+		uint32_t	loadAddr = sectEntry->addrInMem;
+		// Sections without content (SHT_NOBITS, e.g. .bss) aren't loaded.
+		uint16_t	numProgEntries = sectEntry->type != 8 ? mElfFile.GetNumProgEntries() : 0;
+		for (uint16_t j = 0; j < numProgEntries; j++)
+		{
+			const SProgEntry*	progEntry = mElfFile.GetProgEntry(j);
+			if (progEntry->type == eProgLoad &&
+				sectEntry->offset >= progEntry->offset &&
+				sectEntry->offset < (progEntry->offset + progEntry->sizeOnFile))
+			{
+				loadAddr = progEntry->physicalAddr + sectEntry->offset - progEntry->offset;
+				break;
+			}
+		}
+		uint32_t	alignment = 0;
+		for (; alignment < 31 && (1U << alignment) < sectEntry->addrAlignment; alignment++){}
+		char	line[128];
+		snprintf(line, sizeof(line), "%3u %-13s %08x  %08x  %08x  %08x  2**%u\n",
+			index++, name, sectEntry->size, sectEntry->addrInMem, loadAddr, sectEntry->offset, alignment);
+		ioText.append(line);
+	}
+}
+
+/******************************** DumpSymbols *********************************/
+void AVRDisassembler::DumpSymbols(
+	std::string&	ioText) const
+{
+	ioText.append("\nSYMBOL TABLE:\n");
+	uint32_t	numSymbols;
+	const SSymbolTblEntry*	symTblEntry = mElfFile.GetSymbolTable(numSymbols);
+	const char*	stringTable = mElfFile.GetStringTable();
+	uint16_t	numSections = mElfFile.GetNumSections();
+	char	line[64];
+	for (uint32_t i = 1; i < numSymbols; i++)
+	{
+		uint8_t	binding = symTblEntry[i].info >> 4;
+		uint8_t	symbolType = symTblEntry[i].info & 0xF;
+		const char*	sectionName;
+		if (symTblEntry[i].shndx == eShndxAbs)
+		{
+			sectionName = "*ABS*";
+		} else if (symTblEntry[i].shndx == eShndxUndef ||
+			symTblEntry[i].shndx >= numSections)
+		{
+			sectionName = "*UND*";
+		} else
+		{
+			sectionName = mElfFile.GetSectionName(mElfFile.GetSection(symTblEntry[i].shndx));
+		}
+		snprintf(line, sizeof(line), "%08x %c     %c ",
+			symTblEntry[i].value,
+			binding == 0 ? 'l' : (binding == 1 ? 'g' : 'w'),
+			symbolType == eSymFunc ? 'F' : (symbolType == eSymObject ? 'O' :
+				(symbolType == eSymFile ? 'f' : (symbolType == eSymSection ? 'd' : ' '))));
+		ioText.append(line);
+		ioText.append(sectionName);
+		snprintf(line, sizeof(line), "\t%08x ", symTblEntry[i].size);
+		ioText.append(line);
+		ioText.append(symbolType == eSymSection ? sectionName : &stringTable[symTblEntry[i].name]);
+		ioText += '\n';
+	}
+}
+
+/************************************ Dump ************************************/
+void AVRDisassembler::Dump(
+	const char*		inFileName,
+	std::string&	ioText,
+	uint32_t		inNumThreads) const
+{
+	ioText.append("\n");
+	ioText.append(inFileName);
+	ioText.append(":     file format elf32-avr\n");
+	DumpSections(ioText);
+	DumpSymbols(ioText);
+	Disassemble(ioText, inNumThreads);
+}
+
+/********************************* WriteFile **********************************/
+bool AVRDisassembler::WriteFile(
+	const char*	inPath,
+	const char*	inFileName,
+	uint32_t	inNumThreads) const
+{
+	bool success = false;
+	std::string	text;
+	Dump(inFileName, text, inNumThreads);
+	FILE*    file = fopen(inPath, "wb");
+	if (file)
+	{
+		success = fwrite(text.data(), 1, text.size(), file) == text.size();
+		fclose(file);
+	}
+	return(success);
+}
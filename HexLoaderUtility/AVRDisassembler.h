@@ -0,0 +1,115 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  AVRDisassembler.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+/*
+*	An in-process AVR disassembler that produces output similar to
+*	avr-objdump -h -d -t.  Branch, jump and data addresses are annotated
+*	with the symbols from .symtab.
+*
+*	Each of the 64K opcodes maps to an instruction descriptor through a
+*	decode table built once on first use.  The instruction boundaries are
+*	found in a single sequential pass, then the instructions are formatted
+*	in parallel chunks.
+*/
+#ifndef AVRDisassembler_h
+#define AVRDisassembler_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class AVRElfFile;
+
+class AVRDisassembler
+{
+public:
+							AVRDisassembler(
+								const AVRElfFile&		inElfFile);
+							~AVRDisassembler(void){}
+	/*
+	*	Appends the section headers, symbol table and the disassembly of
+	*	.text.  inFileName is used in the header.
+	*/
+	void					Dump(
+								const char*				inFileName,
+								std::string&			ioText,
+								uint32_t				inNumThreads = 0) const;
+	void					DumpSections(
+								std::string&			ioText) const;
+	void					DumpSymbols(
+								std::string&			ioText) const;
+	/*
+	*	Appends the disassembly of .text.  When inNumThreads is 0 the number
+	*	of hardware threads is used.
+	*/
+	void					Disassemble(
+								std::string&			ioText,
+								uint32_t				inNumThreads = 0) const;
+	bool					WriteFile(
+								const char*				inPath,
+								const char*				inFileName,
+								uint32_t				inNumThreads = 0) const;
+	/*
+	*	Returns the length in words (1 or 2) of the instruction.
+	*/
+	static uint32_t			InstructionLength(
+								uint16_t				inOpcode);
+	/*
+	*	Returns the mnemonic of the instruction, ".word" if the opcode isn't
+	*	an instruction.
+	*/
+	static const char*		Mnemonic(
+								uint16_t				inOpcode);
+	/*
+	*	Appends a single instruction (without the address and bytes) to ioText.
+	*	inWords must contain InstructionLength words.  inAddress is the byte
+	*	address of the instruction.  inElfFile is used to annotate addresses
+	*	and may be NULL.
+	*/
+	static void				FormatInstruction(
+								const uint16_t*			inWords,
+								uint32_t				inAddress,
+								const AVRElfFile*		inElfFile,
+								std::string&			ioText);
+protected:
+	struct SLabel
+	{
+		uint32_t	address;
+		const char*	name;
+	};
+	const AVRElfFile&		mElfFile;
+	const uint16_t*			mText;
+	uint32_t				mTextAddr;
+	uint32_t				mTextSize;		// In bytes
+	std::vector<SLabel>		mLabels;		// .text symbols sorted by address
+
+	void					DisassembleRange(
+								const uint32_t*			inInstructions,
+								uint32_t				inNumInstructions,
+								std::string&			outText) const;
+};
+
+#endif /* AVRDisassembler_h */
@@ -27,15 +27,21 @@
 //
 
 #include "AVRElfFile.h"
+#include "AVRXrefIndex.h"
+#include "Fingerprint.h"
+#include <algorithm>
 
 /******************************** AVRElfFile **********************************/
 AVRElfFile::AVRElfFile(void)
+	: mSymbolIntervalsBuilt(false), mImageFingerprintValid(false), mImageFingerprint(0),
+	  mXrefIndex(NULL)
 {
 }
 
 /******************************** ~AVRElfFile *********************************/
 AVRElfFile::~AVRElfFile(void)
 {
+	delete mXrefIndex;
 }
 
 #if 0
@@ -68,36 +74,41 @@ uint32_t AVRElfFile::JmpInstructionFor(
 
 /****************************** GetVectorIndexes ******************************/
 /*
-*	Returns the set of implemented vector indexes.
+*	Replaces outVectorIndexes with the set of implemented vector indexes.
+*	The indexes are found in ascending order so they're appended by a
+*	builder rather than set one at a time.
 */
 bool AVRElfFile::GetVectorIndexes(
-	IndexVec&	outVectorIndexes)
+	IndexVec&	outVectorIndexes) const
 {
 	bool	success = false;
-	if (mContent != NULL)
+	const SSectEntry*	textSectEntry = mContent ? GetSectEntry(eText) : NULL;
+	if (textSectEntry)
 	{
 		// Get the symbol address of __bad_interrupt
-		const SSymbolTblEntry*	symTableEntry = NULL;
-		uint8_t*	symbolValuePtr = GetSymbolValuePtr("__bad_interrupt", &symTableEntry);
-		uint8_t*	textSectMem = GetTextPtr();
-		if (symbolValuePtr && symTableEntry)
-		{
-			uint32_t	jmpBadInterrupt = JmpInstructionFor(symTableEntry->value);
-			// Now jmpBadInterrupt can be used to scan for implemented vectors.
-			// (anything that isn't jmpBadInterrupt)
-			uint32_t*	vector = (uint32_t*)textSectMem;
-			uint32_t vectorIndex = 1;
+		const SSymbolTblEntry*	symTableEntry = FindSymbol("__bad_interrupt");
+		if (symTableEntry &&
+			symTableEntry->shndx != eShndxUndef &&
+			symTableEntry->shndx < GetNumSections())
+		{
+			// Any vector that doesn't jmp to __bad_interrupt is implemented.
+			const uint16_t*	text = (const uint16_t*)GetTextPtr();
+			uint32_t	numWords = textSectEntry->size/2;
+			uint32_t	vectorIndex = 1;
+			SXref		xref;
+			IndexVecBuilder	builder;
 			// Loop as long as the instruction is jmp
 			// (not 100% bulletproof, but close enough)
-			for (; (vector[vectorIndex] & 0xFE0E) == 0x940C; vectorIndex++)
+			for (; (vectorIndex * 2) < numWords &&
+					AVRXrefIndex::Decode(text, numWords, vectorIndex * 2, xref) == 2 &&
+					xref.kind == eXrefJMP; vectorIndex++)
 			{
-				if (vector[vectorIndex] != jmpBadInterrupt)
+				if (xref.target != symTableEntry->value)
 				{
-					//fprintf(stderr, "%d ", vectorIndex);
-					outVectorIndexes.Set(vectorIndex, vectorIndex);
+					builder.Add(vectorIndex);
 				}
 			}
-			//fprintf(stderr, "\n");
+			builder.Build(outVectorIndexes);
 			success = true;
 		}
 	}
@@ -107,62 +118,414 @@ bool AVRElfFile::GetVectorIndexes(
 /***************************** ReplaceTextAddress *****************************/
 /*
 *	Replaces opcodes LDS and STS that reference inSymbolName with inNewAddress.
-*	When the address is hit in the code, the opcode preceding it is checked to
-*	see if it's an LDS or STS opcode.  If it is, the address it's replaced and the
-*	next N opcodes are checked for increments of inSymbolName's address, where
-*	N is the width of the value pointed to by the address.
+*	Any LDS or STS of an address within the symbol's value (i.e. any byte of
+*	a multibyte value) is replaced by the corresponding new address.
 */
 uint32_t AVRElfFile::ReplaceAddress(
 	const char*	inSymbolName,
 	uint16_t	inNewAddress)
 {
-	uint32_t	numAddressesReplaced = 0;
-	const SSymbolTblEntry*	symbolTblEntry = NULL;
-	GetSymbolValuePtr(inSymbolName, &symbolTblEntry);
+	SRelocation	relocation;
+	return(GetRelocation(inSymbolName, inNewAddress, relocation) ? Relocate(&relocation, 1) : 0);
+}
+
+/******************************* GetRelocation ********************************/
+bool AVRElfFile::GetRelocation(
+	const char*		inSymbolName,
+	uint16_t		inNewAddress,
+	SRelocation&	outRelocation) const
+{
+	const SSymbolTblEntry*	symbolTblEntry = FindSymbol(inSymbolName);
 	if (symbolTblEntry)
 	{
-		SSectEntry*	textSectEntry =	GetSectEntry(eText);
-		if (textSectEntry)
+		outRelocation.oldStart = (uint16_t)symbolTblEntry->value;
+		outRelocation.oldEnd = outRelocation.oldStart + (symbolTblEntry->size ? symbolTblEntry->size : 1);
+		outRelocation.newStart = inNewAddress;
+		outRelocation.patchCount = 0;
+	}
+	return(symbolTblEntry != NULL);
+}
+
+/********************************** Relocate **********************************/
+/*
+*	The LDS/STS operands of each range are found in O(log n) using the
+*	cross-reference index.  The index and the image fingerprint are
+*	discarded when anything is patched.
+*/
+uint32_t AVRElfFile::Relocate(
+	SRelocation*	ioRelocations,
+	uint32_t		inCount)
+{
+	uint32_t	numAddressesReplaced = 0;
+	SSectEntry*	textSectEntry =	GetSectEntry(eText);
+	if (inCount &&
+		textSectEntry &&
+		textSectEntry->size >= 4)
+	{
+		const AVRXrefIndex&	xrefIndex = GetXrefIndex();
+		/*
+		*	When the file is mapped the .text pages need to be made writable
+		*	(copy-on-write) before patching.
+		*/
+		if (MakeContentWritable(textSectEntry->offset, textSectEntry->size))
 		{
-			uint16_t	oldAddress = symbolTblEntry->value;
-			uint32_t	valueSize = symbolTblEntry->size;
-			uint16_t*	textSectPtr = (uint16_t*)&mContent[GetSectEntry(eText)->offset];
-			uint16_t*	textSectEnd = &textSectPtr[textSectEntry->size/2];
-			for (; textSectPtr < textSectEnd; textSectPtr++)
+			uint16_t*	textSectPtr = (uint16_t*)&mContent[textSectEntry->offset];
+			for (uint32_t i = 0; i < inCount; i++)
 			{
-				if (*textSectPtr != oldAddress)
+				SRelocation&	relocation = ioRelocations[i];
+				relocation.patchCount = 0;
+				uint32_t	count;
+				const SXref*	xref = xrefIndex.ReferencesTo(eSRAMSpace, relocation.oldStart, relocation.oldEnd, count);
+				for (; count; count--, xref++)
 				{
-					continue;
-				}
-				uint16_t	opcode = textSectPtr[-1] & 0xFE0F;
-				switch(opcode)
-				{
-					case 0x9000:	// LDS
-					case 0x9200:	// STS
+					if (xref->kind == eXrefLDS ||
+						xref->kind == eXrefSTS)
 					{
-						*textSectPtr = inNewAddress;
+						// The operand follows the opcode
+						textSectPtr[((xref->source - textSectEntry->addrInMem) / 2) + 1] =
+							relocation.newStart + (xref->target - relocation.oldStart);
+						relocation.patchCount++;
 						numAddressesReplaced++;
-						for (uint32_t k = 1; k < valueSize; k++)
-						{
-							textSectPtr+=2;
-							if (*textSectPtr == oldAddress + k)
-							{
-								opcode = textSectPtr[-1] & 0xFE0F;
-								if (opcode == 0x9000 ||
-									opcode == 0x9200)
-								{
-									*textSectPtr = inNewAddress + k;
-									continue;
-								}
-							}
-							break;
-						}
-						break;
 					}
 				}
 			}
 		}
+		if (numAddressesReplaced)
+		{
+			delete mXrefIndex;
+			mXrefIndex = NULL;
+			mImageFingerprintValid = false;
+		}
 	}
 	return(numAddressesReplaced);
 }
 
+/********************************** FreeMem ***********************************/
+void AVRElfFile::FreeMem(void)
+{
+	for (uint32_t i = 0; i < eNumAVRAddressSpaces; i++)
+	{
+		mSymbolIntervals[i].clear();
+		mSymbolLabels[i].clear();
+	}
+	mSymbolIntervalsBuilt = false;
+	mImageFingerprintValid = false;
+	delete mXrefIndex;
+	mXrefIndex = NULL;
+	ElfFile::FreeMem();
+}
+
+/******************************* GetSectionValue ******************************/
+/*
+*	Returns the content of a 1 to 4 byte section as a little endian value.
+*/
+bool AVRElfFile::GetSectionValue(
+	ESectName	inESectName,
+	uint32_t&	outValue) const
+{
+	const SSectEntry*	sectEntry = mSectEntry[inESectName];
+	bool	success = sectEntry &&
+				sectEntry->size &&
+				sectEntry->size <= 4 &&
+				((size_t)sectEntry->offset + sectEntry->size) <= mFileSize;
+	outValue = 0;
+	if (success)
+	{
+		for (uint32_t i = sectEntry->size; i; i--)
+		{
+			outValue = (outValue << 8) + mContent[sectEntry->offset + i - 1];
+		}
+	}
+	return(success);
+}
+
+/******************************* GetEEPROMImage *******************************/
+bool AVRElfFile::GetEEPROMImage(
+	std::vector<uint8_t>&	outImage,
+	uint32_t&				outImageAddr) const
+{
+	const SSectEntry*	sectEntry = mSectEntry[eEEPROM];
+	bool	success = sectEntry &&
+				sectEntry->size &&
+				AddressSpaceFor(sectEntry->addrInMem) == eEEPROMSpace &&
+				((size_t)sectEntry->offset + sectEntry->size) <= mFileSize;
+	if (success)
+	{
+		outImage.assign(&mContent[sectEntry->offset], &mContent[sectEntry->offset + sectEntry->size]);
+		outImageAddr = sectEntry->addrInMem - AddressSpaceBase(eEEPROMSpace);
+	} else
+	{
+		outImage.clear();
+		outImageAddr = 0;
+	}
+	return(success);
+}
+
+/******************************** BuildIndexes ********************************/
+void AVRElfFile::BuildIndexes(void) const
+{
+	ElfFile::BuildIndexes();
+	if (mContent &&
+		!mSymbolIntervalsBuilt)
+	{
+		BuildSymbolIntervals();
+	}
+	if (mContent)
+	{
+		GetImageFingerprint();
+		GetXrefIndex();
+	}
+}
+
+/***************************** GetImageFingerprint ****************************/
+/*
+*	The load addresses are included so that moving an image changes the
+*	fingerprint.
+*/
+uint64_t AVRElfFile::GetImageFingerprint(void) const
+{
+	if (!mImageFingerprintValid &&
+		mContent)
+	{
+		std::vector<uint8_t>	image;
+		uint32_t	imageAddr;
+		uint64_t	fingerprint = 0;
+		if (GetFlashImage(image, imageAddr))
+		{
+			fingerprint = Fingerprint::Hash(image.data(), image.size(), imageAddr);
+		}
+		if (GetEEPROMImage(image, imageAddr))
+		{
+			fingerprint = Fingerprint::Hash(image.data(), image.size(), fingerprint ^ imageAddr);
+		}
+		mImageFingerprint = fingerprint;
+		mImageFingerprintValid = true;
+	}
+	return(mImageFingerprint);
+}
+
+/******************************** GetXrefIndex ********************************/
+const AVRXrefIndex& AVRElfFile::GetXrefIndex(void) const
+{
+	if (mXrefIndex == NULL)
+	{
+		mXrefIndex = new AVRXrefIndex;
+		if (mContent)
+		{
+			mXrefIndex->Build(*this);
+		}
+	}
+	return(*mXrefIndex);
+}
+
+/****************************** AddressSpaceFor *******************************/
+EAVRAddressSpace AVRElfFile::AddressSpaceFor(
+	uint32_t	inELFAddress)
+{
+	return(inELFAddress < 0x800000 ? eFlashSpace :
+			(inELFAddress < 0x810000 ? eSRAMSpace :
+				(inELFAddress < 0x820000 ? eEEPROMSpace : eNumAVRAddressSpaces)));
+}
+
+/***************************** AddressSpaceBase *******************************/
+uint32_t AVRElfFile::AddressSpaceBase(
+	EAVRAddressSpace	inSpace)
+{
+	static const uint32_t	kSpaceBase[] = {0, 0x800000, 0x810000, 0x820000};
+	return(kSpaceBase[inSpace]);
+}
+
+/*************************** BuildSymbolIntervals *****************************/
+/*
+*	Section symbols, file symbols, and symbols not associated with a
+*	section (ABS, undefined) are skipped.
+*/
+void AVRElfFile::BuildSymbolIntervals(void) const
+{
+	uint32_t	numSymTableEntries;
+	const SSymbolTblEntry*	symbolTable = GetSymbolTable(numSymTableEntries);
+	const SSymbolTblEntry*	symbolTableEnd = &symbolTable[numSymTableEntries];
+	const char* stringTable = GetStringTable();
+	for (; symbolTable < symbolTableEnd; symbolTable++)
+	{
+		uint8_t	symbolType = symbolTable->info & 0xF;
+		if (symbolTable->shndx == eShndxUndef ||
+			symbolTable->shndx >= eShndxLoReserve ||
+			symbolType == eSymSection ||
+			symbolType == eSymFile ||
+			stringTable[symbolTable->name] == 0)
+		{
+			continue;
+		}
+		EAVRAddressSpace	space = AddressSpaceFor(symbolTable->value);
+		if (space < eNumAVRAddressSpaces)
+		{
+			SSymbolInterval	interval = {symbolTable->value, symbolTable->value + symbolTable->size, symbolTable};
+			if (symbolTable->size)
+			{
+				mSymbolIntervals[space].push_back(interval);
+			} else
+			{
+				mSymbolLabels[space].push_back(interval);
+			}
+		}
+	}
+	struct SIntervalLess
+	{
+		bool operator()(const SSymbolInterval& inA, const SSymbolInterval& inB) const
+		{
+			// Equal starts are ordered by symbol table position (first defined wins)
+			return(inA.start < inB.start ||
+				(inA.start == inB.start && inA.symTblEntry < inB.symTblEntry));
+		}
+	};
+	for (uint32_t i = 0; i < eNumAVRAddressSpaces; i++)
+	{
+		std::sort(mSymbolIntervals[i].begin(), mSymbolIntervals[i].end(), SIntervalLess());
+		std::sort(mSymbolLabels[i].begin(), mSymbolLabels[i].end(), SIntervalLess());
+	}
+	mSymbolIntervalsBuilt = true;
+}
+
+/******************************** FindInterval ********************************/
+/*
+*	Returns the first of the intervals with the greatest start <= inELFAddress,
+*	or NULL if all intervals start after inELFAddress.
+*/
+const SSymbolInterval* AVRElfFile::FindInterval(
+	const SymbolIntervals&	inIntervals,
+	uint32_t				inELFAddress)
+{
+	const SSymbolInterval*	interval = NULL;
+	size_t	leftIndex = 0;
+	size_t	rightIndex = inIntervals.size();
+	// Find the first interval that starts after inELFAddress
+	while (leftIndex < rightIndex)
+	{
+		size_t	current = (leftIndex + rightIndex) / 2;
+		if (inIntervals[current].start > inELFAddress)
+		{
+			rightIndex = current;
+		} else
+		{
+			leftIndex = current + 1;
+		}
+	}
+	if (leftIndex)
+	{
+		interval = &inIntervals[leftIndex-1];
+		// Back up to the first interval with this start
+		while (interval > &inIntervals[0] &&
+			interval[-1].start == interval->start)
+		{
+			interval--;
+		}
+	}
+	return(interval);
+}
+
+/****************************** SymbolForAddress ******************************/
+const SSymbolTblEntry* AVRElfFile::SymbolForAddress(
+	uint32_t			inAddress,
+	EAVRAddressSpace	inSpace,
+	uint32_t*			outOffset) const
+{
+	const SSymbolTblEntry*	symTblEntry = NULL;
+	if (mContent &&
+		inSpace < eNumAVRAddressSpaces)
+	{
+		if (!mSymbolIntervalsBuilt)
+		{
+			BuildSymbolIntervals();
+		}
+		uint32_t	elfAddress = inAddress + AddressSpaceBase(inSpace);
+		const SSymbolInterval*	interval = FindInterval(mSymbolIntervals[inSpace], elfAddress);
+		if (!interval ||
+			elfAddress >= interval->end)
+		{
+			/*
+			*	Use the closest preceding label only if it follows the end
+			*	of the closest preceding sized symbol.
+			*/
+			uint32_t	precedingEnd = interval ? interval->end : 0;
+			interval = FindInterval(mSymbolLabels[inSpace], elfAddress);
+			if (interval &&
+				interval->start < precedingEnd)
+			{
+				interval = NULL;
+			}
+		}
+		if (interval)
+		{
+			symTblEntry = interval->symTblEntry;
+			if (outOffset)
+			{
+				*outOffset = elfAddress - interval->start;
+			}
+		}
+	}
+	return(symTblEntry);
+}
+
+/******************************** Symbolicate *********************************/
+uint32_t AVRElfFile::Symbolicate(
+	const uint32_t*		inAddresses,
+	uint32_t			inCount,
+	EAVRAddressSpace	inSpace,
+	SSymbolication*		outResults) const
+{
+	uint32_t	numResolved = 0;
+	const char* stringTable = mContent ? GetStringTable() : NULL;
+	for (uint32_t i = 0; i < inCount; i++)
+	{
+		SSymbolication&	result = outResults[i];
+		result.offset = 0;
+		result.symTblEntry = SymbolForAddress(inAddresses[i], inSpace, &result.offset);
+		if (result.symTblEntry)
+		{
+			result.name = &stringTable[result.symTblEntry->name];
+			numResolved++;
+		} else
+		{
+			result.name = NULL;
+		}
+	}
+	return(numResolved);
+}
+
+/******************************* GetLoadAddress *******************************/
+/*
+*	The initial values of the .data section are stored in flash following
+*	.text and copied to SRAM at startup.  The program header for the segment
+*	containing the symbol maps its SRAM (virtual) address to its flash
+*	(physical) address.  If there are no program headers, the .data section
+*	is assumed to immediately follow the .text section.
+*/
+uint32_t AVRElfFile::GetLoadAddress(
+	const SSymbolTblEntry*	inSymTblEntry) const
+{
+	uint32_t	address = inSymTblEntry->value;
+	if (AddressSpaceFor(address) == eSRAMSpace)
+	{
+		uint16_t	numProgEntries = GetNumProgEntries();
+		for (uint16_t i = 0; i < numProgEntries; i++)
+		{
+			const SProgEntry*	progEntry = GetProgEntry(i);
+			if (progEntry->type == eProgLoad &&
+				address >= progEntry->virtualAddr &&
+				address < (progEntry->virtualAddr + progEntry->sizeOnFile))
+			{
+				return(progEntry->physicalAddr + address - progEntry->virtualAddr);
+			}
+		}
+		const SSectEntry*	dataSect = mSectEntry[eData];
+		const SSectEntry*	textSect = mSectEntry[eText];
+		if (dataSect && textSect &&
+			address >= dataSect->addrInMem &&
+			address < (dataSect->addrInMem + dataSect->size))
+		{
+			address = textSect->addrInMem + textSect->size + address - dataSect->addrInMem;
+		}
+	}
+	return(address);
+}
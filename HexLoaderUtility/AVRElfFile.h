@@ -32,6 +32,8 @@
 #include "ElfFile.h"
 #include "IndexVec.h"
 
+class AVRXrefIndex;
+
 // The following struct was copied from:
 // https://www.eit.lth.se/fileadmin/eit/courses/edi021/Avr-libc-2.0.0/mem_sections.html
 
@@ -68,6 +70,48 @@ struct SAVRDeviceInfo
 	} avr;
 };
 #endif
+/*
+*	avr-gcc places each memory in its own range of the ELF address space.
+*	Addresses passed to and returned from the Symbolicate routines are the
+*	device addresses (i.e. without the range base.)
+*/
+enum EAVRAddressSpace
+{
+	eFlashSpace,
+	eSRAMSpace,
+	eEEPROMSpace,
+	eNumAVRAddressSpaces
+};
+
+struct SSymbolInterval
+{
+	uint32_t				start;	// ELF address
+	uint32_t				end;	// start + size
+	const SSymbolTblEntry*	symTblEntry;
+};
+
+typedef std::vector<SSymbolInterval> SymbolIntervals;
+
+struct SSymbolication
+{
+	const SSymbolTblEntry*	symTblEntry;	// NULL if the address wasn't resolved
+	const char*				name;
+	uint32_t				offset;			// Offset of the address from the symbol's start
+};
+
+/*
+*	An SRAM range to relocate.  LDS/STS operands within [oldStart, oldEnd)
+*	are moved to newStart + (operand - oldStart).  patchCount is set to the
+*	number of operands replaced.
+*/
+struct SRelocation
+{
+	uint16_t	oldStart;
+	uint16_t	oldEnd;
+	uint16_t	newStart;
+	uint32_t	patchCount;
+};
+
 class AVRElfFile : public ElfFile
 {
 public:
@@ -75,7 +119,7 @@ public:
 	virtual					~AVRElfFile(void);
 //	const SAVRDeviceInfo*	GetAVRDeviceInfo(void) const;
 	bool					GetVectorIndexes(
-								IndexVec&				outVectorIndexes);
+								IndexVec&				outVectorIndexes) const;
 	uint32_t				GetFlashUsed(void) const
 							{ return(mSectEntry[eData]->size + mSectEntry[eText]->size); }
 	uint32_t				GetDataSize(void) const
@@ -85,6 +129,118 @@ public:
 	uint32_t				ReplaceAddress(
 								const char*				inSymbolName,
 								uint16_t				inNewAddress);
+	/*
+	*	Relocates the LDS/STS operands of all of the ranges using the
+	*	cross-reference index.  The ranges must not overlap.  Returns the
+	*	total number of operands replaced.
+	*/
+	uint32_t				Relocate(
+								SRelocation*			ioRelocations,
+								uint32_t				inCount);
+	/*
+	*	Sets outRelocation to move the SRAM symbol to inNewAddress.
+	*/
+	bool					GetRelocation(
+								const char*				inSymbolName,
+								uint16_t				inNewAddress,
+								SRelocation&			outRelocation) const;
+	virtual void			FreeMem(void);
+	virtual void			BuildIndexes(void) const;
+	/*
+	*	Returns the flash image (.text followed by the .data initial values)
+	*	as it should be programmed.  outImageAddr is the flash address of
+	*	outImage[0], normally 0.
+	*/
+	bool					GetFlashImage(
+								std::vector<uint8_t>&	outImage,
+								uint32_t&				outImageAddr) const
+								{return(GetLoadImage(0, 0x800000, outImage, outImageAddr));}
+	/*
+	*	Returns the symbol containing inAddress within inSpace.  If no sized
+	*	symbol contains the address, the closest preceding label is returned.
+	*	Returns NULL if the address can't be resolved.
+	*/
+	const SSymbolTblEntry*	SymbolForAddress(
+								uint32_t				inAddress,
+								EAVRAddressSpace		inSpace,
+								uint32_t*				outOffset = NULL) const;
+	/*
+	*	Resolves inCount addresses, each in O(log n).  outResults must have
+	*	room for inCount entries.  Returns the number of addresses resolved.
+	*/
+	uint32_t				Symbolicate(
+								const uint32_t*			inAddresses,
+								uint32_t				inCount,
+								EAVRAddressSpace		inSpace,
+								SSymbolication*			outResults) const;
+	/*
+	*	Returns the flash (load) address of the symbol.  For .data symbols
+	*	this is the address of the symbol's initial value within the flash
+	*	image, else it's the symbol's value.
+	*/
+	uint32_t				GetLoadAddress(
+								const SSymbolTblEntry*	inSymTblEntry) const;
+	/*
+	*	The fuse, lock and signature values declared in the sketch using the
+	*	avr-libc FUSES, LOCKBITS and SIGNATURE macros.  Each returns false if
+	*	the sketch doesn't declare the value (no such section.)
+	*
+	*	GetFuses returns the fuse bytes merged as (extended<<16) +
+	*	(high<<8) + low, the layout of the exported "fuses" config value.
+	*	GetSignature returns the signature as (SIGNATURE_0<<16) +
+	*	(SIGNATURE_1<<8) + SIGNATURE_2, e.g. 0x1E950F for the ATmega328P.
+	*/
+	bool					GetFuses(
+								uint32_t&				outFuses) const
+								{return(GetSectionValue(eFuse, outFuses));}
+	bool					GetLockBits(
+								uint32_t&				outLockBits) const
+								{return(GetSectionValue(eLock, outLockBits));}
+	bool					GetSignature(
+								uint32_t&				outSignature) const
+								{return(GetSectionValue(eSignature, outSignature));}
+	/*
+	*	Returns the initial EEPROM content (the .eeprom section, EEMEM
+	*	variables.)  outImageAddr is the EEPROM address of outImage[0].
+	*	Returns false if the sketch has no EEPROM content.
+	*/
+	bool					GetEEPROMImage(
+								std::vector<uint8_t>&	outImage,
+								uint32_t&				outImageAddr) const;
+	/*
+	*	Returns the fingerprint of the flash and EEPROM images.  It's
+	*	computed once, by BuildIndexes or on the first call.
+	*/
+	uint64_t				GetImageFingerprint(void) const;
+	/*
+	*	Returns the cross-reference index of .text.  It's built once, by
+	*	BuildIndexes or on the first call, and rebuilt after a Relocate.
+	*/
+	const AVRXrefIndex&		GetXrefIndex(void) const;
+	static EAVRAddressSpace	AddressSpaceFor(
+								uint32_t				inELFAddress);
+	static uint32_t			AddressSpaceBase(
+								EAVRAddressSpace		inSpace);
+protected:
+	/*
+	*	Per address space, sorted by start.  mSymbolIntervals contains the
+	*	sized symbols, mSymbolLabels contains the zero sized symbols.  Built
+	*	on the first address lookup.
+	*/
+	mutable SymbolIntervals	mSymbolIntervals[eNumAVRAddressSpaces];
+	mutable SymbolIntervals	mSymbolLabels[eNumAVRAddressSpaces];
+	mutable bool			mSymbolIntervalsBuilt;
+	mutable bool			mImageFingerprintValid;
+	mutable uint64_t		mImageFingerprint;
+	mutable AVRXrefIndex*	mXrefIndex;		// NULL until built
+
+	void					BuildSymbolIntervals(void) const;
+	bool					GetSectionValue(
+								ESectName				inESectName,
+								uint32_t&				outValue) const;
+	static const SSymbolInterval* FindInterval(
+								const SymbolIntervals&	inIntervals,
+								uint32_t				inELFAddress);
 };
 
 #endif /* AVRElfFile_h */
@@ -0,0 +1,1288 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  AVRSimulator.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#include "AVRSimulator.h"
+#include "AVRDisassembler.h"
+#include "AVRElfFile.h"
+#include <algorithm>
+#include <string.h>
+
+const uint64_t	AVRSimulator::kNever = 0xFFFFFFFFFFFFFFFFULL;
+const uint32_t	AVRSimulator::kDefaultStackSize = 256;
+
+enum EOp
+{
+	eOpInvalid,
+	eOpNop,
+	eOpMovw,
+	eOpMuls,
+	eOpMulsu,
+	eOpFmul,
+	eOpFmuls,
+	eOpFmulsu,
+	eOpCpc,
+	eOpSbc,
+	eOpAdd,
+	eOpCpse,
+	eOpCp,
+	eOpSub,
+	eOpAdc,
+	eOpAnd,
+	eOpEor,
+	eOpOr,
+	eOpMov,
+	eOpCpi,
+	eOpSbci,
+	eOpSubi,
+	eOpOri,
+	eOpAndi,
+	eOpLdd,			// r is the pointer register, k the displacement
+	eOpStd,
+	eOpLds,
+	eOpSts,
+	eOpLd,			// r is the pointer register, k 0, 1 post increment, -1 pre decrement
+	eOpSt,
+	eOpLpm,			// k 1 post increment
+	eOpElpm,
+	eOpPop,
+	eOpPush,
+	eOpXch,
+	eOpLas,
+	eOpLac,
+	eOpLat,
+	eOpCom,
+	eOpNeg,
+	eOpSwap,
+	eOpInc,
+	eOpAsr,
+	eOpLsr,
+	eOpRor,
+	eOpDec,
+	eOpBset,		// d is the SREG bit
+	eOpBclr,
+	eOpIjmp,
+	eOpEijmp,
+	eOpRet,
+	eOpIcall,
+	eOpReti,
+	eOpEicall,
+	eOpSleep,
+	eOpBreak,
+	eOpWdr,
+	eOpSpm,
+	eOpJmp,			// k is the target word
+	eOpCall,
+	eOpAdiw,
+	eOpSbiw,
+	eOpCbi,			// d is the data address, r the bit
+	eOpSbic,
+	eOpSbi,
+	eOpSbis,
+	eOpMul,
+	eOpIn,			// r is the data address
+	eOpOut,			// d is the data address
+	eOpRjmp,
+	eOpRcall,
+	eOpLdi,
+	eOpBrbs,		// r is the SREG bit
+	eOpBrbc,
+	eOpBld,
+	eOpBst,
+	eOpSbrc,
+	eOpSbrs,
+	eOpReturned,	// The return address pushed by Call
+	eOpBadPC,
+	eOpBreakpoint
+};
+
+struct SMnemonicOp
+{
+	const char*	mnemonic;
+	uint8_t		op;
+};
+
+/*
+*	Sorted by mnemonic.  The SREG bit and pointer variants are resolved from
+*	the opcode.
+*/
+static const SMnemonicOp	kMnemonicOps[] =
+{
+	{"adc", eOpAdc}, {"add", eOpAdd}, {"adiw", eOpAdiw}, {"and", eOpAnd},
+	{"andi", eOpAndi}, {"asr", eOpAsr}, {"bld", eOpBld},
+	{"brcc", eOpBrbc}, {"brcs", eOpBrbs}, {"break", eOpBreak}, {"breq", eOpBrbs},
+	{"brge", eOpBrbc}, {"brhc", eOpBrbc}, {"brhs", eOpBrbs}, {"brid", eOpBrbc},
+	{"brie", eOpBrbs}, {"brlt", eOpBrbs}, {"brmi", eOpBrbs}, {"brne", eOpBrbc},
+	{"brpl", eOpBrbc}, {"brtc", eOpBrbc}, {"brts", eOpBrbs}, {"brvc", eOpBrbc},
+	{"brvs", eOpBrbs}, {"bst", eOpBst}, {"call", eOpCall}, {"cbi", eOpCbi},
+	{"clc", eOpBclr}, {"clh", eOpBclr}, {"cli", eOpBclr}, {"cln", eOpBclr},
+	{"cls", eOpBclr}, {"clt", eOpBclr}, {"clv", eOpBclr}, {"clz", eOpBclr},
+	{"com", eOpCom}, {"cp", eOpCp}, {"cpc", eOpCpc}, {"cpi", eOpCpi},
+	{"cpse", eOpCpse}, {"dec", eOpDec}, {"eicall", eOpEicall}, {"eijmp", eOpEijmp},
+	{"elpm", eOpElpm}, {"eor", eOpEor}, {"fmul", eOpFmul}, {"fmuls", eOpFmuls},
+	{"fmulsu", eOpFmulsu}, {"icall", eOpIcall}, {"ijmp", eOpIjmp}, {"in", eOpIn},
+	{"inc", eOpInc}, {"jmp", eOpJmp}, {"lac", eOpLac}, {"las", eOpLas},
+	{"lat", eOpLat}, {"ld", eOpLd}, {"ldd", eOpLdd}, {"ldi", eOpLdi},
+	{"lds", eOpLds}, {"lpm", eOpLpm}, {"lsr", eOpLsr}, {"mov", eOpMov},
+	{"movw", eOpMovw}, {"mul", eOpMul}, {"muls", eOpMuls}, {"mulsu", eOpMulsu},
+	{"neg", eOpNeg}, {"nop", eOpNop}, {"or", eOpOr}, {"ori", eOpOri},
+	{"out", eOpOut}, {"pop", eOpPop}, {"push", eOpPush}, {"rcall", eOpRcall},
+	{"ret", eOpRet}, {"reti", eOpReti}, {"rjmp", eOpRjmp}, {"ror", eOpRor},
+	{"sbc", eOpSbc}, {"sbci", eOpSbci}, {"sbi", eOpSbi}, {"sbic", eOpSbic},
+	{"sbis", eOpSbis}, {"sbiw", eOpSbiw}, {"sbrc", eOpSbrc}, {"sbrs", eOpSbrs},
+	{"sec", eOpBset}, {"seh", eOpBset}, {"sei", eOpBset}, {"sen", eOpBset},
+	{"ses", eOpBset}, {"set", eOpBset}, {"sev", eOpBset}, {"sez", eOpBset},
+	{"sleep", eOpSleep}, {"spm", eOpSpm}, {"st", eOpSt}, {"std", eOpStd},
+	{"sts", eOpSts}, {"sub", eOpSub}, {"subi", eOpSubi}, {"swap", eOpSwap},
+	{"wdr", eOpWdr}, {"xch", eOpXch}
+};
+
+/*
+*	Maps each opcode to its EOp, built once on first use.
+*/
+struct SOpTable
+{
+	uint8_t	op[0x10000];
+	SOpTable(void)
+	{
+		const SMnemonicOp*	mnemonicOpsEnd = &kMnemonicOps[sizeof(kMnemonicOps)/sizeof(SMnemonicOp)];
+		for (uint32_t opcode = 0; opcode < 0x10000; opcode++)
+		{
+			const char*	mnemonic = AVRDisassembler::Mnemonic((uint16_t)opcode);
+			const SMnemonicOp*	entry = std::lower_bound(kMnemonicOps, mnemonicOpsEnd, mnemonic,
+				[](const SMnemonicOp& inEntry, const char* inMnemonic){return(strcmp(inEntry.mnemonic, inMnemonic) < 0);});
+			op[opcode] = (entry != mnemonicOpsEnd && strcmp(entry->mnemonic, mnemonic) == 0) ?
+				entry->op : (uint8_t)eOpInvalid;
+		}
+	}
+};
+
+static const SOpTable& OpTable(void)
+{
+	static const SOpTable	sOpTable;
+	return(sOpTable);
+}
+
+enum ESREGBit
+{
+	eSREG_C = 0x01,
+	eSREG_Z = 0x02,
+	eSREG_N = 0x04,
+	eSREG_V = 0x08,
+	eSREG_S = 0x10,
+	eSREG_H = 0x20,
+	eSREG_T = 0x40,
+	eSREG_I = 0x80
+};
+
+/********************************** SetNZS ************************************/
+/*
+*	Sets N and Z from the result and S from N ^ V.  V must already be set.
+*/
+static inline uint8_t SetNZS(
+	uint8_t	inSREG,
+	uint8_t	inResult)
+{
+	uint8_t	sreg = inSREG & ~(eSREG_N | eSREG_Z | eSREG_S);
+	if (inResult & 0x80)
+	{
+		sreg |= eSREG_N;
+	}
+	if (inResult == 0)
+	{
+		sreg |= eSREG_Z;
+	}
+	if (((sreg >> 2) ^ (sreg >> 3)) & 1)
+	{
+		sreg |= eSREG_S;
+	}
+	return(sreg);
+}
+
+/********************************* AddFlags ***********************************/
+static inline uint8_t AddFlags(
+	uint8_t	inSREG,
+	uint8_t	inD,
+	uint8_t	inR,
+	uint8_t	inResult)
+{
+	uint8_t	carries = (inD & inR) | (inR & ~inResult) | (~inResult & inD);
+	uint8_t	sreg = inSREG & ~(eSREG_C | eSREG_V | eSREG_H);
+	sreg |= ((carries >> 7) & 1) | ((carries << 2) & eSREG_H) |
+			((((inD & inR & ~inResult) | (~inD & ~inR & inResult)) >> 4) & eSREG_V);
+	return(SetNZS(sreg, inResult));
+}
+
+/********************************* SubFlags ***********************************/
+/*
+*	inKeepZ is used by the with carry forms, Z is only kept (not set) when
+*	the result is 0.
+*/
+static inline uint8_t SubFlags(
+	uint8_t	inSREG,
+	uint8_t	inD,
+	uint8_t	inR,
+	uint8_t	inResult,
+	bool	inKeepZ)
+{
+	uint8_t	borrows = (~inD & inR) | (inR & inResult) | (inResult & ~inD);
+	uint8_t	sreg = inSREG & ~(eSREG_C | eSREG_V | eSREG_H);
+	sreg |= ((borrows >> 7) & 1) | ((borrows << 2) & eSREG_H) |
+			((((inD & ~inR & ~inResult) | (~inD & inR & inResult)) >> 4) & eSREG_V);
+	bool	zero = inKeepZ ? (inResult == 0 && (inSREG & eSREG_Z)) : inResult == 0;
+	sreg = SetNZS(sreg, inResult);
+	return(zero ? (sreg | eSREG_Z) : (sreg & ~eSREG_Z));
+}
+
+/******************************** LogicFlags **********************************/
+static inline uint8_t LogicFlags(
+	uint8_t	inSREG,
+	uint8_t	inResult)
+{
+	return(SetNZS(inSREG & ~eSREG_V, inResult));
+}
+
+/******************************** ShiftFlags **********************************/
+/*
+*	asr, lsr and ror: C is bit 0 of the operand and V is N ^ C.
+*/
+static inline uint8_t ShiftFlags(
+	uint8_t	inSREG,
+	uint8_t	inD,
+	uint8_t	inResult)
+{
+	uint8_t	sreg = inSREG & ~(eSREG_C | eSREG_V);
+	sreg |= inD & 1;
+	if (((inResult >> 7) ^ inD) & 1)
+	{
+		sreg |= eSREG_V;
+	}
+	return(SetNZS(sreg, inResult));
+}
+
+/******************************** MulFlags ************************************/
+static inline uint8_t MulFlags(
+	uint8_t		inSREG,
+	uint16_t	inProduct,
+	uint16_t	inResult)
+{
+	uint8_t	sreg = inSREG & ~(eSREG_C | eSREG_Z);
+	sreg |= (inProduct >> 15) & 1;
+	if (inResult == 0)
+	{
+		sreg |= eSREG_Z;
+	}
+	return(sreg);
+}
+
+/******************************** IAVRPeripheral ******************************/
+uint64_t IAVRPeripheral::Update(
+	AVRSimulator&	/*ioSimulator*/,
+	uint64_t		/*inCycles*/)
+{
+	return(AVRSimulator::kNever);
+}
+
+/********************************* AVRTimerStub *******************************/
+uint64_t AVRTimerStub::Update(
+	AVRSimulator&	ioSimulator,
+	uint64_t		inCycles)
+{
+	ioSimulator.RaiseInterrupt(mVectorIndex);
+	return(mPeriod ? inCycles + mPeriod : AVRSimulator::kNever);
+}
+
+/******************************** AVRSimulator ********************************/
+AVRSimulator::AVRSimulator(
+	const AVRElfFile&	inElfFile,
+	EAVRCore			inCore,
+	bool				inHas22BitPC,
+	uint32_t			inFCPU,
+	uint16_t			inRAMEnd)
+	: mCore(inCore), mHas22BitPC(inHas22BitPC), mFCPU(inFCPU), mRAMEnd(inRAMEnd),
+	  mVectorWords(1), mNumWords(0), mData(0x10000), mNumPending(0), mPC(0),
+	  mCycles(0), mInstructionCount(0), mCheckCycle(0), mNextUpdate(kNever),
+	  mInterruptHoldoff(false), mCallActive(false), mResumeAtBreakpoint(false),
+	  mStopReason(eStopNone)
+{
+	/*
+	*	XMEGA doesn't map the registers into the data space, the I/O
+	*	registers start at 0.
+	*/
+	mIOOffset = inCore == eAVRxm ? 0 : 0x20;
+	mSREGAddr = mIOOffset + 0x3F;
+	mSPAddr = mIOOffset + 0x3D;
+	mInterruptCycles = AVRCycleAnalyzer::InterruptResponseCycles(inCore, inHas22BitPC);
+	memset(mIOHandler, 0, sizeof(mIOHandler));
+	std::vector<uint8_t>	image;
+	uint32_t	imageAddr;
+	if (inElfFile.GetFlashImage(image, imageAddr) &&
+		!image.empty())
+	{
+		// The flash below imageAddr is erased.
+		mFlash.assign(imageAddr, 0xFF);
+		mFlash.insert(mFlash.end(), image.begin(), image.end());
+		if (mFlash.size() & 1)
+		{
+			mFlash.push_back(0xFF);
+		}
+		mNumWords = (uint32_t)(mFlash.size()/2);
+		Decode();
+	}
+	if (mRAMEnd == 0)
+	{
+		const SSectEntry*	dataSectEntry = inElfFile.GetSectEntry(eData);
+		const SSectEntry*	bssSectEntry = inElfFile.GetSectEntry(eBSS);
+		uint32_t	sramStart = dataSectEntry ? (dataSectEntry->addrInMem & 0xFFFF) : 0x100;
+		uint32_t	dataSize = (dataSectEntry ? dataSectEntry->size : 0) + (bssSectEntry ? bssSectEntry->size : 0);
+		uint32_t	ramEnd = sramStart + dataSize + kDefaultStackSize - 1;
+		mRAMEnd = ramEnd < 0xFFFF ? (uint16_t)ramEnd : 0xFFFF;
+	}
+	Reset();
+}
+
+/*********************************** Decode ***********************************/
+/*
+*	Decodes each flash word as an opcode, including the operand words of 32
+*	bit instructions (which are never executed unless jumped to.)
+*/
+void AVRSimulator::Decode(void)
+{
+	const SOpTable&	opTable = OpTable();
+	const uint16_t*	words = (const uint16_t*)mFlash.data();
+	mDecoded.resize(mNumWords + 2);
+	for (uint32_t pc = 0; pc < mNumWords; pc++)
+	{
+		uint16_t	opcode = words[pc];
+		uint16_t	nextWord = (pc + 1) < mNumWords ? words[pc + 1] : 0;
+		SDecoded&	decoded = mDecoded[pc];
+		decoded.op = opTable.op[opcode];
+		decoded.d = (opcode >> 4) & 0x1F;
+		decoded.r = (opcode & 0xF) | ((opcode >> 5) & 0x10);
+		decoded.cycles = (uint8_t)AVRCycleAnalyzer::InstructionCycles(opcode, mCore, mHas22BitPC);
+		decoded.k = 0;
+		uint32_t	length = AVRDisassembler::InstructionLength(opcode);
+		if ((pc + length) > mNumWords)
+		{
+			decoded.op = eOpInvalid;
+		}
+		switch (decoded.op)
+		{
+			case eOpMovw:
+				decoded.d = ((opcode >> 4) & 0xF) * 2;
+				decoded.r = (opcode & 0xF) * 2;
+				break;
+			case eOpMuls:
+				decoded.d = 16 + ((opcode >> 4) & 0xF);
+				decoded.r = 16 + (opcode & 0xF);
+				break;
+			case eOpMulsu:
+			case eOpFmul:
+			case eOpFmuls:
+			case eOpFmulsu:
+				decoded.d = 16 + ((opcode >> 4) & 7);
+				decoded.r = 16 + (opcode & 7);
+				break;
+			case eOpCpi:
+			case eOpSbci:
+			case eOpSubi:
+			case eOpOri:
+			case eOpAndi:
+			case eOpLdi:
+				decoded.d = 16 + ((opcode >> 4) & 0xF);
+				decoded.k = (opcode & 0xF) | ((opcode >> 4) & 0xF0);
+				break;
+			case eOpLdd:
+			case eOpStd:
+				decoded.r = (opcode & 8) ? 28 : 30;
+				decoded.k = (opcode & 7) | ((opcode >> 7) & 0x18) | ((opcode >> 8) & 0x20);
+				break;
+			case eOpLds:
+			case eOpSts:
+				decoded.k = nextWord;
+				break;
+			case eOpLd:
+			case eOpSt:
+			{
+				static const uint8_t	kPointer[] = {0, 30, 30, 0, 0, 0, 0, 0, 0, 28, 28, 0, 26, 26, 26, 0};
+				static const int8_t		kMode[] = {0, 1, -1, 0, 0, 0, 0, 0, 0, 1, -1, 0, 0, 1, -1, 0};
+				decoded.r = kPointer[opcode & 0xF];
+				decoded.k = kMode[opcode & 0xF];
+				break;
+			}
+			case eOpLpm:
+			case eOpElpm:
+				if ((opcode & 0xFE00) == 0x9400)
+				{
+					// lpm, elpm (r0, Z)
+					decoded.d = 0;
+				} else
+				{
+					decoded.k = opcode & 1;
+				}
+				break;
+			case eOpBset:
+			case eOpBclr:
+				decoded.d = 1 << ((opcode >> 4) & 7);
+				break;
+			case eOpSpm:
+			case eOpBreak:
+			case eOpSleep:
+			case eOpWdr:
+			case eOpNop:
+				break;
+			case eOpJmp:
+			case eOpCall:
+				decoded.k = (((((opcode >> 3) & 0x3E) | (opcode & 1)) << 16) | nextWord);
+				break;
+			case eOpAdiw:
+			case eOpSbiw:
+				decoded.d = 24 + ((opcode >> 4) & 3) * 2;
+				decoded.k = (opcode & 0xF) | ((opcode >> 2) & 0x30);
+				break;
+			case eOpCbi:
+			case eOpSbic:
+			case eOpSbi:
+			case eOpSbis:
+				decoded.d = ((opcode >> 3) & 0x1F) + mIOOffset;
+				decoded.r = opcode & 7;
+				break;
+			case eOpIn:
+				decoded.r = ((opcode & 0xF) | ((opcode >> 5) & 0x30)) + mIOOffset;
+				break;
+			case eOpOut:
+				decoded.r = decoded.d;
+				decoded.d = ((opcode & 0xF) | ((opcode >> 5) & 0x30)) + mIOOffset;
+				break;
+			case eOpRjmp:
+			case eOpRcall:
+				decoded.k = (int32_t)pc + 1 + (((int16_t)(opcode << 4)) >> 4);
+				break;
+			case eOpBrbs:
+			case eOpBrbc:
+				decoded.r = 1 << (opcode & 7);
+				decoded.k = (int32_t)pc + 1 + (((int16_t)(opcode << 6)) >> 9);
+				break;
+			case eOpBld:
+			case eOpBst:
+			case eOpSbrc:
+			case eOpSbrs:
+				decoded.r = 1 << (opcode & 7);
+				break;
+			default:
+				break;
+		}
+		switch (decoded.op)
+		{
+			case eOpCpse:
+			case eOpSbic:
+			case eOpSbis:
+			case eOpSbrc:
+			case eOpSbrs:
+				// The number of words skipped
+				decoded.k = (pc + 1) < mNumWords ? AVRDisassembler::InstructionLength(nextWord) : 1;
+				break;
+			case eOpJmp:
+			case eOpCall:
+			case eOpRjmp:
+			case eOpRcall:
+			case eOpBrbs:
+			case eOpBrbc:
+				if (decoded.k < 0 ||
+					(uint32_t)decoded.k >= mNumWords)
+				{
+					decoded.k = mNumWords + 1;
+				}
+				break;
+		}
+	}
+	SDecoded	returned = {eOpReturned, 0, 0, 0, 0};
+	SDecoded	badPC = {eOpBadPC, 0, 0, 0, 0};
+	mDecoded[mNumWords] = returned;
+	mDecoded[mNumWords + 1] = badPC;
+	/*
+	*	Small devices use rjmp vectors.
+	*/
+	mVectorWords = (mNumWords > 1 && mDecoded[0].op == eOpJmp) ? 2 : 1;
+	for (std::map<uint32_t, uint8_t>::iterator itr = mBreakpoints.begin(); itr != mBreakpoints.end(); ++itr)
+	{
+		itr->second = mDecoded[itr->first].op;
+		mDecoded[itr->first].op = eOpBreakpoint;
+	}
+}
+
+/*********************************** Reset ************************************/
+void AVRSimulator::Reset(void)
+{
+	memset(mR, 0, sizeof(mR));
+	std::fill(mData.begin(), mData.end(), 0);
+	mData[mSPAddr] = (uint8_t)mRAMEnd;
+	mData[mSPAddr + 1] = (uint8_t)(mRAMEnd >> 8);
+	mPending[0] = mPending[1] = 0;
+	mNumPending = 0;
+	mPC = 0;
+	mCycles = 0;
+	mInstructionCount = 0;
+	mCheckCycle = 0;
+	mInterruptHoldoff = false;
+	mCallActive = false;
+	mResumeAtBreakpoint = false;
+	mStopReason = eStopNone;
+	mNextUpdate = kNever;
+	for (SPeripheral& peripheral : mPeripherals)
+	{
+		peripheral.nextUpdate = peripheral.firstUpdate;
+		mNextUpdate = std::min(mNextUpdate, peripheral.firstUpdate);
+	}
+}
+
+/******************************** SetBreakpoint *******************************/
+bool AVRSimulator::SetBreakpoint(
+	uint32_t	inAddress)
+{
+	uint32_t	pc = inAddress/2;
+	bool	success = pc < mNumWords;
+	if (success &&
+		mDecoded[pc].op != eOpBreakpoint)
+	{
+		mBreakpoints[pc] = mDecoded[pc].op;
+		mDecoded[pc].op = eOpBreakpoint;
+	}
+	return(success);
+}
+
+/******************************* ClearBreakpoint ******************************/
+void AVRSimulator::ClearBreakpoint(
+	uint32_t	inAddress)
+{
+	std::map<uint32_t, uint8_t>::iterator	itr = mBreakpoints.find(inAddress/2);
+	if (itr != mBreakpoints.end())
+	{
+		mDecoded[itr->first].op = itr->second;
+		mBreakpoints.erase(itr);
+	}
+}
+
+/****************************** ClearBreakpoints ******************************/
+void AVRSimulator::ClearBreakpoints(void)
+{
+	for (std::map<uint32_t, uint8_t>::iterator itr = mBreakpoints.begin(); itr != mBreakpoints.end(); ++itr)
+	{
+		mDecoded[itr->first].op = itr->second;
+	}
+	mBreakpoints.clear();
+}
+
+/******************************** SetIOHandler ********************************/
+void AVRSimulator::SetIOHandler(
+	uint16_t		inAddress,
+	IAVRPeripheral*	inPeripheral)
+{
+	if (inAddress < 0x100)
+	{
+		mIOHandler[inAddress] = inPeripheral;
+	}
+}
+
+/******************************** AddPeripheral *******************************/
+void AVRSimulator::AddPeripheral(
+	IAVRPeripheral*	inPeripheral,
+	uint64_t		inFirstUpdate)
+{
+	SPeripheral	peripheral = {inPeripheral, inFirstUpdate, inFirstUpdate};
+	mPeripherals.push_back(peripheral);
+	mNextUpdate = std::min(mNextUpdate, inFirstUpdate);
+	mCheckCycle = 0;
+}
+
+/****************************** UpdatePeripherals *****************************/
+void AVRSimulator::UpdatePeripherals(void)
+{
+	uint64_t	nextUpdate = kNever;
+	for (SPeripheral& peripheral : mPeripherals)
+	{
+		if (peripheral.nextUpdate <= mCycles)
+		{
+			peripheral.nextUpdate = peripheral.peripheral->Update(*this, peripheral.nextUpdate);
+		}
+		nextUpdate = std::min(nextUpdate, peripheral.nextUpdate);
+	}
+	mNextUpdate = nextUpdate;
+}
+
+/******************************* RaiseInterrupt *******************************/
+void AVRSimulator::RaiseInterrupt(
+	uint32_t	inVectorIndex)
+{
+	if (inVectorIndex &&
+		inVectorIndex < 128 &&
+		(mPending[inVectorIndex >> 6] & (1ULL << (inVectorIndex & 63))) == 0)
+	{
+		mPending[inVectorIndex >> 6] |= 1ULL << (inVectorIndex & 63);
+		mNumPending++;
+		mCheckCycle = 0;
+	}
+}
+
+/******************************* ClearInterrupt *******************************/
+void AVRSimulator::ClearInterrupt(
+	uint32_t	inVectorIndex)
+{
+	if (inVectorIndex < 128 &&
+		(mPending[inVectorIndex >> 6] & (1ULL << (inVectorIndex & 63))))
+	{
+		mPending[inVectorIndex >> 6] &= ~(1ULL << (inVectorIndex & 63));
+		mNumPending--;
+	}
+}
+
+/******************************** TakeInterrupt *******************************/
+/*
+*	Enters the lowest pending vector when interrupts are enabled.
+*/
+bool AVRSimulator::TakeInterrupt(void)
+{
+	bool	taken = mNumPending &&
+				(mData[mSREGAddr] & eSREG_I);
+	if (taken)
+	{
+		uint32_t	vectorIndex = mPending[0] ? __builtin_ctzll(mPending[0]) : 64 + __builtin_ctzll(mPending[1]);
+		ClearInterrupt(vectorIndex);
+		PushPC(mPC);
+		mData[mSREGAddr] &= ~eSREG_I;
+		mPC = std::min(vectorIndex * mVectorWords, mNumWords + 1);
+		mCycles += mInterruptCycles;
+	}
+	return(taken);
+}
+
+/******************************** ReadLow *************************************/
+/*
+*	Data addresses below 0x100: the registers (except XMEGA) and the I/O
+*	registers that may have handlers.
+*/
+uint8_t AVRSimulator::ReadLow(
+	uint16_t	inAddress)
+{
+	if (inAddress < 0x20 &&
+		mCore != eAVRxm)
+	{
+		return(mR[inAddress]);
+	}
+	IAVRPeripheral*	handler = mIOHandler[inAddress];
+	return(handler ? handler->ReadIO(*this, inAddress, mData[inAddress]) : mData[inAddress]);
+}
+
+/******************************** WriteLow ************************************/
+void AVRSimulator::WriteLow(
+	uint16_t	inAddress,
+	uint8_t		inValue)
+{
+	if (inAddress < 0x20 &&
+		mCore != eAVRxm)
+	{
+		mR[inAddress] = inValue;
+		return;
+	}
+	IAVRPeripheral*	handler = mIOHandler[inAddress];
+	mData[inAddress] = handler ? handler->WriteIO(*this, inAddress, inValue) : inValue;
+	if (inAddress == mSREGAddr)
+	{
+		// Interrupts may have been enabled.
+		mCheckCycle = 0;
+	}
+}
+
+/*********************************** Read *************************************/
+inline uint8_t AVRSimulator::Read(
+	uint16_t	inAddress)
+{
+	return(inAddress >= 0x100 ? mData[inAddress] : ReadLow(inAddress));
+}
+
+/*********************************** Write ************************************/
+inline void AVRSimulator::Write(
+	uint16_t	inAddress,
+	uint8_t		inValue)
+{
+	if (inAddress >= 0x100)
+	{
+		mData[inAddress] = inValue;
+	} else
+	{
+		WriteLow(inAddress, inValue);
+	}
+}
+
+/*********************************** PushPC ***********************************/
+/*
+*	The low byte is pushed first, so the return address is big endian on the
+*	stack.
+*/
+inline void AVRSimulator::PushPC(
+	uint32_t	inPC)
+{
+	uint16_t	sp = mData[mSPAddr] + (mData[mSPAddr+1] << 8);
+	mData[sp--] = (uint8_t)inPC;
+	mData[sp--] = (uint8_t)(inPC >> 8);
+	if (mHas22BitPC)
+	{
+		mData[sp--] = (uint8_t)(inPC >> 16);
+	}
+	mData[mSPAddr] = (uint8_t)sp;
+	mData[mSPAddr+1] = (uint8_t)(sp >> 8);
+}
+
+/*********************************** PopPC ************************************/
+inline uint32_t AVRSimulator::PopPC(void)
+{
+	uint16_t	sp = mData[mSPAddr] + (mData[mSPAddr+1] << 8);
+	uint32_t	pc = 0;
+	if (mHas22BitPC)
+	{
+		pc = mData[++sp] << 16;
+	}
+	pc |= mData[++sp] << 8;
+	pc |= mData[++sp];
+	mData[mSPAddr] = (uint8_t)sp;
+	mData[mSPAddr+1] = (uint8_t)(sp >> 8);
+	return(pc <= mNumWords ? pc : mNumWords + 1);
+}
+
+/************************************ Call ************************************/
+EAVRStopReason AVRSimulator::Call(
+	uint32_t	inAddress,
+	uint64_t	inCycleBudget)
+{
+	PushPC(mNumWords);	// The eOpReturned entry
+	SetPC(inAddress);
+	mCallActive = true;
+	mResumeAtBreakpoint = false;
+	return(Run(inCycleBudget));
+}
+
+/************************************ Run *************************************/
+/*
+*	mCheckCycle is the cycle count at which interrupts and peripheral
+*	updates need to be checked.  It's set to 0 to force a check before the
+*	next instruction.
+*/
+EAVRStopReason AVRSimulator::Run(
+	uint64_t	inCycleBudget)
+{
+	uint64_t	cycleLimit = mCycles + inCycleBudget;
+	uint64_t	instructionCount = 0;
+	uint8_t*	data = mData.data();
+	uint8_t*	r = mR;
+	uint8_t&	sreg = data[mSREGAddr];
+	EAVRStopReason	stopReason = eStopNone;
+	const SDecoded*	decoded = mDecoded.data();
+	while (stopReason == eStopNone)
+	{
+		if (mCycles >= mCheckCycle)
+		{
+			if (mCycles >= cycleLimit)
+			{
+				stopReason = eStopCycleBudget;
+				break;
+			}
+			if (mCycles >= mNextUpdate)
+			{
+				UpdatePeripherals();
+			}
+			mCheckCycle = std::min(cycleLimit, mNextUpdate);
+			if (mInterruptHoldoff)
+			{
+				// One instruction is executed after sei or reti.
+				mInterruptHoldoff = false;
+				mCheckCycle = 0;
+			} else if (TakeInterrupt())
+			{
+				mResumeAtBreakpoint = false;
+				mCheckCycle = 0;
+				continue;
+			}
+		}
+		const SDecoded&	inst = decoded[mPC];
+		uint8_t	op = inst.op;
+		if (op == eOpBreakpoint)
+		{
+			if (!mResumeAtBreakpoint)
+			{
+				mResumeAtBreakpoint = true;
+				stopReason = eStopBreakpoint;
+				break;
+			}
+			op = mBreakpoints[mPC];
+		}
+		mResumeAtBreakpoint = false;
+		mCycles += inst.cycles;
+		instructionCount++;
+		uint32_t	nextPC = mPC + 1;
+		switch (op)
+		{
+			case eOpNop:
+			case eOpWdr:
+			case eOpSpm:
+				break;
+			case eOpMovw:
+				r[inst.d] = r[inst.r];
+				r[inst.d + 1] = r[inst.r + 1];
+				break;
+			case eOpMul:
+			{
+				uint16_t	product = r[inst.d] * r[inst.r];
+				r[0] = (uint8_t)product;
+				r[1] = (uint8_t)(product >> 8);
+				sreg = MulFlags(sreg, product, product);
+				break;
+			}
+			case eOpMuls:
+			{
+				uint16_t	product = (uint16_t)((int8_t)r[inst.d] * (int8_t)r[inst.r]);
+				r[0] = (uint8_t)product;
+				r[1] = (uint8_t)(product >> 8);
+				sreg = MulFlags(sreg, product, product);
+				break;
+			}
+			case eOpMulsu:
+			{
+				uint16_t	product = (uint16_t)((int8_t)r[inst.d] * r[inst.r]);
+				r[0] = (uint8_t)product;
+				r[1] = (uint8_t)(product >> 8);
+				sreg = MulFlags(sreg, product, product);
+				break;
+			}
+			case eOpFmul:
+			case eOpFmuls:
+			case eOpFmulsu:
+			{
+				uint16_t	product;
+				if (op == eOpFmul)
+				{
+					product = r[inst.d] * r[inst.r];
+				} else if (op == eOpFmuls)
+				{
+					product = (uint16_t)((int8_t)r[inst.d] * (int8_t)r[inst.r]);
+				} else
+				{
+					product = (uint16_t)((int8_t)r[inst.d] * r[inst.r]);
+				}
+				uint16_t	result = product << 1;
+				r[0] = (uint8_t)result;
+				r[1] = (uint8_t)(result >> 8);
+				sreg = MulFlags(sreg, product, result);
+				break;
+			}
+			case eOpAdd:
+			case eOpAdc:
+			{
+				uint8_t	d = r[inst.d];
+				uint8_t	rr = r[inst.r];
+				uint8_t	result = d + rr + (op == eOpAdc ? (sreg & eSREG_C) : 0);
+				r[inst.d] = result;
+				sreg = AddFlags(sreg, d, rr, result);
+				break;
+			}
+			case eOpSub:
+			case eOpSbc:
+			case eOpCp:
+			case eOpCpc:
+			{
+				uint8_t	d = r[inst.d];
+				uint8_t	rr = r[inst.r];
+				bool	withCarry = op == eOpSbc || op == eOpCpc;
+				uint8_t	result = d - rr - (withCarry ? (sreg & eSREG_C) : 0);
+				if (op == eOpSub || op == eOpSbc)
+				{
+					r[inst.d] = result;
+				}
+				sreg = SubFlags(sreg, d, rr, result, withCarry);
+				break;
+			}
+			case eOpSubi:
+			case eOpSbci:
+			case eOpCpi:
+			{
+				uint8_t	d = r[inst.d];
+				uint8_t	k = (uint8_t)inst.k;
+				uint8_t	result = d - k - (op == eOpSbci ? (sreg & eSREG_C) : 0);
+				if (op != eOpCpi)
+				{
+					r[inst.d] = result;
+				}
+				sreg = SubFlags(sreg, d, k, result, op == eOpSbci);
+				break;
+			}
+			case eOpCpse:
+				if (r[inst.d] == r[inst.r])
+				{
+					nextPC += inst.k;
+					mCycles += inst.k;
+				}
+				break;
+			case eOpAnd:
+				sreg = LogicFlags(sreg, r[inst.d] &= r[inst.r]);
+				break;
+			case eOpEor:
+				sreg = LogicFlags(sreg, r[inst.d] ^= r[inst.r]);
+				break;
+			case eOpOr:
+				sreg = LogicFlags(sreg, r[inst.d] |= r[inst.r]);
+				break;
+			case eOpAndi:
+				sreg = LogicFlags(sreg, r[inst.d] &= (uint8_t)inst.k);
+				break;
+			case eOpOri:
+				sreg = LogicFlags(sreg, r[inst.d] |= (uint8_t)inst.k);
+				break;
+			case eOpMov:
+				r[inst.d] = r[inst.r];
+				break;
+			case eOpLdi:
+				r[inst.d] = (uint8_t)inst.k;
+				break;
+			case eOpLdd:
+				r[inst.d] = Read((uint16_t)(r[inst.r] + (r[inst.r + 1] << 8) + inst.k));
+				break;
+			case eOpStd:
+				Write((uint16_t)(r[inst.r] + (r[inst.r + 1] << 8) + inst.k), r[inst.d]);
+				break;
+			case eOpLds:
+				r[inst.d] = Read((uint16_t)inst.k);
+				nextPC++;
+				break;
+			case eOpSts:
+				Write((uint16_t)inst.k, r[inst.d]);
+				nextPC++;
+				break;
+			case eOpLd:
+			case eOpSt:
+			{
+				uint16_t	pointer = r[inst.r] + (r[inst.r + 1] << 8);
+				if (inst.k < 0)
+				{
+					pointer--;
+				}
+				if (op == eOpLd)
+				{
+					r[inst.d] = Read(pointer);
+				} else
+				{
+					Write(pointer, r[inst.d]);
+				}
+				if (inst.k > 0)
+				{
+					pointer++;
+				}
+				if (inst.k)
+				{
+					r[inst.r] = (uint8_t)pointer;
+					r[inst.r + 1] = (uint8_t)(pointer >> 8);
+				}
+				break;
+			}
+			case eOpLpm:
+			case eOpElpm:
+			{
+				uint32_t	z = r[30] + (r[31] << 8);
+				if (op == eOpElpm)
+				{
+					z += data[mIOOffset + 0x3B] << 16;	// RAMPZ
+				}
+				r[inst.d] = z < mFlash.size() ? mFlash[z] : 0xFF;
+				if (inst.k)
+				{
+					z++;
+					r[30] = (uint8_t)z;
+					r[31] = (uint8_t)(z >> 8);
+					if (op == eOpElpm)
+					{
+						data[mIOOffset + 0x3B] = (uint8_t)(z >> 16);
+					}
+				}
+				break;
+			}
+			case eOpPush:
+			{
+				uint16_t	sp = data[mSPAddr] + (data[mSPAddr+1] << 8);
+				data[sp--] = r[inst.d];
+				data[mSPAddr] = (uint8_t)sp;
+				data[mSPAddr+1] = (uint8_t)(sp >> 8);
+				break;
+			}
+			case eOpPop:
+			{
+				uint16_t	sp = data[mSPAddr] + (data[mSPAddr+1] << 8);
+				r[inst.d] = data[++sp];
+				data[mSPAddr] = (uint8_t)sp;
+				data[mSPAddr+1] = (uint8_t)(sp >> 8);
+				break;
+			}
+			case eOpXch:
+			case eOpLas:
+			case eOpLac:
+			case eOpLat:
+			{
+				uint16_t	z = r[30] + (r[31] << 8);
+				uint8_t	value = Read(z);
+				uint8_t	d = r[inst.d];
+				Write(z, op == eOpXch ? d : (op == eOpLas ? (value | d) :
+						(op == eOpLac ? (value & ~d) : (value ^ d))));
+				r[inst.d] = value;
+				break;
+			}
+			case eOpCom:
+			{
+				uint8_t	result = ~r[inst.d];
+				r[inst.d] = result;
+				sreg = SetNZS((sreg & ~eSREG_V) | eSREG_C, result);
+				break;
+			}
+			case eOpNeg:
+			{
+				uint8_t	d = r[inst.d];
+				uint8_t	result = 0 - d;
+				r[inst.d] = result;
+				sreg = SubFlags(sreg, 0, d, result, false);
+				break;
+			}
+			case eOpSwap:
+				r[inst.d] = (uint8_t)((r[inst.d] << 4) | (r[inst.d] >> 4));
+				break;
+			case eOpInc:
+			{
+				uint8_t	result = ++r[inst.d];
+				sreg = SetNZS(result == 0x80 ? (sreg | eSREG_V) : (sreg & ~eSREG_V), result);
+				break;
+			}
+			case eOpDec:
+			{
+				uint8_t	result = --r[inst.d];
+				sreg = SetNZS(result == 0x7F ? (sreg | eSREG_V) : (sreg & ~eSREG_V), result);
+				break;
+			}
+			case eOpAsr:
+			{
+				uint8_t	d = r[inst.d];
+				uint8_t	result = (d >> 1) | (d & 0x80);
+				r[inst.d] = result;
+				sreg = ShiftFlags(sreg, d, result);
+				break;
+			}
+			case eOpLsr:
+			{
+				uint8_t	d = r[inst.d];
+				uint8_t	result = d >> 1;
+				r[inst.d] = result;
+				sreg = ShiftFlags(sreg, d, result);
+				break;
+			}
+			case eOpRor:
+			{
+				uint8_t	d = r[inst.d];
+				uint8_t	result = (d >> 1) | ((sreg & eSREG_C) << 7);
+				r[inst.d] = result;
+				sreg = ShiftFlags(sreg, d, result);
+				break;
+			}
+			case eOpBset:
+				sreg |= inst.d;
+				if (inst.d == eSREG_I)
+				{
+					mInterruptHoldoff = true;
+					mCheckCycle = 0;
+				}
+				break;
+			case eOpBclr:
+				sreg &= ~inst.d;
+				break;
+			case eOpAdiw:
+			case eOpSbiw:
+			{
+				uint16_t	d = r[inst.d] + (r[inst.d + 1] << 8);
+				uint16_t	result = op == eOpAdiw ? d + inst.k : d - inst.k;
+				r[inst.d] = (uint8_t)result;
+				r[inst.d + 1] = (uint8_t)(result >> 8);
+				uint8_t	flags = sreg & ~(eSREG_C | eSREG_V);
+				uint16_t	carry = op == eOpAdiw ? (~result & d) : (result & ~d);
+				uint16_t	overflow = op == eOpAdiw ? (result & ~d) : (~result & d);
+				flags |= (carry >> 15) | ((overflow >> 12) & eSREG_V);
+				// N, Z and S of the 16 bit result
+				sreg = SetNZS(flags, (uint8_t)(result >> 8));
+				if (result & 0xFF)
+				{
+					sreg &= ~eSREG_Z;
+				}
+				break;
+			}
+			case eOpCbi:
+				Write(inst.d, Read(inst.d) & ~(1 << inst.r));
+				break;
+			case eOpSbi:
+				Write(inst.d, Read(inst.d) | (1 << inst.r));
+				break;
+			case eOpSbic:
+			case eOpSbis:
+				if (((Read(inst.d) >> inst.r) & 1) == (op == eOpSbis))
+				{
+					nextPC += inst.k;
+					mCycles += inst.k;
+				}
+				break;
+			case eOpIn:
+				r[inst.d] = Read(inst.r);
+				break;
+			case eOpOut:
+				Write(inst.d, r[inst.r]);
+				break;
+			case eOpBld:
+				r[inst.d] = (sreg & eSREG_T) ? (r[inst.d] | inst.r) : (r[inst.d] & ~inst.r);
+				break;
+			case eOpBst:
+				sreg = (r[inst.d] & inst.r) ? (sreg | eSREG_T) : (sreg & ~eSREG_T);
+				break;
+			case eOpSbrc:
+			case eOpSbrs:
+				if (((r[inst.d] & inst.r) != 0) == (op == eOpSbrs))
+				{
+					nextPC += inst.k;
+					mCycles += inst.k;
+				}
+				break;
+			case eOpBrbs:
+				if (sreg & inst.r)
+				{
+					nextPC = inst.k;
+					mCycles++;
+				}
+				break;
+			case eOpBrbc:
+				if ((sreg & inst.r) == 0)
+				{
+					nextPC = inst.k;
+					mCycles++;
+				}
+				break;
+			case eOpRjmp:
+				if ((uint32_t)inst.k == mPC &&
+					(sreg & eSREG_I) == 0)
+				{
+					stopReason = eStopHalted;
+				}
+				nextPC = inst.k;
+				break;
+			case eOpJmp:
+				nextPC = inst.k;
+				break;
+			case eOpRcall:
+				PushPC(nextPC);
+				nextPC = inst.k;
+				break;
+			case eOpCall:
+				PushPC(nextPC + 1);
+				nextPC = inst.k;
+				break;
+			case eOpIjmp:
+			case eOpEijmp:
+			case eOpIcall:
+			case eOpEicall:
+			{
+				uint32_t	target = r[30] + (r[31] << 8);
+				if (op == eOpEijmp || op == eOpEicall)
+				{
+					target += data[mIOOffset + 0x3C] << 16;	// EIND
+				}
+				if (op == eOpIcall || op == eOpEicall)
+				{
+					PushPC(nextPC);
+				}
+				nextPC = target < mNumWords ? target : mNumWords + 1;
+				break;
+			}
+			case eOpRet:
+				nextPC = PopPC();
+				break;
+			case eOpReti:
+				nextPC = PopPC();
+				sreg |= eSREG_I;
+				mInterruptHoldoff = true;
+				mCheckCycle = 0;
+				break;
+			case eOpSleep:
+				/*
+				*	Idle until the next peripheral update, which may raise
+				*	an interrupt.
+				*/
+				if (mNumPending == 0)
+				{
+					if ((sreg & eSREG_I) &&
+						mNextUpdate != kNever)
+					{
+						mCycles = std::max(mCycles, std::min(mNextUpdate, cycleLimit));
+					} else
+					{
+						stopReason = eStopSleep;
+					}
+				}
+				break;
+			case eOpBreak:
+				stopReason = eStopBreakInstruction;
+				break;
+			case eOpReturned:
+				stopReason = mCallActive ? eStopReturned : eStopBadPC;
+				mCallActive = false;
+				nextPC = mPC;
+				break;
+			default:	// eOpInvalid, eOpBadPC
+				stopReason = op == eOpBadPC ? eStopBadPC : eStopInvalidOpcode;
+				nextPC = mPC;
+				break;
+		}
+		if (nextPC == mPC &&
+			stopReason != eStopNone &&
+			stopReason != eStopHalted)
+		{
+			// Not executed
+			mCycles -= inst.cycles;
+			instructionCount--;
+		}
+		mPC = nextPC;
+	}
+	mInstructionCount += instructionCount;
+	mStopReason = stopReason;
+	return(stopReason);
+}
+
+/******************************* StopReasonName *******************************/
+const char* AVRSimulator::StopReasonName(
+	EAVRStopReason	inStopReason)
+{
+	static const char* const	kStopReasonName[] =
+		{"none", "cycle budget", "breakpoint", "returned", "halted", "sleep",
+		"break", "invalid opcode", "bad PC"};
+	return(inStopReason <= eStopBadPC ? kStopReasonName[inStopReason] : "?");
+}
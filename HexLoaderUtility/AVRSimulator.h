@@ -0,0 +1,328 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  AVRSimulator.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+/*
+*	A cycle counting AVR instruction set simulator used to benchmark a
+*	sketch without a board.  The flash image of an AVRElfFile is decoded
+*	once into a table of operations, then executed by a single dispatch
+*	loop.  Instruction cycles are taken from the AVRCycleAnalyzer tables.
+*
+*	Peripherals aren't simulated.  The I/O registers are plain memory
+*	unless an IAVRPeripheral is attached to the address.  Peripherals can
+*	also ask to be updated at a given cycle count, e.g. to raise a timer
+*	interrupt.
+*/
+#ifndef AVRSimulator_h
+#define AVRSimulator_h
+
+#include "AVRCycleAnalyzer.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class AVRElfFile;
+class AVRSimulator;
+
+enum EAVRStopReason
+{
+	eStopNone,
+	eStopCycleBudget,		// The cycle budget was used up
+	eStopBreakpoint,		// At a breakpoint, the instruction hasn't executed
+	eStopReturned,			// The routine started by Call returned
+	eStopHalted,			// Looping on itself with interrupts disabled (_exit)
+	eStopSleep,				// sleep with nothing to wake it
+	eStopBreakInstruction,
+	eStopInvalidOpcode,
+	eStopBadPC				// Execution left the flash image
+};
+
+/*
+*	The default implementations make the I/O register plain memory and
+*	never ask to be updated.
+*/
+class IAVRPeripheral
+{
+public:
+	virtual					~IAVRPeripheral(void){}
+	/*
+	*	inValue is the current content of the register.  Returns the value
+	*	read.
+	*/
+	virtual uint8_t			ReadIO(
+								AVRSimulator&			/*ioSimulator*/,
+								uint16_t				/*inAddress*/,
+								uint8_t					inValue)
+								{return(inValue);}
+	/*
+	*	Returns the value to store in the register.
+	*/
+	virtual uint8_t			WriteIO(
+								AVRSimulator&			/*ioSimulator*/,
+								uint16_t				/*inAddress*/,
+								uint8_t					inValue)
+								{return(inValue);}
+	/*
+	*	Called once the cycle count reaches inCycles, the cycle returned by
+	*	the previous call (or passed to AddPeripheral.)  Returns the cycle
+	*	count of the next update.
+	*/
+	virtual uint64_t		Update(
+								AVRSimulator&			ioSimulator,
+								uint64_t				inCycles);
+};
+
+/*
+*	A register that always reads as inReadValue.  The bytes written are
+*	appended to the output, e.g. to capture the serial output when attached
+*	to UDR0.
+*/
+class AVRIOStub : public IAVRPeripheral
+{
+public:
+							AVRIOStub(
+								uint8_t					inReadValue = 0)
+								: mReadValue(inReadValue){}
+	virtual uint8_t			ReadIO(
+								AVRSimulator&			/*ioSimulator*/,
+								uint16_t				/*inAddress*/,
+								uint8_t					/*inValue*/)
+								{return(mReadValue);}
+	virtual uint8_t			WriteIO(
+								AVRSimulator&			/*ioSimulator*/,
+								uint16_t				/*inAddress*/,
+								uint8_t					inValue)
+								{mOutput += (char)inValue; return(inValue);}
+	const std::string&		GetOutput(void) const
+								{return(mOutput);}
+	void					ClearOutput(void)
+								{mOutput.clear();}
+protected:
+	uint8_t					mReadValue;
+	std::string				mOutput;
+};
+
+/*
+*	Raises inVectorIndex every inPeriod cycles, e.g. vector 16 every 16384
+*	cycles is the Arduino millis() timer of the ATmega328P.
+*/
+class AVRTimerStub : public IAVRPeripheral
+{
+public:
+							AVRTimerStub(
+								uint32_t				inVectorIndex,
+								uint32_t				inPeriod)
+								: mVectorIndex(inVectorIndex), mPeriod(inPeriod){}
+	virtual uint64_t		Update(
+								AVRSimulator&			ioSimulator,
+								uint64_t				inCycles);
+protected:
+	uint32_t				mVectorIndex;
+	uint32_t				mPeriod;
+};
+
+class AVRSimulator
+{
+public:
+	/*
+	*	inFCPU is the clock frequency in Hz (the boards.txt build.f_cpu.)
+	*	When inRAMEnd is 0 it's set to leave kDefaultStackSize bytes of
+	*	stack above the elf file's GetDataSize().  The simulator is reset.
+	*/
+							AVRSimulator(
+								const AVRElfFile&		inElfFile,
+								EAVRCore				inCore,
+								bool					inHas22BitPC,
+								uint32_t				inFCPU,
+								uint16_t				inRAMEnd = 0);
+							~AVRSimulator(void){}
+	static const uint64_t	kNever;
+	static const uint32_t	kDefaultStackSize;
+	/*
+	*	Returns false if the elf file has no flash image.
+	*/
+	bool					IsValid(void) const
+								{return(mNumWords != 0);}
+	/*
+	*	Clears the registers, SRAM and pending interrupts, and sets the PC to
+	*	0 and the SP to RAMEND.  The cycle count is set to 0.  Peripherals
+	*	and breakpoints are kept.
+	*/
+	void					Reset(void);
+	/*
+	*	Runs until inCycleBudget more cycles have elapsed or execution
+	*	stops for some other reason.
+	*/
+	EAVRStopReason			Run(
+								uint64_t				inCycleBudget);
+	/*
+	*	Executes one instruction (or the entry into a pending interrupt.)
+	*/
+	EAVRStopReason			Step(void)
+								{return(Run(1));}
+	/*
+	*	Calls the routine at the flash address inAddress from the current
+	*	state and runs until it returns (eStopReturned) or stops.
+	*/
+	EAVRStopReason			Call(
+								uint32_t				inAddress,
+								uint64_t				inCycleBudget);
+	/*
+	*	Breakpoints are flash addresses.  Returns false if the address isn't
+	*	within the image.
+	*/
+	bool					SetBreakpoint(
+								uint32_t				inAddress);
+	void					ClearBreakpoint(
+								uint32_t				inAddress);
+	void					ClearBreakpoints(void);
+	/*
+	*	Attaches inPeripheral to the data address inAddress (below 0x100),
+	*	or detaches it when inPeripheral is NULL.  The simulator doesn't
+	*	take ownership.
+	*/
+	void					SetIOHandler(
+								uint16_t				inAddress,
+								IAVRPeripheral*			inPeripheral);
+	/*
+	*	Adds inPeripheral to be updated at inFirstUpdate.
+	*/
+	void					AddPeripheral(
+								IAVRPeripheral*			inPeripheral,
+								uint64_t				inFirstUpdate);
+	/*
+	*	Sets the interrupt flag of the vector.  Pending interrupts are taken
+	*	lowest vector first when interrupts are enabled.
+	*/
+	void					RaiseInterrupt(
+								uint32_t				inVectorIndex);
+	void					ClearInterrupt(
+								uint32_t				inVectorIndex);
+	uint32_t				GetPC(void) const
+								{return(mPC * 2);}
+	void					SetPC(
+								uint32_t				inAddress)
+								{mPC = inAddress/2 < mNumWords ? inAddress/2 : mNumWords + 1;}
+	uint64_t				GetCycles(void) const
+								{return(mCycles);}
+	uint64_t				GetInstructionCount(void) const
+								{return(mInstructionCount);}
+	double					GetSeconds(void) const
+								{return(mFCPU ? (double)mCycles/mFCPU : 0);}
+	uint32_t				GetFCPU(void) const
+								{return(mFCPU);}
+	uint16_t				GetRAMEnd(void) const
+								{return(mRAMEnd);}
+	EAVRStopReason			GetStopReason(void) const
+								{return(mStopReason);}
+	static const char*		StopReasonName(
+								EAVRStopReason			inStopReason);
+	uint8_t					GetRegister(
+								uint32_t				inIndex) const
+								{return(mR[inIndex & 0x1F]);}
+	void					SetRegister(
+								uint32_t				inIndex,
+								uint8_t					inValue)
+								{mR[inIndex & 0x1F] = inValue;}
+	uint8_t					GetSREG(void) const
+								{return(mData[mSREGAddr]);}
+	uint16_t				GetSP(void) const
+								{return(mData[mSPAddr] + (mData[mSPAddr+1] << 8));}
+	/*
+	*	The data space (without the registers on the AVRe cores.)  The I/O
+	*	handlers aren't called.
+	*/
+	uint8_t					ReadData(
+								uint16_t				inAddress) const
+								{return(mData[inAddress]);}
+	void					WriteData(
+								uint16_t				inAddress,
+								uint8_t					inValue)
+								{mData[inAddress] = inValue;}
+protected:
+	struct SDecoded
+	{
+		uint8_t		op;
+		uint8_t		d;			// Rd, the I/O address, or the SREG bit
+		uint8_t		r;			// Rr, the bit number, or the pointer register
+		uint8_t		cycles;		// Branch not taken, no skip
+		int32_t		k;			// Immediate, data address, displacement,
+								// target word, or words skipped.
+	};
+	struct SPeripheral
+	{
+		IAVRPeripheral*	peripheral;
+		uint64_t		firstUpdate;
+		uint64_t		nextUpdate;
+	};
+	EAVRCore				mCore;
+	bool					mHas22BitPC;
+	uint32_t				mFCPU;
+	uint16_t				mRAMEnd;
+	uint16_t				mIOOffset;		// Data address of I/O address 0
+	uint16_t				mSREGAddr;
+	uint16_t				mSPAddr;
+	uint32_t				mVectorWords;	// 2 if the vectors are jmps
+	uint32_t				mInterruptCycles;
+	std::vector<uint8_t>	mFlash;
+	std::vector<SDecoded>	mDecoded;		// mNumWords + the return and bad PC entries
+	uint32_t				mNumWords;
+	std::map<uint32_t, uint8_t>	mBreakpoints;	// Word address, original op
+	uint8_t					mR[32];
+	std::vector<uint8_t>	mData;			// 64KB
+	IAVRPeripheral*			mIOHandler[0x100];
+	std::vector<SPeripheral>	mPeripherals;
+	uint64_t				mPending[2];	// Interrupt flags, one bit per vector
+	uint32_t				mNumPending;
+	uint32_t				mPC;			// Word address
+	uint64_t				mCycles;
+	uint64_t				mInstructionCount;
+	uint64_t				mCheckCycle;	// Check for interrupts and updates at
+	uint64_t				mNextUpdate;	// this cycle.
+	bool					mInterruptHoldoff;
+	bool					mCallActive;
+	bool					mResumeAtBreakpoint;
+	EAVRStopReason			mStopReason;
+
+	void					Decode(void);
+	void					UpdatePeripherals(void);
+	bool					TakeInterrupt(void);
+	inline uint8_t			Read(
+								uint16_t				inAddress);
+	inline void				Write(
+								uint16_t				inAddress,
+								uint8_t					inValue);
+	uint8_t					ReadLow(
+								uint16_t				inAddress);
+	void					WriteLow(
+								uint16_t				inAddress,
+								uint8_t					inValue);
+	inline void				PushPC(
+								uint32_t				inPC);
+	inline uint32_t			PopPC(void);
+};
+
+#endif /* AVRSimulator_h */
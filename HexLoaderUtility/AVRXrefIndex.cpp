@@ -0,0 +1,201 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  AVRXrefIndex.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#include "AVRXrefIndex.h"
+#include <algorithm>
+
+/*
+*	Sorted by target, then source.
+*/
+static bool XrefLess(
+	const SXref&	inA,
+	const SXref&	inB)
+{
+	return(inA.target < inB.target ||
+		(inA.target == inB.target && inA.source < inB.source));
+}
+
+/*********************************** Build ************************************/
+bool AVRXrefIndex::Build(
+	const AVRElfFile&	inElfFile)
+{
+	Clear();
+	const SSectEntry*	textSectEntry = inElfFile.GetSectEntry(eText);
+	bool	success = textSectEntry != NULL &&
+				textSectEntry->size >= 2;
+	if (success)
+	{
+		const uint16_t*	text = (const uint16_t*)inElfFile.GetTextPtr();
+		uint32_t	numWords = textSectEntry->size/2;
+		uint32_t	textAddr = textSectEntry->addrInMem;
+		uint32_t	wordIndex = 0;
+		while (wordIndex < numWords)
+		{
+			SXref	xref;
+			wordIndex += Decode(text, numWords, wordIndex, xref);
+			if (xref.kind < eNumXrefKinds)
+			{
+				xref.source += textAddr;
+				if (xref.kind >= eXrefRJMP)
+				{
+					xref.target += textAddr;
+				}
+				mXrefs[SpaceFor(xref.kind) == eFlashSpace ? 0 : 1].push_back(xref);
+			}
+		}
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			std::sort(mXrefs[i].begin(), mXrefs[i].end(), XrefLess);
+		}
+	}
+	return(success);
+}
+
+/*********************************** Clear ************************************/
+void AVRXrefIndex::Clear(void)
+{
+	mXrefs[0].clear();
+	mXrefs[1].clear();
+}
+
+/******************************** ReferencesTo ********************************/
+const SXref* AVRXrefIndex::ReferencesTo(
+	EAVRAddressSpace	inSpace,
+	uint32_t			inStart,
+	uint32_t			inEnd,
+	uint32_t&			outCount) const
+{
+	const SXref*	xrefs = NULL;
+	outCount = 0;
+	if (inSpace == eFlashSpace ||
+		inSpace == eSRAMSpace)
+	{
+		const Xrefs&	spaceXrefs = GetXrefs(inSpace);
+		Xrefs::const_iterator	itr = std::lower_bound(spaceXrefs.begin(), spaceXrefs.end(), inStart,
+			[](const SXref& inXref, uint32_t inTarget){return(inXref.target < inTarget);});
+		Xrefs::const_iterator	itrEnd = std::lower_bound(itr, spaceXrefs.end(), inEnd,
+			[](const SXref& inXref, uint32_t inTarget){return(inXref.target < inTarget);});
+		if (itr != itrEnd)
+		{
+			xrefs = &(*itr);
+			outCount = (uint32_t)(itrEnd - itr);
+		}
+	}
+	return(xrefs);
+}
+
+/******************************** ReferencesTo ********************************/
+const SXref* AVRXrefIndex::ReferencesTo(
+	const SSymbolTblEntry*	inSymTblEntry,
+	uint32_t&				outCount) const
+{
+	const SXref*	xrefs = NULL;
+	outCount = 0;
+	if (inSymTblEntry)
+	{
+		EAVRAddressSpace	space = AVRElfFile::AddressSpaceFor(inSymTblEntry->value);
+		if (space < eNumAVRAddressSpaces)
+		{
+			uint32_t	start = inSymTblEntry->value - AVRElfFile::AddressSpaceBase(space);
+			xrefs = ReferencesTo(space, start, start + (inSymTblEntry->size ? inSymTblEntry->size : 1), outCount);
+		}
+	}
+	return(xrefs);
+}
+
+/*********************************** Decode ***********************************/
+/*
+*	The source and relative targets are offsets within inText.
+*/
+uint32_t AVRXrefIndex::Decode(
+	const uint16_t*	inText,
+	uint32_t		inNumWords,
+	uint32_t		inWordIndex,
+	SXref&			outXref)
+{
+	uint32_t	numWords = 1;
+	uint16_t	opcode = inText[inWordIndex];
+	bool		hasOperand = (inWordIndex + 1) < inNumWords;
+	outXref.source = inWordIndex * 2;
+	outXref.kind = eNumXrefKinds;
+	switch (opcode >> 12)
+	{
+		case 0x9:
+			if ((opcode & 0xFC0F) == 0x9000)		// 1001 00sd dddd 0000
+			{
+				numWords = 2;
+				if (hasOperand)
+				{
+					outXref.kind = (opcode & 0x0200) ? eXrefSTS : eXrefLDS;
+					outXref.target = inText[inWordIndex+1];
+				}
+			} else if ((opcode & 0xFE0C) == 0x940C)	// 1001 010k kkkk 11ck
+			{
+				numWords = 2;
+				if (hasOperand)
+				{
+					outXref.kind = (opcode & 2) ? eXrefCALL : eXrefJMP;
+					outXref.target = (((((opcode >> 3) & 0x3E) | (opcode & 1)) << 16) | inText[inWordIndex+1]) << 1;
+				}
+			}
+			break;
+		case 0xC:	// RJMP
+		case 0xD:	// RCALL
+		{
+			int32_t	k = opcode & 0xFFF;
+			k -= (k & 0x800) << 1;
+			outXref.kind = (opcode & 0x1000) ? eXrefRCALL : eXrefRJMP;
+			outXref.target = (uint32_t)(((int32_t)inWordIndex + 1 + k) * 2);
+			break;
+		}
+		case 0xE:	// LDI
+			if (hasOperand &&
+				(inText[inWordIndex+1] >> 12) == 0xE &&
+				((opcode ^ inText[inWordIndex+1]) & 0x00F0) == 0x0010)
+			{
+				/*
+				*	Rd and Rd+1 of the same pair, in either order.
+				*/
+				uint16_t	lowOpcode = (opcode & 0x0010) ? inText[inWordIndex+1] : opcode;
+				uint16_t	highOpcode = (opcode & 0x0010) ? opcode : inText[inWordIndex+1];
+				numWords = 2;
+				outXref.kind = eXrefLDIPair;
+				outXref.target = (((highOpcode >> 4) & 0xF0) | (highOpcode & 0xF)) << 8 |
+									((lowOpcode >> 4) & 0xF0) | (lowOpcode & 0xF);
+			}
+			break;
+	}
+	return(numWords);
+}
+
+/********************************** KindName **********************************/
+const char* AVRXrefIndex::KindName(
+	uint32_t	inKind)
+{
+	static const char* const	kKindName[] = {"lds", "sts", "ldi", "jmp", "call", "rjmp", "rcall"};
+	return(inKind < eNumXrefKinds ? kKindName[inKind] : "");
+}
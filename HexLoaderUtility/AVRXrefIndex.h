@@ -0,0 +1,126 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  AVRXrefIndex.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+/*
+*	A cross-reference index of the address operands in .text, built by a
+*	single pass that decodes each instruction:
+*		- LDS/STS operands and LDI pairs are data (SRAM) references
+*		- JMP/CALL/RJMP/RCALL targets are code (flash) references
+*	An LDI pair is two adjacent LDIs that load the low and high registers
+*	of a register pair (e.g. ldi r24, lo8(x) / ldi r25, hi8(x).)  The
+*	value might not be an address, or might be a flash address used with
+*	LPM, so LDI pairs are recorded but not used for relocation.
+*
+*	The references are kept sorted by target, so the references to an
+*	address or range (e.g. a symbol) are found in O(log n).
+*
+*	Like the disassembler, the pass decodes everything in .text, including
+*	PROGMEM data, which may produce spurious references.
+*/
+#ifndef AVRXrefIndex_h
+#define AVRXrefIndex_h
+
+#include "AVRElfFile.h"
+#include <vector>
+#include <stdint.h>
+
+enum EAVRXrefKind
+{
+	eXrefLDS,
+	eXrefSTS,
+	eXrefLDIPair,
+	eXrefJMP,
+	eXrefCALL,
+	eXrefRJMP,
+	eXrefRCALL,
+	eNumXrefKinds
+};
+
+struct SXref
+{
+	uint32_t	target;		// Device address, an SRAM or flash byte address
+	uint32_t	source;		// Flash address of the instruction
+	uint32_t	kind;		// EAVRXrefKind
+};
+
+typedef std::vector<SXref> Xrefs;
+
+class AVRXrefIndex
+{
+public:
+							AVRXrefIndex(void){}
+							~AVRXrefIndex(void){}
+	/*
+	*	Replaces the index with the references of inElfFile's .text.
+	*	Returns false if the elf file has no .text.
+	*/
+	bool					Build(
+								const AVRElfFile&		inElfFile);
+	void					Clear(void);
+	/*
+	*	Returns the references to targets within [inStart, inEnd) of
+	*	inSpace (eFlashSpace or eSRAMSpace), sorted by target then source.
+	*	outCount is set to the number of references.  Returns NULL when
+	*	there are none.
+	*/
+	const SXref*			ReferencesTo(
+								EAVRAddressSpace		inSpace,
+								uint32_t				inStart,
+								uint32_t				inEnd,
+								uint32_t&				outCount) const;
+	/*
+	*	The references to any byte of the symbol (the symbol's address when
+	*	it's unsized.)
+	*/
+	const SXref*			ReferencesTo(
+								const SSymbolTblEntry*	inSymTblEntry,
+								uint32_t&				outCount) const;
+	/*
+	*	All references of inSpace.
+	*/
+	const Xrefs&			GetXrefs(
+								EAVRAddressSpace		inSpace) const
+								{return(mXrefs[inSpace == eFlashSpace ? 0 : 1]);}
+	/*
+	*	Decodes the instruction at inText[inWordIndex].  Returns the number
+	*	of words the instruction occupies.  outXref.kind is set to
+	*	eNumXrefKinds when the instruction isn't a reference.
+	*/
+	static uint32_t			Decode(
+								const uint16_t*			inText,
+								uint32_t				inNumWords,
+								uint32_t				inWordIndex,
+								SXref&					outXref);
+	static EAVRAddressSpace	SpaceFor(
+								uint32_t				inKind)
+								{return(inKind >= eXrefJMP ? eFlashSpace : eSRAMSpace);}
+	static const char*		KindName(
+								uint32_t				inKind);
+protected:
+	Xrefs					mXrefs[2];	// Code, data
+};
+
+#endif /* AVRXrefIndex_h */
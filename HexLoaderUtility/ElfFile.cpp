@@ -26,32 +26,96 @@
 //
 
 #include "ElfFile.h"
+#include "ElfNormalizer.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // kSectName mirrors ESectName.  Any change made here must be reflected in ESectName
 // This array is maintained in alphabetical order
-static const char*	kSectName[] =	{
-									//	"",
+static constexpr const char*	kSectName[] =	{
 										".bss",
 										".comment",
 										".data",
-									//	".debug_abbrev",
-									//	".debug_aranges",
-									//	".debug_frame",
-									//	".debug_info",
-									//	".debug_line",
-									//	".debug_loc",
-									//	".debug_ranges",
-									//	".debug_str",
-									//	".note.gnu.avr.deviceinfo",	<< not available for all avr devices
+										".debug_abbrev",
+										".debug_aranges",
+										".debug_frame",
+										".debug_info",
+										".debug_line",
+										".debug_line_str",
+										".debug_loc",
+										".debug_loclists",
+										".debug_ranges",
+										".debug_rnglists",
+										".debug_str",
+										".eeprom",
+										".fuse",
+										".lock",
+										".noinit",
+										".note.gnu.avr.deviceinfo",	// not available for all avr devices
 										".shstrtab",
+										".signature",
+										".stab",
+										".stabstr",
 										".strtab",
 										".symtab",
 										".text"
 									};
+static_assert(sizeof(kSectName)/sizeof(kSectName[0]) == eNumSectNames, "kSectName doesn't mirror ESectName");
+
+/*
+*	kSectNameSlots is a perfect hash of kSectName built at compile time.
+*	The slot of a name is the top kSectHashBits of the seeded FNV-1a hash
+*	of the name.  kSectHashSeed was chosen so that no two names share a
+*	slot.  If a name is added and the static_assert below fails, a new
+*	seed needs to be found (try each seed from 0 until one works.)
+*/
+static constexpr uint32_t	kSectHashBits = 6;
+static constexpr uint32_t	kSectHashSlots = 1 << kSectHashBits;
+static constexpr uint32_t	kSectHashSeed = 322;
+
+static constexpr uint32_t SectNameSlot(
+	const char*	inSectionName)
+{
+	uint32_t	hash = 2166136261U ^ kSectHashSeed;
+	for (; *inSectionName; inSectionName++)
+	{
+		hash = (hash ^ (uint8_t)*inSectionName) * 16777619U;
+	}
+	return(hash >> (32 - kSectHashBits));
+}
+
+struct SSectNameSlots
+{
+	uint8_t	sectName[kSectHashSlots];	// ESectName, eInvalidSect = empty slot
+	bool	isPerfect;
+	
+	constexpr SSectNameSlots(void)
+		: sectName{}, isPerfect(true)
+	{
+		for (uint32_t i = 0; i < kSectHashSlots; i++)
+		{
+			sectName[i] = eInvalidSect;
+		}
+		for (uint32_t i = 0; i < eNumSectNames; i++)
+		{
+			uint32_t	slot = SectNameSlot(kSectName[i]);
+			if (sectName[slot] != eInvalidSect)
+			{
+				isPerfect = false;
+			}
+			sectName[slot] = i;
+		}
+	}
+};
+static constexpr SSectNameSlots	kSectNameSlots;
+static_assert(kSectNameSlots.isPerfect, "kSectHashSeed doesn't produce a perfect hash of kSectName");
 
 /********************************** ElfFile ***********************************/
 ElfFile::ElfFile(void)
-	: mContent(NULL)
+	: mContent(NULL), mFileSize(0), mIsMapped(false), mIsNormalized(false), mNumProgEntries(0)
 {
 }
 
@@ -66,54 +130,133 @@ void ElfFile::FreeMem(void)
 {
 	if (mContent)
 	{
-		delete [] mContent;
+		if (mIsMapped)
+		{
+			munmap(mContent, mFileSize);
+			mIsMapped = false;
+		} else
+		{
+			delete [] mContent;
+		}
 		mContent = NULL;
 	}
+	mFileSize = 0;
+	mIsNormalized = false;
+	mNumProgEntries = 0;
+	mSymbolHash.clear();
+	mShndxLkup.clear();
+	mSectionHash.clear();
 }
 
 /********************************** ReadFile **********************************/
 bool ElfFile::ReadFile(
-	const char*				inPath)
+	const char*				inPath,
+	bool					inMapFile)
 {
 	bool	success = false;
 
 	FreeMem();
-	FILE*    file = fopen(inPath, "rb");
-	if (file)
-	{
-		fseek(file, 0, SEEK_END);
-		mFileSize = 0;
-		fgetpos(file, &mFileSize);
-		rewind(file);
-		mContent = new uint8_t[mFileSize];
-		size_t	bytesRead = fread(mContent, 1, mFileSize, file);
-		fclose(file);
+	int	fileDesc = open(inPath, O_RDONLY);
+	if (fileDesc >= 0)
+	{
+		struct stat	fileStat;
+		if (fstat(fileDesc, &fileStat) == 0 &&
+			fileStat.st_size >= (off_t)sizeof(SElfHeader))
+		{
+			mFileSize = (size_t)fileStat.st_size;
+			if (inMapFile)
+			{
+				/*
+				*	The mapping is private and initially read-only.  Nothing
+				*	is read from disk until a page is referenced.  See
+				*	MakeContentWritable.
+				*/
+				void*	mappedContent = mmap(NULL, mFileSize, PROT_READ, MAP_PRIVATE, fileDesc, 0);
+				if (mappedContent != MAP_FAILED)
+				{
+					mContent = (uint8_t*)mappedContent;
+					mIsMapped = true;
+				}
+			}
+			/*
+			*	If not mapping OR the mapping failed THEN
+			*	read the entire file.
+			*/
+			if (!mContent)
+			{
+				mContent = new uint8_t[mFileSize];
+				size_t	bytesRead = 0;
+				while (bytesRead < mFileSize)
+				{
+					ssize_t	thisRead = read(fileDesc, &mContent[bytesRead], mFileSize - bytesRead);
+					if (thisRead <= 0)
+					{
+						break;
+					}
+					bytesRead += thisRead;
+				}
+				if (bytesRead != mFileSize)
+				{
+					delete [] mContent;
+					mContent = NULL;
+				}
+			}
+		}
+		close(fileDesc);
+	}
+	if (mContent)
+	{
+		NormalizeContent();
+	}
+	if (mContent)
+	{
 		mHeader = (SElfHeader*)mContent;
-		if (bytesRead == mFileSize &&
-			mHeader->magicNumber == 0x464c457f)
+		if (mHeader->magicNumber == 0x464c457f &&
+			mHeader->sectHdrSize == sizeof(SSectEntry) &&
+			mHeader->sectHdrOffset + ((size_t)mHeader->numSectEntries * sizeof(SSectEntry)) <= mFileSize &&
+			mHeader->sectEntryNamesIndex < mHeader->numSectEntries &&
+			((size_t)((SSectEntry*)&mContent[mHeader->sectHdrOffset])[mHeader->sectEntryNamesIndex].offset +
+				((SSectEntry*)&mContent[mHeader->sectHdrOffset])[mHeader->sectEntryNamesIndex].size) <= mFileSize)
 		{
 			for (uint32_t j = 0; j < eNumSectNames; j++)
 			{
-				mShndxLkup[j] = 0;
 				mSectEntry[j] = NULL;
 			}
 			
 			SSectEntry*	sectEntry = (SSectEntry*)&mContent[mHeader->sectHdrOffset];
-			const char* sectEntryNames = (const char*)&mContent[sectEntry[mHeader->sectEntryNamesIndex].offset];
-			uint32_t	numSectEntriesFound = 0;
+			const SSectEntry*	namesSectEntry = &sectEntry[mHeader->sectEntryNamesIndex];
+			const char* sectEntryNames = (const char*)&mContent[namesSectEntry->offset];
+			mShndxLkup.assign(mHeader->numSectEntries, eInvalidSect);
 			for (uint32_t i = 0; i < mHeader->numSectEntries; i++)
 			{
-				uint32_t	index = SectionNameToIndex(&sectEntryNames[sectEntry[i].nameOffset]);
-				if (index < eNumSectNames)
+				/*
+				*	A name that isn't within the section name table is
+				*	treated as an unnamed section.
+				*/
+				if (sectEntry[i].nameOffset < namesSectEntry->size)
 				{
-					numSectEntriesFound++;
-					mSectEntry[index] = &sectEntry[i];
-				}
-				if (i < eNumSectNames)
-				{
-					mShndxLkup[i] = index;
+					uint32_t	index = SectionNameToIndex(&sectEntryNames[sectEntry[i].nameOffset]);
+					if (index < eNumSectNames)
+					{
+						if (mSectEntry[index] == NULL)
+						{
+							mSectEntry[index] = &sectEntry[i];
+						}
+						mShndxLkup[i] = index;
+					}
 				}
 			}
+			BuildSectionHash();
+			/*
+			*	The program header table is optional.  It's ignored if
+			*	it's not within the file.
+			*/
+			if (mHeader->progHdrOffset &&
+				mHeader->progHdrSize == sizeof(SProgEntry) &&
+				mHeader->progHdrOffset + ((size_t)mHeader->numProgEntries * sizeof(SProgEntry)) <= mFileSize)
+			{
+				mNumProgEntries = mHeader->numProgEntries;
+			}
 			success = HasRequiredSections();
 		}
 	}
@@ -125,12 +268,77 @@ bool ElfFile::ReadFile(
 	return(success);
 }
 
+/****************************** NormalizeContent ******************************/
+/*
+*	If the content isn't an ELF32 file with the host byte order, it's
+*	replaced by its normalized image (see ElfNormalizer.h.)  ELF32 files
+*	with the host byte order (AVR, ARM Cortex-M) are used as is.  If the
+*	content can't be normalized it's freed.
+*/
+void ElfFile::NormalizeContent(void)
+{
+	const SElfHeader*	header = (const SElfHeader*)mContent;
+	if (header->magicNumber == 0x464c457f &&
+		(header->formatType != eElfClass32 || header->endianType != eElfHostEndian))
+	{
+		bool	swap = header->endianType != eElfHostEndian;
+		uint8_t*	normalized = NULL;
+		size_t	normalizedSize = 0;
+		if (header->endianType == eElfLittleEndian ||
+			header->endianType == eElfBigEndian)
+		{
+			if (header->formatType == eElfClass32)
+			{
+				// Only reached when swapping
+				normalized = ElfNormalizer<SElf32Class, true>::Normalize(mContent, mFileSize, normalizedSize);
+			} else if (header->formatType == eElfClass64)
+			{
+				normalized = swap ?
+					ElfNormalizer<SElf64Class, true>::Normalize(mContent, mFileSize, normalizedSize) :
+					ElfNormalizer<SElf64Class, false>::Normalize(mContent, mFileSize, normalizedSize);
+			}
+		}
+		FreeMem();
+		if (normalized)
+		{
+			mContent = normalized;
+			mFileSize = normalizedSize;
+			mIsNormalized = true;
+		}
+	}
+}
+
+/**************************** MakeContentWritable *****************************/
+/*
+*	When the file is mapped, changes the protection of the pages containing
+*	inOffset to inOffset + inSize to read/write.  Because the mapping is
+*	private, the first write to each page makes a private copy of that page.
+*/
+bool ElfFile::MakeContentWritable(
+	uint32_t	inOffset,
+	uint32_t	inSize)
+{
+	bool	success = mContent != NULL && ((size_t)inOffset + inSize) <= mFileSize;
+	if (success && mIsMapped && inSize)
+	{
+		size_t	pageMask = (size_t)getpagesize() - 1;
+		size_t	startOffset = inOffset & ~pageMask;
+		size_t	endOffset = ((size_t)inOffset + inSize + pageMask) & ~pageMask;
+		success = mprotect(&mContent[startOffset], endOffset - startOffset, PROT_READ | PROT_WRITE) == 0;
+	}
+	return(success);
+}
+
 /**************************** HasRequiredSections *****************************/
 bool ElfFile::HasRequiredSections(void) const
 {
 	return(mSectEntry[eText] != NULL &&
 		mSectEntry[eStringTable] != NULL &&
-		mSectEntry[eSymbolTable] != NULL);
+		mSectEntry[eSymbolTable] != NULL &&
+		mSectEntry[eSymbolTable]->entrySize == sizeof(SSymbolTblEntry) &&
+		((size_t)mSectEntry[eText]->offset + mSectEntry[eText]->size) <= mFileSize &&
+		((size_t)mSectEntry[eStringTable]->offset + mSectEntry[eStringTable]->size) <= mFileSize &&
+		((size_t)mSectEntry[eSymbolTable]->offset + mSectEntry[eSymbolTable]->size) <= mFileSize);
 }
 
 /********************************* WriteFile **********************************/
@@ -138,7 +346,12 @@ bool ElfFile::WriteFile(
 	const char*	inPath)
 {
 	bool success = false;
-	if (mContent)
+	/*
+	*	A normalized image isn't written because it's not the file's
+	*	original format.
+	*/
+	if (mContent &&
+		!mIsNormalized)
 	{
 		FILE*    file = fopen(inPath, "wb");
 		if (file)
@@ -164,57 +377,417 @@ uint8_t* ElfFile::GetSymbolValuePtr(
 	const SSymbolTblEntry**	outSymTblEntry)
 {
 	uint8_t*	symbolOffset = NULL;
-	
-	const SSectEntry*	symTableSectEntry = GetSectEntry(eSymbolTable);
-	const char* stringTable = (const char*)&mContent[GetSectEntry(eStringTable)->offset];
-	const SSymbolTblEntry*	symbolTable = (const SSymbolTblEntry*)&mContent[symTableSectEntry->offset];
-	uint32_t	numSymTableEntries = symTableSectEntry->size/symTableSectEntry->entrySize;
-	const SSymbolTblEntry*	symbolTableEnd = &symbolTable[numSymTableEntries];
+	const SSymbolTblEntry*	symbolTblEntry = FindSymbol(inSymbolName);
+	if (symbolTblEntry)
+	{
+		symbolOffset = SymbolValuePtr(symbolTblEntry);
+		if (outSymTblEntry)
+		{
+			*outSymTblEntry = symbolTblEntry;
+		}
+	}
+	return(symbolOffset);
+}
 
-	for (; symbolTable < symbolTableEnd; symbolTable++)
+/***************************** GetSymbolValuePtrs *****************************/
+uint32_t ElfFile::GetSymbolValuePtrs(
+	const char* const*		inSymbolNames,
+	uint32_t				inCount,
+	uint8_t**				outValuePtrs,
+	const SSymbolTblEntry**	outSymTblEntries)
+{
+	uint32_t	numFound = 0;
+	for (uint32_t i = 0; i < inCount; i++)
 	{
-		//fprintf(stderr, "%s = %d\n", &stringTable[symbolTable->name], symbolTable->shndx);
-		if (strcmp(inSymbolName, &stringTable[symbolTable->name]) != 0)
+		const SSymbolTblEntry*	symbolTblEntry = FindSymbol(inSymbolNames[i]);
+		if (symbolTblEntry)
 		{
-			continue;
+			numFound++;
 		}
-		if (symbolTable->shndx < eNumSectNames)
+		outValuePtrs[i] = symbolTblEntry ? SymbolValuePtr(symbolTblEntry) : NULL;
+		if (outSymTblEntries)
 		{
-			const SSectEntry*	thisSectEntry = mSectEntry[mShndxLkup[symbolTable->shndx]];
-			uint32_t	contentOffset = thisSectEntry->offset + (symbolTable->value - thisSectEntry->addrInMem);
-			symbolOffset = &mContent[contentOffset];
+			outSymTblEntries[i] = symbolTblEntry;
 		}
-		if (outSymTblEntry)
+	}
+	return(numFound);
+}
+
+/******************************* SymbolValuePtr *******************************/
+/*
+*	Returns the address within the elf file of the symbol's value or NULL
+*	if the symbol isn't associated with a section that has content (e.g. ABS)
+*/
+uint8_t* ElfFile::SymbolValuePtr(
+	const SSymbolTblEntry*	inSymTblEntry) const
+{
+	uint8_t*	symbolOffset = NULL;
+	if (inSymTblEntry->shndx != eShndxUndef &&
+		inSymTblEntry->shndx < mHeader->numSectEntries)
+	{
+		const SSectEntry*	thisSectEntry = GetSection(inSymTblEntry->shndx);
+		uint32_t	contentOffset = thisSectEntry->offset + (inSymTblEntry->value - thisSectEntry->addrInMem);
+		if (contentOffset < mFileSize)
 		{
-			*outSymTblEntry = symbolTable;
+			symbolOffset = &mContent[contentOffset];
 		}
-		break;
 	}
 	return(symbolOffset);
 }
 
-/*************************** SectionNameToIndex *******************************/
-uint32_t ElfFile::SectionNameToIndex(
-	const char*	inSectionName)
+/******************************* GetSectionName *******************************/
+const char* ElfFile::GetSectionName(
+	const SSectEntry*	inSectEntry) const
+{
+	const SSectEntry*	sectEntry = (const SSectEntry*)&mContent[mHeader->sectHdrOffset];
+	return((const char*)&mContent[sectEntry[mHeader->sectEntryNamesIndex].offset + inSectEntry->nameOffset]);
+}
+
+/****************************** GetSectionIndex *******************************/
+uint16_t ElfFile::GetSectionIndex(
+	ESectName	inESectName) const
+{
+	return(mSectEntry[inESectName] ?
+		(uint16_t)(mSectEntry[inESectName] - (const SSectEntry*)&mContent[mHeader->sectHdrOffset]) : 0);
+}
+
+/******************************** FindSection *********************************/
+/*
+*	The well known names are found via mSectEntry, everything else via
+*	mSectionHash.  When more than one section has the same name, the first
+*	is returned.
+*/
+const SSectEntry* ElfFile::FindSection(
+	const char*	inSectionName,
+	uint16_t*	outIndex) const
+{
+	const SSectEntry*	sectEntry = NULL;
+	uint16_t	sectIndex = 0;
+	if (mContent)
+	{
+		uint32_t	sectName = SectionNameToIndex(inSectionName);
+		if (sectName < eNumSectNames)
+		{
+			sectEntry = mSectEntry[sectName];
+			sectIndex = GetSectionIndex((ESectName)sectName);
+		} else if (!mSectionHash.empty())
+		{
+			uint32_t	hash = HashSymbolName(inSectionName);
+			uint32_t	mask = (uint32_t)mSectionHash.size() - 1;
+			for (uint32_t slotIndex = hash & mask; mSectionHash[slotIndex].symbolIndex; slotIndex = (slotIndex + 1) & mask)
+			{
+				const SSymbolHashSlot&	slot = mSectionHash[slotIndex];
+				if (slot.hash == hash &&
+					strcmp(inSectionName, GetSectionName(GetSection(slot.symbolIndex-1))) == 0)
+				{
+					sectIndex = slot.symbolIndex-1;
+					sectEntry = GetSection(sectIndex);
+					break;
+				}
+			}
+		}
+	}
+	if (outIndex)
+	{
+		*outIndex = sectIndex;
+	}
+	return(sectEntry);
+}
+
+/****************************** BuildSectionHash ******************************/
+/*
+*	Called by ReadFile after the section header table has been validated.
+*	Only the first occurrence of a name is entered.
+*/
+void ElfFile::BuildSectionHash(void)
+{
+	uint32_t	numSections = mHeader->numSectEntries;
+	const SSectEntry*	namesSectEntry = GetSection(mHeader->sectEntryNamesIndex);
+	uint32_t	numSlots = 16;
+	while (numSlots < (numSections * 2))
+	{
+		numSlots <<= 1;
+	}
+	SSymbolHashSlot	emptySlot = {0,0};
+	mSectionHash.assign(numSlots, emptySlot);
+	uint32_t	mask = numSlots - 1;
+	for (uint32_t i = 1; i < numSections; i++)
+	{
+		const SSectEntry*	sectEntry = GetSection(i);
+		if (sectEntry->nameOffset >= namesSectEntry->size)
+		{
+			continue;
+		}
+		const char*	sectionName = GetSectionName(sectEntry);
+		if (*sectionName == 0)
+		{
+			continue;
+		}
+		uint32_t	hash = HashSymbolName(sectionName);
+		uint32_t	slotIndex = hash & mask;
+		for (; mSectionHash[slotIndex].symbolIndex; slotIndex = (slotIndex + 1) & mask)
+		{
+			const SSymbolHashSlot&	slot = mSectionHash[slotIndex];
+			if (slot.hash == hash &&
+				strcmp(sectionName, GetSectionName(GetSection(slot.symbolIndex-1))) == 0)
+			{
+				break;
+			}
+		}
+		if (mSectionHash[slotIndex].symbolIndex == 0)
+		{
+			mSectionHash[slotIndex].hash = hash;
+			mSectionHash[slotIndex].symbolIndex = i + 1;
+		}
+	}
+}
+
+/******************************* GetSymbolTable *******************************/
+const SSymbolTblEntry* ElfFile::GetSymbolTable(
+	uint32_t&	outNumSymbols) const
+{
+	const SSectEntry*	symTableSectEntry = mSectEntry[eSymbolTable];
+	outNumSymbols = symTableSectEntry->entrySize ? symTableSectEntry->size/symTableSectEntry->entrySize : 0;
+	return((const SSymbolTblEntry*)&mContent[symTableSectEntry->offset]);
+}
+
+/********************************* FindSymbol *********************************/
+/*
+*	Returns the first symbol table entry named inSymbolName or NULL if not
+*	found.  The hash is built on the first call.
+*/
+const SSymbolTblEntry* ElfFile::FindSymbol(
+	const char*	inSymbolName) const
 {
-	int32_t current;
-	int32_t leftIndex = 0;
-	int32_t rightIndex = eNumSectNames -1;
-	while (leftIndex <= rightIndex)
+	const SSymbolTblEntry*	symbolTblEntry = NULL;
+	if (mContent)
 	{
-		current = (leftIndex + rightIndex) / 2;
-		
-		int	cmpResult = strcmp(kSectName[current], inSectionName);
-		if (cmpResult == 0)
+		if (mSymbolHash.empty())
 		{
-			return(current);
-		} else if (cmpResult > 0)
+			BuildSymbolHash();
+		}
+		uint32_t	numSymTableEntries;
+		const SSymbolTblEntry*	symbolTable = GetSymbolTable(numSymTableEntries);
+		const char* stringTable = GetStringTable();
+		uint32_t	hash = HashSymbolName(inSymbolName);
+		uint32_t	mask = (uint32_t)mSymbolHash.size() - 1;
+		for (uint32_t slotIndex = hash & mask; mSymbolHash[slotIndex].symbolIndex; slotIndex = (slotIndex + 1) & mask)
 		{
-			rightIndex = current - 1;
+			const SSymbolHashSlot&	slot = mSymbolHash[slotIndex];
+			if (slot.hash == hash &&
+				strcmp(inSymbolName, &stringTable[symbolTable[slot.symbolIndex-1].name]) == 0)
+			{
+				symbolTblEntry = &symbolTable[slot.symbolIndex-1];
+				break;
+			}
+		}
+	}
+	return(symbolTblEntry);
+}
+
+/******************************** BuildIndexes ********************************/
+void ElfFile::BuildIndexes(void) const
+{
+	if (mContent &&
+		mSymbolHash.empty())
+	{
+		BuildSymbolHash();
+	}
+}
+
+/********************************* GetBuildID *********************************/
+/*
+*	The note is namesz, descsz, type (3 = NT_GNU_BUILD_ID), the name "GNU"
+*	padded to 4 bytes, followed by the build-id bytes.  The note is in the
+*	file's byte order.  namesz is always 4, which determines the order.
+*/
+bool ElfFile::GetBuildID(
+	std::string&	outBuildID) const
+{
+	outBuildID.clear();
+	const SSectEntry*	sectEntry = mContent ? FindSection(".note.gnu.build-id") : NULL;
+	if (sectEntry &&
+		sectEntry->size >= 16 &&
+		((size_t)sectEntry->offset + sectEntry->size) <= mFileSize)
+	{
+		const uint8_t*	note = &mContent[sectEntry->offset];
+		uint32_t	noteWords[3];
+		memcpy(noteWords, note, sizeof(noteWords));
+		if (noteWords[0] == 0x04000000)
+		{
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				noteWords[i] = __builtin_bswap32(noteWords[i]);
+			}
+		}
+		if (noteWords[0] == 4 &&
+			noteWords[2] == 3 &&
+			memcmp(&note[12], "GNU", 4) == 0 &&
+			noteWords[1] <= (sectEntry->size - 16))
+		{
+			static const char	kHexDigit[] = "0123456789abcdef";
+			for (uint32_t i = 0; i < noteWords[1]; i++)
+			{
+				outBuildID += kHexDigit[note[16 + i] >> 4];
+				outBuildID += kHexDigit[note[16 + i] & 0xF];
+			}
+		}
+	}
+	return(!outBuildID.empty());
+}
+
+/****************************** BuildSymbolHash *******************************/
+/*
+*	The hash has at least twice as many slots as there are symbols so the
+*	probe sequences stay short.  Only the first occurrence of a name is
+*	entered, matching the behavior of a linear search of the symbol table.
+*/
+void ElfFile::BuildSymbolHash(void) const
+{
+	uint32_t	numSymTableEntries;
+	const SSymbolTblEntry*	symbolTable = GetSymbolTable(numSymTableEntries);
+	const char* stringTable = GetStringTable();
+	uint32_t	numSlots = 16;
+	while (numSlots < (numSymTableEntries * 2))
+	{
+		numSlots <<= 1;
+	}
+	SSymbolHashSlot	emptySlot = {0,0};
+	mSymbolHash.assign(numSlots, emptySlot);
+	uint32_t	mask = numSlots - 1;
+	for (uint32_t i = 0; i < numSymTableEntries; i++)
+	{
+		const char*	symbolName = &stringTable[symbolTable[i].name];
+		if (*symbolName == 0)
+		{
+			continue;
+		}
+		uint32_t	hash = HashSymbolName(symbolName);
+		uint32_t	slotIndex = hash & mask;
+		for (; mSymbolHash[slotIndex].symbolIndex; slotIndex = (slotIndex + 1) & mask)
+		{
+			const SSymbolHashSlot&	slot = mSymbolHash[slotIndex];
+			if (slot.hash == hash &&
+				strcmp(symbolName, &stringTable[symbolTable[slot.symbolIndex-1].name]) == 0)
+			{
+				break;
+			}
+		}
+		if (mSymbolHash[slotIndex].symbolIndex == 0)
+		{
+			mSymbolHash[slotIndex].hash = hash;
+			mSymbolHash[slotIndex].symbolIndex = i + 1;
+		}
+	}
+}
+
+/******************************* HashSymbolName *******************************/
+/*
+*	32 bit FNV-1a
+*/
+uint32_t ElfFile::HashSymbolName(
+	const char*	inSymbolName)
+{
+	uint32_t	hash = 2166136261U;
+	for (const uint8_t* namePtr = (const uint8_t*)inSymbolName; *namePtr; namePtr++)
+	{
+		hash = (hash ^ *namePtr) * 16777619U;
+	}
+	return(hash);
+}
+
+/******************************* GetLoadImage *********************************/
+/*
+*	The load image is built from the program headers.  For an AVR this
+*	places .data's initial values in flash following .text.  If there are
+*	no program headers, the .text section followed by the .data section is
+*	used.
+*/
+bool ElfFile::GetLoadImage(
+	uint32_t				inStartAddr,
+	uint32_t				inEndAddr,
+	std::vector<uint8_t>&	outImage,
+	uint32_t&				outImageAddr) const
+{
+	struct SLoadSegment
+	{
+		uint32_t	loadAddr;
+		uint32_t	offset;
+		uint32_t	size;
+	} segments[16];
+	uint32_t	numSegments = 0;
+	outImage.clear();
+	outImageAddr = 0;
+	if (mContent)
+	{
+		if (mNumProgEntries)
+		{
+			for (uint16_t i = 0; i < mNumProgEntries && numSegments < 16; i++)
+			{
+				const SProgEntry*	progEntry = GetProgEntry(i);
+				if (progEntry->type == eProgLoad &&
+					progEntry->sizeOnFile &&
+					progEntry->physicalAddr >= inStartAddr &&
+					progEntry->physicalAddr < inEndAddr &&
+					((size_t)progEntry->offset + progEntry->sizeOnFile) <= mFileSize)
+				{
+					SLoadSegment	segment = {progEntry->physicalAddr, progEntry->offset, progEntry->sizeOnFile};
+					segments[numSegments++] = segment;
+				}
+			}
 		} else
 		{
-			leftIndex = current + 1;
+			const SSectEntry*	textSect = mSectEntry[eText];
+			const SSectEntry*	dataSect = mSectEntry[eData];
+			if (textSect->addrInMem >= inStartAddr &&
+				textSect->addrInMem < inEndAddr)
+			{
+				SLoadSegment	segment = {textSect->addrInMem, textSect->offset, textSect->size};
+				segments[numSegments++] = segment;
+				if (dataSect &&
+					dataSect->size &&
+					((size_t)dataSect->offset + dataSect->size) <= mFileSize)
+				{
+					SLoadSegment	dataSegment = {textSect->addrInMem + textSect->size, dataSect->offset, dataSect->size};
+					segments[numSegments++] = dataSegment;
+				}
+			}
+		}
+		if (numSegments)
+		{
+			uint32_t	imageStart = 0xFFFFFFFF;
+			uint32_t	imageEnd = 0;
+			for (uint32_t i = 0; i < numSegments; i++)
+			{
+				if (segments[i].loadAddr < imageStart)
+				{
+					imageStart = segments[i].loadAddr;
+				}
+				if ((segments[i].loadAddr + segments[i].size) > imageEnd)
+				{
+					imageEnd = segments[i].loadAddr + segments[i].size;
+				}
+			}
+			outImage.assign(imageEnd - imageStart, 0xFF);
+			for (uint32_t i = 0; i < numSegments; i++)
+			{
+				memcpy(&outImage[segments[i].loadAddr - imageStart], &mContent[segments[i].offset], segments[i].size);
+			}
+			outImageAddr = imageStart;
 		}
 	}
-	return(eInvalidSect);
+	return(numSegments != 0);
+}
+
+/*************************** SectionNameToIndex *******************************/
+/*
+*	Returns the ESectName of inSectionName or eInvalidSect if it's not one of
+*	the well known names.  One hash of the name and one strcmp.
+*/
+uint32_t ElfFile::SectionNameToIndex(
+	const char*	inSectionName)
+{
+	uint32_t	sectName = kSectNameSlots.sectName[SectNameSlot(inSectionName)];
+	return((sectName < eNumSectNames && strcmp(kSectName[sectName], inSectionName) == 0) ?
+				sectName : (uint32_t)eInvalidSect);
 }
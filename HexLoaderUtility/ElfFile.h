@@ -29,12 +29,14 @@
 #define ElfFile_h
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 struct SElfHeader
 {
 	uint32_t	magicNumber;	// 0x7f + ELF
 	uint8_t		formatType;		// 1 = 32, 2 = 64 bit format
-	uint8_t		endianType;		// 1 = little, 2 = big (this code assumes little)
+	uint8_t		endianType;		// 1 = little, 2 = big (see ElfNormalizer.h)
 	uint8_t		version;		// 1 = original ELF version
 	uint8_t		target;
 	uint8_t		abiVersion;
@@ -89,22 +91,65 @@ uint8_t		other;
 uint16_t	shndx;
 };
 
+// Symbol types, the low 4 bits of SSymbolTblEntry::info
+enum ESymbolType
+{
+	eSymNoType,
+	eSymObject,
+	eSymFunc,
+	eSymSection,
+	eSymFile
+};
+
+// Reserved SSymbolTblEntry::shndx values
+enum
+{
+	eShndxUndef			= 0,
+	eShndxLoReserve		= 0xFF00,
+	eShndxAbs			= 0xFFF1
+};
+
+// SProgEntry::type values
+enum
+{
+	eProgNull,
+	eProgLoad
+};
+
+struct SSymbolHashSlot
+{
+	uint32_t	hash;
+	uint32_t	symbolIndex;	// Index into the symbol table + 1, 0 = empty slot
+};
+
+typedef std::vector<SSymbolHashSlot> SymbolHash;
+
 // ESectName mirrors kSectName.  Any change made here must be reflected in kSectName
 enum ESectName
 {
 	eBSS,
 	eComment,
 	eData,
-//	eDebugAbbrev,
-//	eDebugAranges,
-//	eDebugFrame,
-//	eDebugInfo,
-//	eDebugLine,
-//	eDebugLoc,
-//	eDebugRanges,
-//	eDebugStr,
-//	eNoteGnuAvrDeviceInfo,
+	eDebugAbbrev,
+	eDebugAranges,
+	eDebugFrame,
+	eDebugInfo,
+	eDebugLine,
+	eDebugLineStr,
+	eDebugLoc,
+	eDebugLocLists,
+	eDebugRanges,
+	eDebugRngLists,
+	eDebugStr,
+	eEEPROM,
+	eFuse,
+	eLock,
+	eNoInit,
+	eNoteGnuAvrDeviceInfo,
 	eShStringTable,
+	eSignature,
+	eStab,
+	eStabStr,
 	eStringTable,
 	eSymbolTable,
 	eText,
@@ -117,28 +162,158 @@ class ElfFile
 public:
 							ElfFile(void);
 	virtual					~ElfFile(void);
+	/*
+	*	By default the file is memory mapped read-only.  Only the pages
+	*	actually referenced (headers, .text, .data, .symtab, .strtab) are
+	*	read from disk.  The mapping is private so any patches made to the
+	*	content are copy-on-write and never reach the file on disk.
+	*	Pass false for inMapFile to read the entire file into memory.
+	*/
 	bool					ReadFile(
-								const char*				inPath);
+								const char*				inPath,
+								bool					inMapFile = true);
 	bool					WriteFile(
 								const char*				inPath);
 	SSectEntry*				GetSectEntry(
 								ESectName				inESectName)
 							{return(mSectEntry[inESectName]);}
-	void					FreeMem(void);
+	const SSectEntry*		GetSectEntry(
+								ESectName				inESectName) const
+							{return(mSectEntry[inESectName]);}
+	virtual void			FreeMem(void);
+	bool					IsMapped(void) const
+								{return(mIsMapped);}
+	/*
+	*	True if the file isn't ELF32 with the host byte order.  The
+	*	content is then an ELF32 image converted from the file (see
+	*	ElfNormalizer.h) and WriteFile isn't supported.
+	*/
+	bool					IsNormalized(void) const
+								{return(mIsNormalized);}
+	/*
+	*	Must be called prior to modifying any part of mContent.  When the
+	*	file is mapped, the pages containing the range are made writable
+	*	(copy-on-write.)
+	*/
+	bool					MakeContentWritable(
+								uint32_t				inOffset,
+								uint32_t				inSize);
 	uint8_t*				GetSymbolValuePtr(
 								const char*				inSymbolName,
 								const SSymbolTblEntry**	outSymTblEntry = NULL);
+	/*
+	*	Resolves inCount symbol names in one pass.  outValuePtrs and
+	*	outSymTblEntries (when not NULL) must have room for inCount entries.
+	*	Each entry is set as GetSymbolValuePtr would set it, NULL when not
+	*	found.  Returns the number of symbols found.
+	*/
+	uint32_t				GetSymbolValuePtrs(
+								const char* const*		inSymbolNames,
+								uint32_t				inCount,
+								uint8_t**				outValuePtrs,
+								const SSymbolTblEntry**	outSymTblEntries = NULL);
+	const SSymbolTblEntry*	FindSymbol(
+								const char*				inSymbolName) const;
+	const SSymbolTblEntry*	GetSymbolTable(
+								uint32_t&				outNumSymbols) const;
+	uint16_t				GetNumProgEntries(void) const
+								{return(mNumProgEntries);}
+	const SProgEntry*		GetProgEntry(
+								uint16_t				inIndex) const
+								{return(&((const SProgEntry*)&mContent[mHeader->progHdrOffset])[inIndex]);}
+	/*
+	*	Builds the image of the loadable content whose load (physical)
+	*	address is within inStartAddr to inEndAddr.  Gaps between segments
+	*	are filled with 0xFF.  outImageAddr is set to the load address of
+	*	outImage[0].  Returns false if there's no content within the range.
+	*/
+	bool					GetLoadImage(
+								uint32_t				inStartAddr,
+								uint32_t				inEndAddr,
+								std::vector<uint8_t>&	outImage,
+								uint32_t&				outImageAddr) const;
+	uint16_t				GetNumSections(void) const
+								{return(mHeader->numSectEntries);}
+	const SSectEntry*		GetSection(
+								uint16_t				inIndex) const
+								{return(&((const SSectEntry*)&mContent[mHeader->sectHdrOffset])[inIndex]);}
+	const char*				GetSectionName(
+								const SSectEntry*		inSectEntry) const;
+	/*
+	*	Returns the section header index (the SSymbolTblEntry shndx) of the
+	*	named section, 0 (undefined) if the section doesn't exist.
+	*/
+	uint16_t				GetSectionIndex(
+								ESectName				inESectName) const;
+	/*
+	*	Returns the ESectName of the section at section header index
+	*	inIndex, eInvalidSect if the section isn't one of the well known
+	*	sections or inIndex isn't a valid section index.
+	*/
+	ESectName				GetSectName(
+								uint16_t				inIndex) const
+								{return(inIndex < mShndxLkup.size() ? (ESectName)mShndxLkup[inIndex] : eInvalidSect);}
+	/*
+	*	Returns the section named inSectionName, any name, or NULL if the
+	*	section doesn't exist.  outIndex (when not NULL) is set to the
+	*	section header index, 0 if not found.
+	*/
+	const SSectEntry*		FindSection(
+								const char*				inSectionName,
+								uint16_t*				outIndex = NULL) const;
+	/*
+	*	Sets outBuildID to the hex string of the GNU build-id note.
+	*	Returns false if the file doesn't have a build-id.
+	*/
+	bool					GetBuildID(
+								std::string&			outBuildID) const;
+	/*
+	*	Builds the lookup indexes that are otherwise built on first use.
+	*	Once built, the const lookup routines don't modify the object and
+	*	can be called concurrently.
+	*/
+	virtual void			BuildIndexes(void) const;
+	const char*				GetStringTable(void) const
+								{return((const char*)&mContent[mSectEntry[eStringTable]->offset]);}
 	uint8_t*				GetTextPtr(void)
 								{return((uint8_t*)&mContent[GetSectEntry(eText)->offset]);}
+	const uint8_t*			GetTextPtr(void) const
+								{return(&mContent[GetSectEntry(eText)->offset]);}
 protected:
 	uint8_t*	mContent;
-	fpos_t		mFileSize;
+	size_t		mFileSize;
+	bool		mIsMapped;
+	bool		mIsNormalized;
 	SElfHeader*	mHeader;
 	SSectEntry*	mSectEntry[eNumSectNames];
-	uint16_t	mShndxLkup[eNumSectNames];
+	/*
+	*	mShndxLkup has an entry for every section header index.  The entry
+	*	is the section's ESectName, eInvalidSect if the section isn't one of
+	*	the well known sections.
+	*/
+	std::vector<uint8_t>	mShndxLkup;
+	/*
+	*	mSectionHash is an open addressing hash of all of the section names,
+	*	the same layout as mSymbolHash.  symbolIndex is the section header
+	*	index + 1.
+	*/
+	SymbolHash	mSectionHash;
+	uint16_t	mNumProgEntries;
+	/*
+	*	mSymbolHash is an open addressing hash of the symbol names, built on
+	*	the first symbol lookup.  The number of slots is a power of 2.
+	*/
+	mutable SymbolHash	mSymbolHash;
 	
 	virtual bool			HasRequiredSections(void) const;
+	void					NormalizeContent(void);
+	void					BuildSymbolHash(void) const;
+	uint8_t*				SymbolValuePtr(
+								const SSymbolTblEntry*	inSymTblEntry) const;
+	static uint32_t			HashSymbolName(
+								const char*				inSymbolName);
 
+	void					BuildSectionHash(void);
 	static uint32_t			SectionNameToIndex(
 								const char*				inSectionName);
 
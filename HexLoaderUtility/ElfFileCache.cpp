@@ -0,0 +1,129 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  ElfFileCache.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#include "ElfFileCache.h"
+#include <sys/stat.h>
+
+#ifdef __APPLE__
+#define ST_MTIM	st_mtimespec
+#else
+#define ST_MTIM	st_mtim
+#endif
+
+/******************************** ElfFileCache ********************************/
+ElfFileCache::ElfFileCache(void)
+{
+}
+
+/******************************* ~ElfFileCache ********************************/
+ElfFileCache::~ElfFileCache(void)
+{
+}
+
+/********************************* GetElfFile *********************************/
+AVRElfFilePtr ElfFileCache::GetElfFile(
+	const std::string&	inPath)
+{
+	AVRElfFilePtr	elfFile;
+	struct stat	fileStat;
+	if (stat(inPath.c_str(), &fileStat) == 0)
+	{
+		int64_t	modTime = ((int64_t)fileStat.ST_MTIM.tv_sec * 1000000000) + fileStat.ST_MTIM.tv_nsec;
+		{
+			std::lock_guard<std::mutex>	lock(mMutex);
+			ElfFileCacheMap::iterator	itr = mMap.find(inPath);
+			if (itr != mMap.end() &&
+				itr->second.fileSize == fileStat.st_size &&
+				itr->second.modTime == modTime)
+			{
+				elfFile = itr->second.elfFile;
+			}
+		}
+		/*
+		*	If not cached or the file changed THEN
+		*	read the file outside of the lock.
+		*/
+		if (!elfFile)
+		{
+			AVRElfFile*	newElfFile = new AVRElfFile;
+			if (newElfFile->ReadFile(inPath.c_str(), false))
+			{
+				SElfFileCacheEntry	entry;
+				newElfFile->GetBuildID(entry.buildID);
+				entry.fileSize = fileStat.st_size;
+				entry.modTime = modTime;
+				std::lock_guard<std::mutex>	lock(mMutex);
+				ElfFileCacheMap::iterator	itr = mMap.find(inPath);
+				/*
+				*	If the build-id is unchanged THEN
+				*	keep the cached file (its indexes are already built.)
+				*/
+				if (itr != mMap.end() &&
+					!entry.buildID.empty() &&
+					itr->second.buildID == entry.buildID)
+				{
+					delete newElfFile;
+					itr->second.fileSize = entry.fileSize;
+					itr->second.modTime = entry.modTime;
+					elfFile = itr->second.elfFile;
+				} else
+				{
+					newElfFile->BuildIndexes();
+					elfFile.reset(newElfFile);
+					entry.elfFile = elfFile;
+					mMap[inPath] = entry;
+				}
+			} else
+			{
+				delete newElfFile;
+				EraseElfFile(inPath);
+			}
+		}
+	} else
+	{
+		EraseElfFile(inPath);
+	}
+	return(elfFile);
+}
+
+/******************************** EraseElfFile ********************************/
+/*
+*	Files already handed out remain valid until released.
+*/
+void ElfFileCache::EraseElfFile(
+	const std::string&	inPath)
+{
+	std::lock_guard<std::mutex>	lock(mMutex);
+	mMap.erase(inPath);
+}
+
+/*********************************** Clear ************************************/
+void ElfFileCache::Clear(void)
+{
+	std::lock_guard<std::mutex>	lock(mMutex);
+	mMap.clear();
+}
@@ -0,0 +1,82 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  ElfFileCache.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#ifndef ElfFileCache_h
+#define ElfFileCache_h
+
+#include "AVRElfFile.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+typedef std::shared_ptr<const AVRElfFile> AVRElfFilePtr;
+
+struct SElfFileCacheEntry
+{
+	AVRElfFilePtr	elfFile;
+	off_t			fileSize;
+	int64_t			modTime;	// nanoseconds
+	std::string		buildID;	// Empty if the file has no build-id note
+};
+
+typedef std::map<std::string, SElfFileCacheEntry> ElfFileCacheMap;
+
+/*
+*	ElfFileCache keeps the elf files that have been loaded, keyed by path.
+*	A cached file is returned when the file's size and modification time are
+*	unchanged, at the cost of one stat.  If they changed but the GNU
+*	build-id is the same, the cached file is still returned (e.g. the
+*	file was copied or touched.)
+*
+*	The files handed out are immutable and their symbol and section indexes
+*	are already built, so they can be shared between threads.  Code that
+*	patches an elf file must read its own copy.
+*
+*	Cached files are read into memory rather than mapped because a build
+*	can rewrite the file in place while it's cached.
+*/
+class ElfFileCache
+{
+public:
+							ElfFileCache(void);
+							~ElfFileCache(void);
+	/*
+	*	Returns an empty pointer if the file can't be read or isn't a valid
+	*	elf file.
+	*/
+	AVRElfFilePtr			GetElfFile(
+								const std::string&		inPath);
+	void					EraseElfFile(
+								const std::string&		inPath);
+	void					Clear(void);
+protected:
+	std::mutex		mMutex;
+	ElfFileCacheMap	mMap;
+};
+
+#endif /* ElfFileCache_h */
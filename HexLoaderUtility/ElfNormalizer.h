@@ -0,0 +1,381 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  ElfNormalizer.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#ifndef ElfNormalizer_h
+#define ElfNormalizer_h
+
+#include "ElfFile.h"
+#include <string.h>
+
+/*
+*	ElfFile works directly on the file content using the ELF32 structs
+*	declared in ElfFile.h.  This is the layout of AVR and ARM Cortex-M elf
+*	files (ELF32, little endian), so for these nothing is converted.
+*
+*	Any other class/endianness combination is converted by ElfNormalizer to
+*	an ELF32 image with the host byte order.  ElfNormalizer is a template
+*	on the file's class (SElf32Class or SElf64Class) and on whether the
+*	file's byte order differs from the host's.  The byte order accessors
+*	are resolved at compile time; when no swap is needed they're the
+*	identity.  Only the combinations dispatched by ElfFile::ReadFile are
+*	instantiated.
+*
+*	The normalized image is:
+*		ELF32 header
+*		section header table
+*		program header table (if any)
+*		converted symbol tables
+*		the original file content
+*	Section and program header offsets are adjusted to refer to the copy
+*	of the original content.  Except for the symbol tables, the section
+*	content is not converted (it's target content, strings, etc.)
+*/
+
+enum
+{
+	eElfClass32		= 1,
+	eElfClass64		= 2,
+	eElfLittleEndian	= 1,
+	eElfBigEndian		= 2,
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	eElfHostEndian		= eElfBigEndian
+#else
+	eElfHostEndian		= eElfLittleEndian
+#endif
+};
+
+// SSectEntry::type values referenced when normalizing
+enum
+{
+	eSectTypeSymTab		= 2,
+	eSectTypeDynSym		= 11
+};
+
+/*
+*	ELF64 file layouts.  The field names match the ELF32 structs so that
+*	ElfNormalizer can be written once for both classes.
+*/
+struct SElf64Header
+{
+	uint32_t	magicNumber;
+	uint8_t		formatType;
+	uint8_t		endianType;
+	uint8_t		version;
+	uint8_t		target;
+	uint8_t		abiVersion;
+	uint8_t		unused[7];
+	uint16_t	objFileType;
+	uint16_t	isa;
+	uint32_t	version1;
+	uint64_t	entryPoint;
+	uint64_t	progHdrOffset;
+	uint64_t	sectHdrOffset;
+	uint32_t	flags;
+	uint16_t	headerSize;
+	uint16_t	progHdrSize;
+	uint16_t	numProgEntries;
+	uint16_t	sectHdrSize;
+	uint16_t	numSectEntries;
+	uint16_t	sectEntryNamesIndex;
+};
+
+struct SElf64ProgEntry
+{
+	uint32_t	type;
+	uint32_t	flags;
+	uint64_t	offset;
+	uint64_t	virtualAddr;
+	uint64_t	physicalAddr;
+	uint64_t	sizeOnFile;
+	uint64_t	sizeInMem;
+	uint64_t	align;
+};
+
+struct SElf64SectEntry
+{
+	uint32_t	nameOffset;
+	uint32_t	type;
+	uint64_t	flags;
+	uint64_t	addrInMem;
+	uint64_t	offset;
+	uint64_t	size;
+	uint32_t	link;
+	uint32_t	info;
+	uint64_t	addrAlignment;
+	uint64_t	entrySize;
+};
+
+struct SElf64SymbolTblEntry
+{
+	uint32_t	name;
+	uint8_t		info;
+	uint8_t		other;
+	uint16_t	shndx;
+	uint64_t	value;
+	uint64_t	size;
+};
+
+static_assert(sizeof(SElfHeader) == 52 && sizeof(SElf64Header) == 64, "Unexpected ELF header size");
+static_assert(sizeof(SSectEntry) == 40 && sizeof(SElf64SectEntry) == 64, "Unexpected section entry size");
+static_assert(sizeof(SProgEntry) == 32 && sizeof(SElf64ProgEntry) == 56, "Unexpected program entry size");
+static_assert(sizeof(SSymbolTblEntry) == 16 && sizeof(SElf64SymbolTblEntry) == 24, "Unexpected symbol entry size");
+
+struct SElf32Class
+{
+	typedef SElfHeader				Header;
+	typedef SProgEntry				ProgEntry;
+	typedef SSectEntry				SectEntry;
+	typedef SSymbolTblEntry			SymbolTblEntry;
+};
+
+struct SElf64Class
+{
+	typedef SElf64Header			Header;
+	typedef SElf64ProgEntry			ProgEntry;
+	typedef SElf64SectEntry			SectEntry;
+	typedef SElf64SymbolTblEntry	SymbolTblEntry;
+};
+
+template <bool kSwap>
+struct ElfByteOrder
+{
+	static inline uint8_t	Get(uint8_t inValue)
+								{return(inValue);}
+	static inline uint16_t	Get(uint16_t inValue)
+								{return(kSwap ? __builtin_bswap16(inValue) : inValue);}
+	static inline uint32_t	Get(uint32_t inValue)
+								{return(kSwap ? __builtin_bswap32(inValue) : inValue);}
+	static inline uint64_t	Get(uint64_t inValue)
+								{return(kSwap ? __builtin_bswap64(inValue) : inValue);}
+};
+
+template <class TElfClass, bool kSwap>
+class ElfNormalizer
+{
+public:
+	typedef typename TElfClass::Header			Header;
+	typedef typename TElfClass::ProgEntry		ProgEntry;
+	typedef typename TElfClass::SectEntry		SectEntry;
+	typedef typename TElfClass::SymbolTblEntry	SymbolTblEntry;
+	typedef ElfByteOrder<kSwap>					ByteOrder;
+
+	/*
+	*	Returns the normalized image allocated with new [], or NULL if the
+	*	file isn't valid or an address doesn't fit in 32 bits.  outSize is
+	*	the size of the normalized image.
+	*/
+	static uint8_t*			Normalize(
+								const uint8_t*			inContent,
+								size_t					inSize,
+								size_t&					outSize);
+protected:
+	template <typename T>
+	static inline T			Read(
+								const uint8_t*			inPtr)
+							{
+								T	value;
+								memcpy(&value, inPtr, sizeof(T));
+								return(value);
+							}
+	static inline bool		Fits(
+								uint64_t				inValue)
+								{return(inValue <= 0xFFFFFFFF);}
+};
+
+/********************************* Normalize **********************************/
+template <class TElfClass, bool kSwap>
+uint8_t* ElfNormalizer<TElfClass, kSwap>::Normalize(
+	const uint8_t*	inContent,
+	size_t			inSize,
+	size_t&			outSize)
+{
+	outSize = 0;
+	if (inSize < sizeof(Header))
+	{
+		return(NULL);
+	}
+	Header	fileHeader = Read<Header>(inContent);
+	uint64_t	sectHdrOffset = ByteOrder::Get(fileHeader.sectHdrOffset);
+	uint64_t	progHdrOffset = ByteOrder::Get(fileHeader.progHdrOffset);
+	uint16_t	numSectEntries = ByteOrder::Get(fileHeader.numSectEntries);
+	uint16_t	numProgEntries = ByteOrder::Get(fileHeader.numProgEntries);
+	uint16_t	sectEntryNamesIndex = ByteOrder::Get(fileHeader.sectEntryNamesIndex);
+	if (ByteOrder::Get(fileHeader.sectHdrSize) != sizeof(SectEntry) ||
+		sectHdrOffset + ((uint64_t)numSectEntries * sizeof(SectEntry)) > inSize ||
+		sectEntryNamesIndex >= numSectEntries)
+	{
+		return(NULL);
+	}
+	/*
+	*	The program header table is optional.  As in ElfFile::ReadFile, it's
+	*	ignored if it's not within the file.
+	*/
+	if (!progHdrOffset ||
+		ByteOrder::Get(fileHeader.progHdrSize) != sizeof(ProgEntry) ||
+		progHdrOffset + ((uint64_t)numProgEntries * sizeof(ProgEntry)) > inSize)
+	{
+		numProgEntries = 0;
+	}
+
+	/*
+	*	Determine the size of the converted symbol tables.
+	*/
+	const uint8_t*	fileSectEntries = &inContent[sectHdrOffset];
+	uint64_t	symbolTablesSize = 0;
+	for (uint32_t i = 0; i < numSectEntries; i++)
+	{
+		SectEntry	sectEntry = Read<SectEntry>(&fileSectEntries[i * sizeof(SectEntry)]);
+		uint32_t	type = ByteOrder::Get(sectEntry.type);
+		if (type == eSectTypeSymTab || type == eSectTypeDynSym)
+		{
+			uint64_t	offset = ByteOrder::Get(sectEntry.offset);
+			uint64_t	size = ByteOrder::Get(sectEntry.size);
+			if (offset + size > inSize)
+			{
+				return(NULL);
+			}
+			symbolTablesSize += (size / sizeof(SymbolTblEntry)) * sizeof(SSymbolTblEntry);
+		}
+	}
+	uint64_t	sectHdrOut = sizeof(SElfHeader);
+	uint64_t	progHdrOut = sectHdrOut + ((uint64_t)numSectEntries * sizeof(SSectEntry));
+	uint64_t	symbolTablesOut = progHdrOut + ((uint64_t)numProgEntries * sizeof(SProgEntry));
+	uint64_t	contentOut = (symbolTablesOut + symbolTablesSize + 7) & ~(uint64_t)7;
+	if (!Fits(contentOut + inSize))
+	{
+		return(NULL);
+	}
+	uint8_t*	normalized = new uint8_t[contentOut + inSize];
+	memset(normalized, 0, contentOut);
+	memcpy(&normalized[contentOut], inContent, inSize);
+	bool	success = true;
+
+	/*
+	*	Header
+	*/
+	SElfHeader*	header = (SElfHeader*)normalized;
+	header->magicNumber = fileHeader.magicNumber;
+	header->formatType = eElfClass32;
+	header->endianType = eElfHostEndian;
+	header->version = fileHeader.version;
+	header->target = fileHeader.target;
+	header->abiVersion = fileHeader.abiVersion;
+	memcpy(header->unused, fileHeader.unused, sizeof(header->unused));
+	header->objFileType = ByteOrder::Get(fileHeader.objFileType);
+	header->isa = ByteOrder::Get(fileHeader.isa);
+	header->version1 = ByteOrder::Get(fileHeader.version1);
+	header->entryPoint = (uint32_t)ByteOrder::Get(fileHeader.entryPoint);
+	header->progHdrOffset = numProgEntries ? (uint32_t)progHdrOut : 0;
+	header->sectHdrOffset = (uint32_t)sectHdrOut;
+	header->flags = ByteOrder::Get(fileHeader.flags);
+	header->headerSize = sizeof(SElfHeader);
+	header->progHdrSize = sizeof(SProgEntry);
+	header->numProgEntries = numProgEntries;
+	header->sectHdrSize = sizeof(SSectEntry);
+	header->numSectEntries = numSectEntries;
+	header->sectEntryNamesIndex = sectEntryNamesIndex;
+
+	/*
+	*	Section header table and symbol tables
+	*/
+	SSectEntry*	sectEntryOut = (SSectEntry*)&normalized[sectHdrOut];
+	uint64_t	symbolTableOut = symbolTablesOut;
+	for (uint32_t i = 0; success && i < numSectEntries; i++, sectEntryOut++)
+	{
+		SectEntry	sectEntry = Read<SectEntry>(&fileSectEntries[i * sizeof(SectEntry)]);
+		uint64_t	addrInMem = ByteOrder::Get(sectEntry.addrInMem);
+		uint64_t	offset = ByteOrder::Get(sectEntry.offset);
+		uint64_t	size = ByteOrder::Get(sectEntry.size);
+		success = Fits(addrInMem) && Fits(size);
+		sectEntryOut->nameOffset = ByteOrder::Get(sectEntry.nameOffset);
+		sectEntryOut->type = ByteOrder::Get(sectEntry.type);
+		sectEntryOut->flags = (uint32_t)ByteOrder::Get(sectEntry.flags);
+		sectEntryOut->addrInMem = (uint32_t)addrInMem;
+		sectEntryOut->offset = (uint32_t)(Fits(contentOut + offset) ? contentOut + offset : 0);
+		sectEntryOut->size = (uint32_t)size;
+		sectEntryOut->link = ByteOrder::Get(sectEntry.link);
+		sectEntryOut->info = ByteOrder::Get(sectEntry.info);
+		sectEntryOut->addrAlignment = (uint32_t)ByteOrder::Get(sectEntry.addrAlignment);
+		sectEntryOut->entrySize = (uint32_t)ByteOrder::Get(sectEntry.entrySize);
+		if (sectEntryOut->type == eSectTypeSymTab ||
+			sectEntryOut->type == eSectTypeDynSym)
+		{
+			uint32_t	numSymbols = (uint32_t)(size / sizeof(SymbolTblEntry));
+			SSymbolTblEntry*	symbolOut = (SSymbolTblEntry*)&normalized[symbolTableOut];
+			for (uint32_t j = 0; j < numSymbols; j++, symbolOut++)
+			{
+				SymbolTblEntry	symbol = Read<SymbolTblEntry>(&inContent[offset + (j * sizeof(SymbolTblEntry))]);
+				symbolOut->name = ByteOrder::Get(symbol.name);
+				// Values of ABS symbols that don't fit in 32 bits are truncated.
+				symbolOut->value = (uint32_t)ByteOrder::Get(symbol.value);
+				symbolOut->size = (uint32_t)ByteOrder::Get(symbol.size);
+				symbolOut->info = symbol.info;
+				symbolOut->other = symbol.other;
+				symbolOut->shndx = ByteOrder::Get(symbol.shndx);
+			}
+			sectEntryOut->offset = (uint32_t)symbolTableOut;
+			sectEntryOut->size = numSymbols * sizeof(SSymbolTblEntry);
+			sectEntryOut->entrySize = sizeof(SSymbolTblEntry);
+			symbolTableOut += sectEntryOut->size;
+		}
+	}
+
+	/*
+	*	Program header table
+	*/
+	SProgEntry*	progEntryOut = (SProgEntry*)&normalized[progHdrOut];
+	for (uint32_t i = 0; success && i < numProgEntries; i++, progEntryOut++)
+	{
+		ProgEntry	progEntry = Read<ProgEntry>(&inContent[progHdrOffset + (i * sizeof(ProgEntry))]);
+		uint64_t	offset = ByteOrder::Get(progEntry.offset);
+		uint64_t	virtualAddr = ByteOrder::Get(progEntry.virtualAddr);
+		uint64_t	physicalAddr = ByteOrder::Get(progEntry.physicalAddr);
+		uint64_t	sizeOnFile = ByteOrder::Get(progEntry.sizeOnFile);
+		uint64_t	sizeInMem = ByteOrder::Get(progEntry.sizeInMem);
+		success = Fits(virtualAddr) && Fits(physicalAddr) && Fits(sizeInMem) &&
+					offset + sizeOnFile <= inSize;
+		progEntryOut->type = ByteOrder::Get(progEntry.type);
+		progEntryOut->offset = (uint32_t)(contentOut + offset);
+		progEntryOut->virtualAddr = (uint32_t)virtualAddr;
+		progEntryOut->physicalAddr = (uint32_t)physicalAddr;
+		progEntryOut->sizeOnFile = (uint32_t)sizeOnFile;
+		progEntryOut->sizeInMem = (uint32_t)sizeInMem;
+		progEntryOut->flags = ByteOrder::Get(progEntry.flags);
+		progEntryOut->align = (uint32_t)ByteOrder::Get(progEntry.align);
+	}
+	if (success)
+	{
+		outSize = contentOut + inSize;
+	} else
+	{
+		delete [] normalized;
+		normalized = NULL;
+	}
+	return(normalized);
+}
+
+#endif /* ElfNormalizer_h */
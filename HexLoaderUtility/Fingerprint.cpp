@@ -0,0 +1,149 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  Fingerprint.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#include "Fingerprint.h"
+#include <string.h>
+
+static const uint64_t	kPrime1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t	kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t	kPrime3 = 0x165667B19E3779F9ULL;
+static const uint64_t	kPrime4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t	kPrime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t RotateLeft(
+	uint64_t	inValue,
+	uint32_t	inBits)
+{
+	return((inValue << inBits) | (inValue >> (64 - inBits)));
+}
+
+static inline uint64_t Read64(
+	const uint8_t*	inPtr)
+{
+	uint64_t	value;
+	memcpy(&value, inPtr, sizeof(value));
+	return(value);
+}
+
+static inline uint32_t Read32(
+	const uint8_t*	inPtr)
+{
+	uint32_t	value;
+	memcpy(&value, inPtr, sizeof(value));
+	return(value);
+}
+
+static inline uint64_t Round(
+	uint64_t	inAccumulator,
+	uint64_t	inInput)
+{
+	return(RotateLeft(inAccumulator + (inInput * kPrime2), 31) * kPrime1);
+}
+
+static inline uint64_t MergeRound(
+	uint64_t	inAccumulator,
+	uint64_t	inValue)
+{
+	return(((inAccumulator ^ Round(0, inValue)) * kPrime1) + kPrime4);
+}
+
+/************************************ Hash ************************************/
+/*
+*	The input is consumed 32 bytes at a time by four independent
+*	accumulators, then the tail 8, 4, and 1 bytes at a time.  The reads
+*	assume a little endian host (all of the hosts this app runs on.)
+*/
+uint64_t Fingerprint::Hash(
+	const void*	inData,
+	size_t		inLength,
+	uint64_t	inSeed)
+{
+	const uint8_t*	data = (const uint8_t*)inData;
+	const uint8_t*	dataEnd = &data[inLength];
+	uint64_t	hash;
+	if (inLength >= 32)
+	{
+		uint64_t	acc1 = inSeed + kPrime1 + kPrime2;
+		uint64_t	acc2 = inSeed + kPrime2;
+		uint64_t	acc3 = inSeed;
+		uint64_t	acc4 = inSeed - kPrime1;
+		const uint8_t*	blocksEnd = dataEnd - 32;
+		for (; data <= blocksEnd; data += 32)
+		{
+			acc1 = Round(acc1, Read64(data));
+			acc2 = Round(acc2, Read64(&data[8]));
+			acc3 = Round(acc3, Read64(&data[16]));
+			acc4 = Round(acc4, Read64(&data[24]));
+		}
+		hash = RotateLeft(acc1, 1) + RotateLeft(acc2, 7) + RotateLeft(acc3, 12) + RotateLeft(acc4, 18);
+		hash = MergeRound(hash, acc1);
+		hash = MergeRound(hash, acc2);
+		hash = MergeRound(hash, acc3);
+		hash = MergeRound(hash, acc4);
+	} else
+	{
+		hash = inSeed + kPrime5;
+	}
+	hash += inLength;
+	for (; (data + 8) <= dataEnd; data += 8)
+	{
+		hash ^= Round(0, Read64(data));
+		hash = (RotateLeft(hash, 27) * kPrime1) + kPrime4;
+	}
+	if ((data + 4) <= dataEnd)
+	{
+		hash ^= Read32(data) * kPrime1;
+		hash = (RotateLeft(hash, 23) * kPrime2) + kPrime3;
+		data += 4;
+	}
+	for (; data < dataEnd; data++)
+	{
+		hash ^= *data * kPrime5;
+		hash = RotateLeft(hash, 11) * kPrime1;
+	}
+	hash ^= hash >> 33;
+	hash *= kPrime2;
+	hash ^= hash >> 29;
+	hash *= kPrime3;
+	hash ^= hash >> 32;
+	return(hash);
+}
+
+/********************************** ToString **********************************/
+const std::string& Fingerprint::ToString(
+	uint64_t		inFingerprint,
+	std::string&	outString)
+{
+	static const char	kHexDigit[] = "0123456789abcdef";
+	outString.resize(16);
+	for (uint32_t i = 16; i; i--)
+	{
+		outString[i-1] = kHexDigit[inFingerprint & 0xF];
+		inFingerprint >>= 4;
+	}
+	return(outString);
+}
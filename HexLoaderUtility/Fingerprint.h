@@ -0,0 +1,60 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  Fingerprint.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#ifndef Fingerprint_h
+#define Fingerprint_h
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+*	Fingerprint is a fast 64 bit content hash (the XXH64 algorithm.)  It's
+*	used to determine whether content has changed, it's not a cryptographic
+*	hash.  Content hashed in parts is fingerprinted by passing the hash of
+*	the previous part as the seed of the next.
+*/
+class Fingerprint
+{
+public:
+	static uint64_t			Hash(
+								const void*				inData,
+								size_t					inLength,
+								uint64_t				inSeed = 0);
+	static uint64_t			Hash(
+								const std::string&		inString,
+								uint64_t				inSeed = 0)
+								{return(Hash(inString.data(), inString.size(), inSeed));}
+	/*
+	*	Sets outString to the 16 hex digits of inFingerprint.
+	*/
+	static const std::string& ToString(
+								uint64_t				inFingerprint,
+								std::string&			outString);
+};
+
+#endif /* Fingerprint_h */
@@ -0,0 +1,282 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  FlashImage.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+#include "FlashImage.h"
+#include <string.h>
+
+/********************************* FlashImage *********************************/
+FlashImage::FlashImage(
+	uint32_t	inPageSize)
+	: mPageSize(0), mPageShift(0)
+{
+	SetPageSize(inPageSize);
+}
+
+/********************************* PageShift **********************************/
+uint32_t FlashImage::PageShift(
+	uint32_t	inPageSize)
+{
+	uint32_t	pageShift = 0;
+	while (pageShift < 31 &&
+		(1U << pageShift) < inPageSize)
+	{
+		pageShift++;
+	}
+	return(pageShift);
+}
+
+/*********************************** Clear ************************************/
+void FlashImage::Clear(void)
+{
+	mPages.clear();
+	mOccupied.Clear();
+}
+
+/******************************** SetPageSize *********************************/
+void FlashImage::SetPageSize(
+	uint32_t	inPageSize)
+{
+	uint32_t	pageShift = PageShift(inPageSize);
+	if (pageShift != mPageShift ||
+		mPageSize == 0)
+	{
+		FlashPages	oldPages;
+		oldPages.swap(mPages);
+		IndexVec	oldOccupied(mOccupied);
+		uint32_t	oldPageShift = mPageShift;
+		mPageShift = pageShift;
+		mPageSize = 1U << pageShift;
+		mOccupied.Clear();
+		/*
+		*	Rewrite the occupied content using the new page size.
+		*/
+		const Runs&	runs = oldOccupied.GetRuns();
+		size_t	runIndex = oldOccupied.GetFirstRunValue() ? 0 : 1;
+		for (; (runIndex + 1) < runs.size(); runIndex += 2)
+		{
+			for (uint32_t address = runs[runIndex]; address < runs[runIndex+1];)
+			{
+				uint32_t	pageOffset = address & ((1U << oldPageShift) - 1);
+				uint32_t	length = (1U << oldPageShift) - pageOffset;
+				if (length > (runs[runIndex+1] - address))
+				{
+					length = runs[runIndex+1] - address;
+				}
+				Write(address, &oldPages[address >> oldPageShift][pageOffset], length);
+				address += length;
+			}
+		}
+	}
+}
+
+/*********************************** Write ************************************/
+/*
+*	The occupied runs end at inAddress + inLength, so the range must end at
+*	or before 0xFFFFFFFF.
+*/
+bool FlashImage::Write(
+	uint32_t		inAddress,
+	const uint8_t*	inData,
+	uint32_t		inLength)
+{
+	bool	success = inLength <= (0xFFFFFFFF - inAddress);
+	if (success &&
+		inLength)
+	{
+		mOccupied.SetRun(inAddress, inAddress + inLength, 1);
+		uint32_t	pageMask = mPageSize - 1;
+		while (inLength)
+		{
+			std::vector<uint8_t>&	page = mPages[inAddress >> mPageShift];
+			if (page.empty())
+			{
+				page.assign(mPageSize, 0xFF);
+			}
+			uint32_t	pageOffset = inAddress & pageMask;
+			uint32_t	length = mPageSize - pageOffset;
+			if (length > inLength)
+			{
+				length = inLength;
+			}
+			memcpy(&page[pageOffset], inData, length);
+			inData += length;
+			inAddress += length;
+			inLength -= length;
+		}
+	}
+	return(success);
+}
+
+/************************************ Read ************************************/
+bool FlashImage::Read(
+	uint32_t	inAddress,
+	uint8_t*	outData,
+	uint32_t	inLength) const
+{
+	bool	allOccupied = true;
+	/*
+	*	The range is fully occupied if it's within a single positive run.
+	*	A range past 0xFFFFFFFF is truncated.
+	*/
+	if (inLength > (0xFFFFFFFF - inAddress))
+	{
+		memset(&outData[0xFFFFFFFF - inAddress], 0xFF, inLength - (0xFFFFFFFF - inAddress));
+		inLength = 0xFFFFFFFF - inAddress;
+		allOccupied = false;
+	}
+	size_t	runIndex = mOccupied.GetRunIndex(inAddress, 0);
+	const Runs&	runs = mOccupied.GetRuns();
+	allOccupied = allOccupied &&
+					mOccupied.GetRunValue(runIndex) &&
+					(runIndex + 1) < runs.size() &&
+					runs[runIndex+1] >= (inAddress + inLength);
+	uint32_t	pageMask = mPageSize - 1;
+	while (inLength)
+	{
+		uint32_t	pageOffset = inAddress & pageMask;
+		uint32_t	length = mPageSize - pageOffset;
+		if (length > inLength)
+		{
+			length = inLength;
+		}
+		FlashPages::const_iterator	itr = mPages.find(inAddress >> mPageShift);
+		if (itr != mPages.end())
+		{
+			memcpy(outData, &itr->second[pageOffset], length);
+		} else
+		{
+			memset(outData, 0xFF, length);
+		}
+		outData += length;
+		inAddress += length;
+		inLength -= length;
+	}
+	return(allOccupied);
+}
+
+/********************************** GetPage ***********************************/
+const uint8_t* FlashImage::GetPage(
+	uint32_t	inPageIndex) const
+{
+	FlashPages::const_iterator	itr = mPages.find(inPageIndex);
+	return(itr != mPages.end() ? itr->second.data() : NULL);
+}
+
+/******************************** AddPageRuns *********************************/
+/*
+*	Adds the indexes of the pages overlapping the occupied runs to ioPages.
+*/
+void FlashImage::AddPageRuns(
+	const IndexVec&	inOccupied,
+	uint32_t		inPageShift,
+	IndexVec&		ioPages)
+{
+	const Runs&	runs = inOccupied.GetRuns();
+	size_t	runIndex = inOccupied.GetFirstRunValue() ? 0 : 1;
+	for (; (runIndex + 1) < runs.size(); runIndex += 2)
+	{
+		ioPages.SetRun(runs[runIndex] >> inPageShift, ((runs[runIndex+1] - 1) >> inPageShift) + 1, 1);
+	}
+}
+
+/******************************* GetDirtyPages ********************************/
+void FlashImage::GetDirtyPages(
+	const FlashImage&	inPrevious,
+	uint32_t			inPageSize,
+	IndexVec&			outDirtyPages) const
+{
+	uint32_t	pageShift = PageShift(inPageSize);
+	uint32_t	pageSize = 1U << pageShift;
+	outDirtyPages.Clear();
+	/*
+	*	Only the pages overlapping the occupied bytes of either image
+	*	need to be compared.
+	*/
+	IndexVec	pages;
+	AddPageRuns(mOccupied, pageShift, pages);
+	AddPageRuns(inPrevious.mOccupied, pageShift, pages);
+	/*
+	*	When an image's page size matches inPageSize its pages are compared
+	*	in place, otherwise the page is read into a buffer.
+	*/
+	std::vector<uint8_t>	erasedPage(pageSize, 0xFF);
+	std::vector<uint8_t>	pageBuffer;
+	std::vector<uint8_t>	previousPageBuffer;
+	const Runs&	runs = pages.GetRuns();
+	size_t	runIndex = pages.GetFirstRunValue() ? 0 : 1;
+	for (; (runIndex + 1) < runs.size(); runIndex += 2)
+	{
+		for (uint32_t pageIndex = runs[runIndex]; pageIndex < runs[runIndex+1]; pageIndex++)
+		{
+			const uint8_t*	page;
+			if (pageShift == mPageShift)
+			{
+				page = GetPage(pageIndex);
+			} else
+			{
+				pageBuffer.resize(pageSize);
+				Read(pageIndex << pageShift, pageBuffer.data(), pageSize);
+				page = pageBuffer.data();
+			}
+			const uint8_t*	previousPage;
+			if (pageShift == inPrevious.mPageShift)
+			{
+				previousPage = inPrevious.GetPage(pageIndex);
+			} else
+			{
+				previousPageBuffer.resize(pageSize);
+				inPrevious.Read(pageIndex << pageShift, previousPageBuffer.data(), pageSize);
+				previousPage = previousPageBuffer.data();
+			}
+			if (memcmp(page ? page : erasedPage.data(),
+					previousPage ? previousPage : erasedPage.data(), pageSize) != 0)
+			{
+				outDirtyPages.SetRun(pageIndex, pageIndex + 1, 1);
+			}
+		}
+	}
+}
+
+/********************************* CopyPages **********************************/
+void FlashImage::CopyPages(
+	const IndexVec&	inPages,
+	uint32_t		inPageSize,
+	FlashImage&		outImage) const
+{
+	uint32_t	pageShift = PageShift(inPageSize);
+	uint32_t	pageSize = 1U << pageShift;
+	std::vector<uint8_t>	pageBuffer(pageSize);
+	const Runs&	runs = inPages.GetRuns();
+	size_t	runIndex = inPages.GetFirstRunValue() ? 0 : 1;
+	for (; (runIndex + 1) < runs.size(); runIndex += 2)
+	{
+		for (uint32_t pageIndex = runs[runIndex]; pageIndex < runs[runIndex+1]; pageIndex++)
+		{
+			Read(pageIndex << pageShift, pageBuffer.data(), pageSize);
+			outImage.Write(pageIndex << pageShift, pageBuffer.data(), pageSize);
+		}
+	}
+}
@@ -0,0 +1,119 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  FlashImage.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+/*
+*	A sparse memory image stored as fixed size pages.  Pages are only
+*	allocated when written to and are initially filled with 0xFF (the erased
+*	flash value.)  The set of byte addresses actually written is recorded in
+*	an IndexVec, so the occupied address ranges are available as runs.
+*/
+#ifndef FlashImage_h
+#define FlashImage_h
+
+#include <map>
+#include <vector>
+#include "IndexVec.h"
+
+typedef std::map<uint32_t, std::vector<uint8_t> > FlashPages;	// Key is the page index (address/page size)
+
+class FlashImage
+{
+public:
+							FlashImage(
+								uint32_t				inPageSize = 256);
+							~FlashImage(void){}
+	void					Clear(void);
+	/*
+	*	Changing the page size repartitions the existing content.
+	*	inPageSize must be a power of 2.
+	*/
+	void					SetPageSize(
+								uint32_t				inPageSize);
+	uint32_t				GetPageSize(void) const
+								{return(mPageSize);}
+	/*
+	*	Returns false, writing nothing, if the range extends past 0xFFFFFFFF.
+	*/
+	bool					Write(
+								uint32_t				inAddress,
+								const uint8_t*			inData,
+								uint32_t				inLength);
+	/*
+	*	Unoccupied bytes, and any past 0xFFFFFFFF, are returned as 0xFF.
+	*	Returns false if any of the bytes read are unoccupied.
+	*/
+	bool					Read(
+								uint32_t				inAddress,
+								uint8_t*				outData,
+								uint32_t				inLength) const;
+	/*
+	*	Returns NULL if no part of the page is occupied.
+	*/
+	const uint8_t*			GetPage(
+								uint32_t				inPageIndex) const;
+	const FlashPages&		GetPages(void) const
+								{return(mPages);}
+	const IndexVec&			GetOccupied(void) const
+								{return(mOccupied);}
+	/*
+	*	Returns the number of occupied bytes.
+	*/
+	size_t					GetSize(void) const
+								{return(mOccupied.GetCount());}
+	bool					Empty(void) const
+								{return(mPages.empty());}
+	/*
+	*	Sets outDirtyPages to the indexes of the inPageSize pages whose content
+	*	differs from inPrevious.  Unoccupied bytes compare as 0xFF, so a page
+	*	that is no longer used is dirty only if it needs to be erased.
+	*	inPageSize must be a power of 2.
+	*/
+	void					GetDirtyPages(
+								const FlashImage&		inPrevious,
+								uint32_t				inPageSize,
+								IndexVec&				outDirtyPages) const;
+	/*
+	*	Writes the complete inPageSize pages in inPages to outImage.
+	*/
+	void					CopyPages(
+								const IndexVec&			inPages,
+								uint32_t				inPageSize,
+								FlashImage&				outImage) const;
+protected:
+	uint32_t	mPageSize;
+	uint32_t	mPageShift;
+	FlashPages	mPages;
+	IndexVec	mOccupied;
+
+	static uint32_t			PageShift(
+								uint32_t				inPageSize);
+	static void				AddPageRuns(
+								const IndexVec&			inOccupied,
+								uint32_t				inPageShift,
+								IndexVec&				ioPages);
+};
+
+#endif /* FlashImage_h */
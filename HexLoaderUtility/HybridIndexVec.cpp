@@ -0,0 +1,1285 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  HybridIndexVec.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#include "HybridIndexVec.h"
+#include <algorithm>
+#include <string.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static const uint32_t	kChunkSize = 0x10000;
+static const uint32_t	kBitmapWords = kChunkSize/64;
+static const uint32_t	kBitmapBytes = kBitmapWords * 8;
+static const uint32_t	kArrayChunkMax = kBitmapBytes/2;	// The most indexes an array is smaller for
+static const int32_t	kNoValue = -1;
+
+enum EHybridMergeOp
+{
+	eHybridDiff,	// a & !b
+	eHybridSect,	// a & b
+	eHybridUnion	// a | b
+};
+
+/********************************** PopCount **********************************/
+static inline uint32_t PopCount(
+	uint64_t	inWord)
+{
+	return((uint32_t)__builtin_popcountll(inWord));
+}
+
+/******************************* SetBitmapRange *******************************/
+/*
+*	Sets or clears the bits inFirst to inLast inclusive.
+*/
+static void SetBitmapRange(
+	uint64_t*	ioBitmap,
+	uint32_t	inFirst,
+	uint32_t	inLast,
+	uint8_t		inValue)
+{
+	uint32_t	firstWord = inFirst/64;
+	uint32_t	lastWord = inLast/64;
+	uint64_t	firstMask = ~0ULL << (inFirst & 63);
+	uint64_t	lastMask = ~0ULL >> (63 - (inLast & 63));
+	for (uint32_t i = firstWord; i <= lastWord; i++)
+	{
+		uint64_t	mask = (i == firstWord ? firstMask : ~0ULL) & (i == lastWord ? lastMask : ~0ULL);
+		ioBitmap[i] = inValue ? (ioBitmap[i] | mask) : (ioBitmap[i] & ~mask);
+	}
+}
+
+/********************************** NextBit ***********************************/
+/*
+*	Returns the first bit >= inFrom that's set (inValue 1) or clear (inValue
+*	0), or kChunkSize if there isn't one.
+*/
+static uint32_t NextBit(
+	const uint64_t*	inBitmap,
+	uint32_t		inFrom,
+	uint8_t			inValue)
+{
+	uint32_t	nextBit = kChunkSize;
+	if (inFrom < kChunkSize)
+	{
+		uint64_t	flip = inValue ? 0 : ~0ULL;
+		uint32_t	wordIndex = inFrom/64;
+		uint64_t	word = (inBitmap[wordIndex] ^ flip) & (~0ULL << (inFrom & 63));
+		while (word == 0 &&
+			++wordIndex < kBitmapWords)
+		{
+			word = inBitmap[wordIndex] ^ flip;
+		}
+		if (word)
+		{
+			nextBit = (wordIndex * 64) + __builtin_ctzll(word);
+		}
+	}
+	return(nextBit);
+}
+
+/******************************* PreviousSetBit *******************************/
+/*
+*	Returns the last set bit <= inFrom or kNoValue if there isn't one.
+*/
+static int32_t PreviousSetBit(
+	const uint64_t*	inBitmap,
+	uint32_t		inFrom)
+{
+	uint32_t	wordIndex = inFrom/64;
+	uint64_t	word = inBitmap[wordIndex] & (~0ULL >> (63 - (inFrom & 63)));
+	while (word == 0 &&
+		wordIndex > 0)
+	{
+		word = inBitmap[--wordIndex];
+	}
+	return(word ? (int32_t)((wordIndex * 64) + 63 - __builtin_clzll(word)) : kNoValue);
+}
+
+/****************************** CountBitmapRuns *******************************/
+/*
+*	A run starts at each set bit whose preceding bit is clear.
+*/
+static uint32_t CountBitmapRuns(
+	const uint64_t*	inBitmap)
+{
+	uint32_t	numRuns = 0;
+	uint64_t	carry = 0;
+	for (uint32_t i = 0; i < kBitmapWords; i++)
+	{
+		uint64_t	word = inBitmap[i];
+		numRuns += PopCount(word & ~((word << 1) | carry));
+		carry = word >> 63;
+	}
+	return(numRuns);
+}
+
+/********************************** BitmapOp **********************************/
+/*
+*	Combines inA and inB into outBitmap, returning the number of bits set.
+*	Blocks of 128 bits are combined with a vector AND, OR or ANDNOT and
+*	counted by a nibble lookup (SSSE3 pshufb) or NEON cnt in the same pass.
+*/
+static uint32_t BitmapOp(
+	const uint64_t*	inA,
+	const uint64_t*	inB,
+	uint64_t*		outBitmap,
+	uint32_t		inOp)
+{
+	uint32_t	count = 0;
+	uint32_t	i = 0;
+#if defined(__SSSE3__)
+	const __m128i	kNibbleCounts = _mm_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+	const __m128i	kNibbleMask = _mm_set1_epi8(0x0F);
+	__m128i	countVec = _mm_setzero_si128();
+	for (; i < kBitmapWords; i += 2)
+	{
+		__m128i	a = _mm_loadu_si128((const __m128i*)&inA[i]);
+		__m128i	b = _mm_loadu_si128((const __m128i*)&inB[i]);
+		__m128i	bits = inOp == eHybridSect ? _mm_and_si128(a, b) :
+							(inOp == eHybridUnion ? _mm_or_si128(a, b) : _mm_andnot_si128(b, a));
+		_mm_storeu_si128((__m128i*)&outBitmap[i], bits);
+		__m128i	bitCounts = _mm_add_epi8(_mm_shuffle_epi8(kNibbleCounts, _mm_and_si128(bits, kNibbleMask)),
+								_mm_shuffle_epi8(kNibbleCounts, _mm_and_si128(_mm_srli_epi16(bits, 4), kNibbleMask)));
+		countVec = _mm_add_epi64(countVec, _mm_sad_epu8(bitCounts, _mm_setzero_si128()));
+	}
+	count = (uint32_t)(_mm_cvtsi128_si32(countVec) + _mm_cvtsi128_si32(_mm_srli_si128(countVec, 8)));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	for (; i < kBitmapWords; i += 2)
+	{
+		uint64x2_t	a = vld1q_u64(&inA[i]);
+		uint64x2_t	b = vld1q_u64(&inB[i]);
+		uint64x2_t	bits = inOp == eHybridSect ? vandq_u64(a, b) :
+							(inOp == eHybridUnion ? vorrq_u64(a, b) : vbicq_u64(a, b));
+		vst1q_u64(&outBitmap[i], bits);
+		count += vaddlvq_u8(vcntq_u8(vreinterpretq_u8_u64(bits)));
+	}
+#endif
+	for (; i < kBitmapWords; i++)
+	{
+		uint64_t	bits = inOp == eHybridSect ? (inA[i] & inB[i]) :
+							(inOp == eHybridUnion ? (inA[i] | inB[i]) : (inA[i] & ~inB[i]));
+		outBitmap[i] = bits;
+		count += PopCount(bits);
+	}
+	return(count);
+}
+
+/********************************** FindRun ***********************************/
+/*
+*	Returns the index of the first run of inRuns (first, last pairs) whose
+*	last is >= inValue, or the number of runs if there isn't one.
+*/
+static size_t FindRun(
+	const std::vector<uint16_t>&	inRuns,
+	uint32_t						inValue)
+{
+	size_t	low = 0;
+	size_t	high = inRuns.size()/2;
+	while (low < high)
+	{
+		size_t	mid = (low + high)/2;
+		if (inRuns[(mid*2)+1] < inValue)
+		{
+			low = mid + 1;
+		} else
+		{
+			high = mid;
+		}
+	}
+	return(low);
+}
+
+/******************************* ChunkToBitmap ********************************/
+static void ChunkToBitmap(
+	const SHybridChunk&	inChunk,
+	uint64_t*			outBitmap)
+{
+	if (inChunk.type == eBitmapChunk)
+	{
+		memcpy(outBitmap, inChunk.bitmap.data(), kBitmapBytes);
+	} else
+	{
+		memset(outBitmap, 0, kBitmapBytes);
+		const std::vector<uint16_t>&	values = inChunk.values;
+		if (inChunk.type == eArrayChunk)
+		{
+			for (size_t i = 0; i < values.size(); i++)
+			{
+				outBitmap[values[i]/64] |= 1ULL << (values[i] & 63);
+			}
+		} else
+		{
+			for (size_t i = 0; i < values.size(); i += 2)
+			{
+				SetBitmapRange(outBitmap, values[i], values[i+1], 1);
+			}
+		}
+	}
+}
+
+/******************************* BestChunkType ********************************/
+/*
+*	Arrays are preferred to bitmaps of the same size.
+*/
+static uint8_t BestChunkType(
+	uint32_t	inCount,
+	uint32_t	inNumRuns)
+{
+	uint32_t	runBytes = inNumRuns * 4;
+	uint32_t	arrayBytes = inCount * 2;
+	return(runBytes < arrayBytes && runBytes < kBitmapBytes ? eRunChunk :
+			(inCount <= kArrayChunkMax ? eArrayChunk : eBitmapChunk));
+}
+
+/***************************** SetChunkFromBitmap *****************************/
+/*
+*	Replaces the content of ioChunk with the inCount bits of inBitmap in the
+*	best chunk type.  inBitmap may be ioChunk's bitmap.
+*/
+static void SetChunkFromBitmap(
+	SHybridChunk&	ioChunk,
+	const uint64_t*	inBitmap,
+	uint32_t		inCount)
+{
+	std::vector<uint16_t>	values;
+	std::vector<uint64_t>	bitmap;
+	uint8_t	type = BestChunkType(inCount, CountBitmapRuns(inBitmap));
+	if (type == eRunChunk)
+	{
+		for (uint32_t bit = NextBit(inBitmap, 0, 1); bit < kChunkSize;)
+		{
+			uint32_t	runEnd = NextBit(inBitmap, bit, 0);
+			values.push_back((uint16_t)bit);
+			values.push_back((uint16_t)(runEnd - 1));
+			bit = NextBit(inBitmap, runEnd, 1);
+		}
+	} else if (type == eArrayChunk)
+	{
+		values.reserve(inCount);
+		for (uint32_t i = 0; i < kBitmapWords; i++)
+		{
+			for (uint64_t word = inBitmap[i]; word; word &= word - 1)
+			{
+				values.push_back((uint16_t)((i * 64) + __builtin_ctzll(word)));
+			}
+		}
+	} else if (inBitmap == ioChunk.bitmap.data())
+	{
+		bitmap.swap(ioChunk.bitmap);
+	} else
+	{
+		bitmap.assign(inBitmap, inBitmap + kBitmapWords);
+	}
+	ioChunk.type = type;
+	ioChunk.count = inCount;
+	ioChunk.values.swap(values);
+	ioChunk.bitmap.swap(bitmap);
+}
+
+/******************************* OptimizeChunk ********************************/
+/*
+*	Converts the chunk to the best type for its content if it isn't already.
+*/
+static void OptimizeChunk(
+	SHybridChunk&	ioChunk)
+{
+	uint32_t	numRuns = 0;
+	if (ioChunk.type == eRunChunk)
+	{
+		numRuns = (uint32_t)(ioChunk.values.size()/2);
+	} else if (ioChunk.type == eArrayChunk)
+	{
+		const std::vector<uint16_t>&	values = ioChunk.values;
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			numRuns += (i == 0 || values[i] != values[i-1] + 1);
+		}
+	} else
+	{
+		numRuns = CountBitmapRuns(ioChunk.bitmap.data());
+	}
+	if (BestChunkType(ioChunk.count, numRuns) != ioChunk.type)
+	{
+		uint64_t	bitmap[kBitmapWords];
+		ChunkToBitmap(ioChunk, bitmap);
+		SetChunkFromBitmap(ioChunk, bitmap, ioChunk.count);
+	}
+}
+
+/******************************* ChunkContains ********************************/
+static bool ChunkContains(
+	const SHybridChunk&	inChunk,
+	uint32_t			inValue)
+{
+	const std::vector<uint16_t>&	values = inChunk.values;
+	if (inChunk.type == eArrayChunk)
+	{
+		return(std::binary_search(values.begin(), values.end(), (uint16_t)inValue));
+	} else if (inChunk.type == eRunChunk)
+	{
+		size_t	runIndex = FindRun(values, inValue);
+		return(runIndex < values.size()/2 && values[runIndex*2] <= inValue);
+	}
+	return(((inChunk.bitmap[inValue/64] >> (inValue & 63)) & 1) != 0);
+}
+
+/********************************* ChunkNext **********************************/
+/*
+*	Returns the first index >= inValue in the chunk or kNoValue.  inValue
+*	may be kChunkSize.
+*/
+static int32_t ChunkNext(
+	const SHybridChunk&	inChunk,
+	uint32_t			inValue)
+{
+	int32_t	next = kNoValue;
+	const std::vector<uint16_t>&	values = inChunk.values;
+	if (inValue < kChunkSize)
+	{
+		if (inChunk.type == eArrayChunk)
+		{
+			std::vector<uint16_t>::const_iterator	itr = std::lower_bound(values.begin(), values.end(), (uint16_t)inValue);
+			if (itr != values.end())
+			{
+				next = *itr;
+			}
+		} else if (inChunk.type == eRunChunk)
+		{
+			size_t	runIndex = FindRun(values, inValue);
+			if (runIndex < values.size()/2)
+			{
+				next = std::max((uint32_t)values[runIndex*2], inValue);
+			}
+		} else
+		{
+			uint32_t	bit = NextBit(inChunk.bitmap.data(), inValue, 1);
+			if (bit < kChunkSize)
+			{
+				next = bit;
+			}
+		}
+	}
+	return(next);
+}
+
+/******************************* ChunkPrevious ********************************/
+/*
+*	Returns the last index <= inValue in the chunk or kNoValue.
+*/
+static int32_t ChunkPrevious(
+	const SHybridChunk&	inChunk,
+	uint32_t			inValue)
+{
+	int32_t	previous = kNoValue;
+	const std::vector<uint16_t>&	values = inChunk.values;
+	if (inChunk.type == eArrayChunk)
+	{
+		std::vector<uint16_t>::const_iterator	itr = std::upper_bound(values.begin(), values.end(), (uint16_t)inValue);
+		if (itr != values.begin())
+		{
+			previous = *(itr - 1);
+		}
+	} else if (inChunk.type == eRunChunk)
+	{
+		size_t	runIndex = FindRun(values, inValue);
+		if (runIndex < values.size()/2 &&
+			values[runIndex*2] <= inValue)
+		{
+			previous = inValue;
+		} else if (runIndex > 0)
+		{
+			previous = values[(runIndex*2)-1];
+		}
+	} else
+	{
+		previous = PreviousSetBit(inChunk.bitmap.data(), inValue);
+	}
+	return(previous);
+}
+
+/********************************* ChunkRank **********************************/
+/*
+*	Returns the number of indexes < inValue in the chunk.
+*/
+static uint32_t ChunkRank(
+	const SHybridChunk&	inChunk,
+	uint32_t			inValue)
+{
+	uint32_t	rank = 0;
+	const std::vector<uint16_t>&	values = inChunk.values;
+	if (inChunk.type == eArrayChunk)
+	{
+		rank = (uint32_t)(std::lower_bound(values.begin(), values.end(), (uint16_t)inValue) - values.begin());
+	} else if (inChunk.type == eRunChunk)
+	{
+		for (size_t i = 0; i < values.size() && values[i] < inValue; i += 2)
+		{
+			rank += std::min((uint32_t)values[i+1] + 1, inValue) - values[i];
+		}
+	} else
+	{
+		const uint64_t*	bitmap = inChunk.bitmap.data();
+		uint32_t	wordIndex = inValue/64;
+		for (uint32_t i = 0; i < wordIndex; i++)
+		{
+			rank += PopCount(bitmap[i]);
+		}
+		if (inValue & 63)
+		{
+			rank += PopCount(bitmap[wordIndex] & (~0ULL >> (64 - (inValue & 63))));
+		}
+	}
+	return(rank);
+}
+
+/******************************** ChunkSelect *********************************/
+/*
+*	Returns the inIndexNumber'th index of the chunk, inIndexNumber must be
+*	less than the chunk's count.
+*/
+static uint32_t ChunkSelect(
+	const SHybridChunk&	inChunk,
+	uint32_t			inIndexNumber)
+{
+	const std::vector<uint16_t>&	values = inChunk.values;
+	if (inChunk.type == eArrayChunk)
+	{
+		return(values[inIndexNumber]);
+	} else if (inChunk.type == eRunChunk)
+	{
+		size_t	i = 0;
+		for (; inIndexNumber > (uint32_t)(values[i+1] - values[i]); i += 2)
+		{
+			inIndexNumber -= values[i+1] - values[i] + 1;
+		}
+		return(values[i] + inIndexNumber);
+	}
+	const uint64_t*	bitmap = inChunk.bitmap.data();
+	uint32_t	wordIndex = 0;
+	for (; inIndexNumber >= PopCount(bitmap[wordIndex]); wordIndex++)
+	{
+		inIndexNumber -= PopCount(bitmap[wordIndex]);
+	}
+	uint64_t	word = bitmap[wordIndex];
+	for (; inIndexNumber; inIndexNumber--)
+	{
+		word &= word - 1;
+	}
+	return((wordIndex * 64) + __builtin_ctzll(word));
+}
+
+/******************************** MergeChunks *********************************/
+/*
+*	Sets outChunk to inA combined with inB (of the same key.)  Arrays are
+*	intersected, differenced and (while small) merged as arrays, everything
+*	else is combined as bitmaps.  Returns false if outChunk is empty.
+*/
+static bool MergeChunks(
+	const SHybridChunk&	inA,
+	const SHybridChunk&	inB,
+	uint32_t			inOp,
+	SHybridChunk&		outChunk)
+{
+	outChunk.key = inA.key;
+	bool	aIsArray = inA.type == eArrayChunk;
+	bool	bIsArray = inB.type == eArrayChunk;
+	std::vector<uint16_t>&	values = outChunk.values;
+	if (aIsArray && bIsArray &&
+		(inOp != eHybridUnion || (inA.count + inB.count) <= kArrayChunkMax))
+	{
+		values.resize(inOp == eHybridUnion ? inA.count + inB.count : inA.count);
+		std::vector<uint16_t>::iterator	valuesEnd =
+			inOp == eHybridSect ? std::set_intersection(inA.values.begin(), inA.values.end(),
+								inB.values.begin(), inB.values.end(), values.begin()) :
+			(inOp == eHybridUnion ? std::set_union(inA.values.begin(), inA.values.end(),
+								inB.values.begin(), inB.values.end(), values.begin()) :
+							std::set_difference(inA.values.begin(), inA.values.end(),
+								inB.values.begin(), inB.values.end(), values.begin()));
+		values.resize(valuesEnd - values.begin());
+	} else if (inOp != eHybridUnion &&
+		(aIsArray || (bIsArray && inOp == eHybridSect)))
+	{
+		/*
+		*	Filter the array by the other chunk.
+		*/
+		const SHybridChunk&	arrayChunk = aIsArray ? inA : inB;
+		const SHybridChunk&	otherChunk = aIsArray ? inB : inA;
+		bool	keepContained = inOp == eHybridSect;
+		values.reserve(arrayChunk.count);
+		for (size_t i = 0; i < arrayChunk.values.size(); i++)
+		{
+			if (ChunkContains(otherChunk, arrayChunk.values[i]) == keepContained)
+			{
+				values.push_back(arrayChunk.values[i]);
+			}
+		}
+	} else
+	{
+		uint64_t	aBitmap[kBitmapWords];
+		uint64_t	bBitmap[kBitmapWords];
+		const uint64_t*	aBits = inA.bitmap.data();
+		const uint64_t*	bBits = inB.bitmap.data();
+		if (inA.type != eBitmapChunk)
+		{
+			ChunkToBitmap(inA, aBitmap);
+			aBits = aBitmap;
+		}
+		if (inB.type != eBitmapChunk)
+		{
+			ChunkToBitmap(inB, bBitmap);
+			bBits = bBitmap;
+		}
+		outChunk.bitmap.resize(kBitmapWords);
+		uint32_t	count = BitmapOp(aBits, bBits, outChunk.bitmap.data(), inOp);
+		if (count)
+		{
+			SetChunkFromBitmap(outChunk, outChunk.bitmap.data(), count);
+		}
+		return(count != 0);
+	}
+	outChunk.type = eArrayChunk;
+	outChunk.count = (uint32_t)values.size();
+	if (outChunk.count)
+	{
+		OptimizeChunk(outChunk);
+	}
+	return(outChunk.count != 0);
+}
+
+/******************************* HybridIndexVec *******************************/
+HybridIndexVec::HybridIndexVec(void)
+	: mRankCountsValid(false)
+{
+}
+
+/******************************* HybridIndexVec *******************************/
+HybridIndexVec::HybridIndexVec(
+	const HybridIndexVec&	inIndexVec)
+	: mChunks(inIndexVec.mChunks), mRankCountsValid(false)
+{
+}
+
+/******************************* HybridIndexVec *******************************/
+HybridIndexVec::HybridIndexVec(
+	const IndexVec&	inIndexVec)
+	: mRankCountsValid(false)
+{
+	Copy(inIndexVec);
+}
+
+/********************************* FindChunk **********************************/
+size_t HybridIndexVec::FindChunk(
+	uint32_t	inKey) const
+{
+	size_t	low = 0;
+	size_t	high = mChunks.size();
+	while (low < high)
+	{
+		size_t	mid = (low + high)/2;
+		if (mChunks[mid].key < inKey)
+		{
+			low = mid + 1;
+		} else
+		{
+			high = mid;
+		}
+	}
+	return(low);
+}
+
+/*********************************** SetRun ***********************************/
+/*
+*	Each chunk of the range is updated separately.  Arrays that stay small
+*	are updated in place, everything else is updated as a bitmap.
+*/
+void HybridIndexVec::SetRun(
+	uint32_t	inStart,
+	uint32_t	inEnd,
+	uint8_t		inValue)
+{
+	if (inStart < inEnd)
+	{
+		InvalidateRankCounts();
+		uint32_t	lastKey = (inEnd - 1) >> 16;
+		size_t	chunkIndex = FindChunk(inStart >> 16);
+		for (uint32_t key = inStart >> 16; key <= lastKey; key++)
+		{
+			uint32_t	first = key == (inStart >> 16) ? (inStart & 0xFFFF) : 0;
+			uint32_t	last = key == lastKey ? ((inEnd - 1) & 0xFFFF) : 0xFFFF;
+			uint32_t	rangeCount = last - first + 1;
+			bool	chunkExists = chunkIndex < mChunks.size() &&
+							mChunks[chunkIndex].key == key;
+			if (!chunkExists)
+			{
+				if (inValue)
+				{
+					SHybridChunk	chunk;
+					chunk.key = (uint16_t)key;
+					chunk.type = eRunChunk;
+					chunk.count = rangeCount;
+					chunk.values.push_back((uint16_t)first);
+					chunk.values.push_back((uint16_t)last);
+					OptimizeChunk(chunk);
+					mChunks.insert(mChunks.begin() + chunkIndex, chunk);
+					chunkIndex++;
+				}
+				continue;
+			}
+			SHybridChunk&	chunk = mChunks[chunkIndex];
+			std::vector<uint16_t>&	values = chunk.values;
+			std::vector<uint16_t>::iterator	rangeBegin = values.end();
+			std::vector<uint16_t>::iterator	rangeEnd = values.end();
+			if (chunk.type == eArrayChunk)
+			{
+				rangeBegin = std::lower_bound(values.begin(), values.end(), (uint16_t)first);
+				rangeEnd = std::upper_bound(rangeBegin, values.end(), (uint16_t)last);
+			}
+			if (chunk.type == eArrayChunk &&
+				(!inValue ||
+					(values.size() - (rangeEnd - rangeBegin) + rangeCount) <= kArrayChunkMax))
+			{
+				size_t	insertAt = rangeBegin - values.begin();
+				values.erase(rangeBegin, rangeEnd);
+				if (inValue)
+				{
+					values.insert(values.begin() + insertAt, rangeCount, 0);
+					for (uint32_t i = 0; i < rangeCount; i++)
+					{
+						values[insertAt + i] = (uint16_t)(first + i);
+					}
+				}
+				chunk.count = (uint32_t)values.size();
+				if (chunk.count)
+				{
+					OptimizeChunk(chunk);
+				}
+			} else
+			{
+				uint64_t	bitmap[kBitmapWords];
+				uint64_t*	bits = chunk.bitmap.data();
+				if (chunk.type != eBitmapChunk)
+				{
+					ChunkToBitmap(chunk, bitmap);
+					bits = bitmap;
+				}
+				SetBitmapRange(bits, first, last, inValue);
+				chunk.count = 0;
+				for (uint32_t i = 0; i < kBitmapWords; i++)
+				{
+					chunk.count += PopCount(bits[i]);
+				}
+				if (chunk.count)
+				{
+					SetChunkFromBitmap(chunk, bits, chunk.count);
+				}
+			}
+			if (chunk.count)
+			{
+				chunkIndex++;
+			} else
+			{
+				mChunks.erase(mChunks.begin() + chunkIndex);
+			}
+		}
+	}
+}
+
+/********************************** Contains **********************************/
+bool HybridIndexVec::Contains(
+	uint32_t	inPosition) const
+{
+	size_t	chunkIndex = FindChunk(inPosition >> 16);
+	return(chunkIndex < mChunks.size() &&
+			mChunks[chunkIndex].key == (inPosition >> 16) &&
+			ChunkContains(mChunks[chunkIndex], inPosition & 0xFFFF));
+}
+
+/****************************** BuildRankCounts *******************************/
+/*
+*	See IndexVec::BuildRankCounts
+*/
+void HybridIndexVec::BuildRankCounts(void) const
+{
+	std::lock_guard<std::mutex>	lock(mRankCountsMutex);
+	if (mRankCountsValid.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	mRankCounts.resize(mChunks.size() + 1);
+	size_t	count = 0;
+	for (size_t i = 0; i < mChunks.size(); i++)
+	{
+		mRankCounts[i] = count;
+		count += mChunks[i].count;
+	}
+	mRankCounts.back() = count;
+	mRankCountsValid.store(true, std::memory_order_release);
+}
+
+/******************************* GetIndexNumber *******************************/
+size_t HybridIndexVec::GetIndexNumber(
+	size_t	inIndex) const
+{
+	if (inIndex <= 0xFFFFFFFF &&
+		Contains((uint32_t)inIndex))
+	{
+		PrepareRankCounts();
+		size_t	chunkIndex = FindChunk((uint32_t)(inIndex >> 16));
+		return(mRankCounts[chunkIndex] + ChunkRank(mChunks[chunkIndex], inIndex & 0xFFFF));
+	}
+	return(IndexVecIterator::end);
+}
+
+/******************************** GetNthIndex *********************************/
+/*
+*	Same as IndexVec, returns GetMax() - 1 when inIndexNumber is past the
+*	end.
+*/
+uint32_t HybridIndexVec::GetNthIndex(
+	size_t	inIndexNumber) const
+{
+	if (inIndexNumber < GetCount())
+	{
+		size_t	chunkIndex = (std::upper_bound(mRankCounts.begin(), mRankCounts.end() - 1, inIndexNumber) -
+								mRankCounts.begin()) - 1;
+		const SHybridChunk&	chunk = mChunks[chunkIndex];
+		return(((uint32_t)chunk.key << 16) | ChunkSelect(chunk, (uint32_t)(inIndexNumber - mRankCounts[chunkIndex])));
+	}
+	return(GetMax()-1);
+}
+
+/*********************************** GetMax ***********************************/
+uint32_t HybridIndexVec::GetMax(void) const
+{
+	uint32_t	max = 0;
+	if (!mChunks.empty())
+	{
+		const SHybridChunk&	chunk = mChunks.back();
+		max = (((uint32_t)chunk.key << 16) | ChunkPrevious(chunk, 0xFFFF)) + 1;
+	}
+	return(max);
+}
+
+/*********************************** GetMin ***********************************/
+uint32_t HybridIndexVec::GetMin(void) const
+{
+	uint32_t	min = 0;
+	if (!mChunks.empty())
+	{
+		const SHybridChunk&	chunk = mChunks.front();
+		min = ((uint32_t)chunk.key << 16) | ChunkNext(chunk, 0);
+	}
+	return(min);
+}
+
+/********************************** GetCount **********************************/
+size_t HybridIndexVec::GetCount(void) const
+{
+	PrepareRankCounts();
+	return(mRankCounts.back());
+}
+
+/************************************ Set *************************************/
+void HybridIndexVec::Set(
+	uint32_t	inFrom,
+	uint32_t	inTo)
+{
+	SetRun(inFrom, inTo+1, 1);
+}
+
+/*********************************** Clear ************************************/
+void HybridIndexVec::Clear(
+	uint32_t	inFrom,
+	uint32_t	inTo)
+{
+	SetRun(inFrom, inTo+1, 0);
+}
+
+/*********************************** Clear ************************************/
+void HybridIndexVec::Clear(void)
+{
+	mChunks.clear();
+	InvalidateRankCounts();
+}
+
+/************************************ Copy ************************************/
+void HybridIndexVec::Copy(
+	const HybridIndexVec&	inIndexVec)
+{
+	mChunks = inIndexVec.mChunks;
+	InvalidateRankCounts();
+}
+
+/************************************ Copy ************************************/
+/*
+*	The runs of 1s are appended to each chunk as runs, then the chunk is
+*	converted to the best type once it's complete.
+*/
+void HybridIndexVec::Copy(
+	const IndexVec&	inIndexVec)
+{
+	HybridChunks	chunks;
+	const Runs&		runs = inIndexVec.GetRuns();
+	if (inIndexVec.GetFirstRunValue() != (runs.size() & 1))
+	{
+		for (size_t i = inIndexVec.GetFirstRunValue() ? 0 : 1; (i + 1) < runs.size(); i += 2)
+		{
+			for (uint32_t start = runs[i]; start < runs[i+1];)
+			{
+				uint32_t	key = start >> 16;
+				uint32_t	end = std::min(runs[i+1], (key + 1) << 16);
+				if (end == 0)	// The last chunk, (key + 1) << 16 wrapped to 0
+				{
+					end = runs[i+1];
+				}
+				if (chunks.empty() ||
+					chunks.back().key != key)
+				{
+					if (!chunks.empty())
+					{
+						OptimizeChunk(chunks.back());
+					}
+					chunks.push_back(SHybridChunk());
+					chunks.back().key = (uint16_t)key;
+					chunks.back().type = eRunChunk;
+					chunks.back().count = 0;
+				}
+				SHybridChunk&	chunk = chunks.back();
+				chunk.values.push_back((uint16_t)start);
+				chunk.values.push_back((uint16_t)(end - 1));
+				chunk.count += end - start;
+				start = end;
+			}
+		}
+		if (!chunks.empty())
+		{
+			OptimizeChunk(chunks.back());
+		}
+	}
+	mChunks.swap(chunks);
+	InvalidateRankCounts();
+}
+
+/*********************************** CopyTo ***********************************/
+void HybridIndexVec::CopyTo(
+	IndexVec&	outIndexVec) const
+{
+	IndexVecBuilder	builder;
+	HybridChunks::const_iterator	itr = mChunks.begin();
+	HybridChunks::const_iterator	itrEnd = mChunks.end();
+	for (; itr != itrEnd; ++itr)
+	{
+		uint32_t	base = (uint32_t)itr->key << 16;
+		const std::vector<uint16_t>&	values = itr->values;
+		if (itr->type == eArrayChunk)
+		{
+			for (size_t i = 0; i < values.size(); i++)
+			{
+				builder.Add(base + values[i]);
+			}
+		} else if (itr->type == eRunChunk)
+		{
+			for (size_t i = 0; i < values.size(); i += 2)
+			{
+				builder.Add(base + values[i], base + values[i+1]);
+			}
+		} else
+		{
+			const uint64_t*	bitmap = itr->bitmap.data();
+			for (uint32_t bit = NextBit(bitmap, 0, 1); bit < kChunkSize;)
+			{
+				uint32_t	runEnd = NextBit(bitmap, bit, 0);
+				builder.AddRun(base + bit, base + runEnd);
+				bit = NextBit(bitmap, runEnd, 1);
+			}
+		}
+	}
+	builder.Build(outIndexVec);
+}
+
+/******************************** operator = **********************************/
+HybridIndexVec& HybridIndexVec::operator = (
+	const HybridIndexVec&	inIndexVec)
+{
+	Copy(inIndexVec);
+	return(*this);
+}
+
+/******************************** operator = **********************************/
+HybridIndexVec& HybridIndexVec::operator = (
+	const IndexVec&	inIndexVec)
+{
+	Copy(inIndexVec);
+	return(*this);
+}
+
+/*********************************** Merge ************************************/
+/*
+*	The chunk lists are merged by key.  A chunk in only one vec is copied or
+*	dropped depending on the operation.
+*/
+void HybridIndexVec::Merge(
+	const HybridIndexVec&	inA,
+	const HybridIndexVec&	inB,
+	uint32_t				inOp)
+{
+	HybridChunks	chunks;
+	chunks.reserve(inOp == eHybridUnion ? inA.mChunks.size() + inB.mChunks.size() : inA.mChunks.size());
+	HybridChunks::const_iterator	aItr = inA.mChunks.begin();
+	HybridChunks::const_iterator	aEnd = inA.mChunks.end();
+	HybridChunks::const_iterator	bItr = inB.mChunks.begin();
+	HybridChunks::const_iterator	bEnd = inB.mChunks.end();
+	while (aItr != aEnd || bItr != bEnd)
+	{
+		if (bItr == bEnd ||
+			(aItr != aEnd && aItr->key < bItr->key))
+		{
+			if (inOp != eHybridSect)
+			{
+				chunks.push_back(*aItr);
+			}
+			++aItr;
+		} else if (aItr == aEnd ||
+			bItr->key < aItr->key)
+		{
+			if (inOp == eHybridUnion)
+			{
+				chunks.push_back(*bItr);
+			}
+			++bItr;
+		} else
+		{
+			chunks.push_back(SHybridChunk());
+			if (!MergeChunks(*aItr, *bItr, inOp, chunks.back()))
+			{
+				chunks.pop_back();
+			}
+			++aItr;
+			++bItr;
+		}
+	}
+	mChunks.swap(chunks);
+	InvalidateRankCounts();
+}
+
+/************************************ Sect ************************************/
+bool HybridIndexVec::Sect(
+	const HybridIndexVec&	inIndexVec)
+{
+	Merge(*this, inIndexVec, eHybridSect);
+	return(Empty());
+}
+
+/******************************** operator &= *********************************/
+HybridIndexVec& HybridIndexVec::operator &= (
+	const HybridIndexVec&	inIndexVec)
+{
+	Sect(inIndexVec);
+	return(*this);
+}
+
+/*********************************** Union ************************************/
+void HybridIndexVec::Union(
+	const HybridIndexVec&	inIndexVec)
+{
+	Merge(*this, inIndexVec, eHybridUnion);
+}
+
+/******************************** operator += *********************************/
+HybridIndexVec& HybridIndexVec::operator += (
+	const HybridIndexVec&	inIndexVec)
+{
+	Union(inIndexVec);
+	return(*this);
+}
+
+/******************************** operator |= *********************************/
+HybridIndexVec& HybridIndexVec::operator |= (
+	const HybridIndexVec&	inIndexVec)
+{
+	Union(inIndexVec);
+	return(*this);
+}
+
+/************************************ Diff ************************************/
+bool HybridIndexVec::Diff(
+	const HybridIndexVec&	inIndexVec)
+{
+	Merge(*this, inIndexVec, eHybridDiff);
+	return(Empty());
+}
+
+/******************************** operator -= *********************************/
+HybridIndexVec& HybridIndexVec::operator -= (
+	const HybridIndexVec&	inIndexVec)
+{
+	Diff(inIndexVec);
+	return(*this);
+}
+
+/********************************** IsEqual ***********************************/
+/*
+*	Chunks are always the best type for their content, so equal vecs have
+*	identical chunks.
+*/
+bool HybridIndexVec::IsEqual(
+	const HybridIndexVec&	inIndexVec) const
+{
+	if (mChunks.size() == inIndexVec.mChunks.size())
+	{
+		for (size_t i = 0; i < mChunks.size(); i++)
+		{
+			const SHybridChunk&	chunk = mChunks[i];
+			const SHybridChunk&	otherChunk = inIndexVec.mChunks[i];
+			if (chunk.key != otherChunk.key ||
+				chunk.type != otherChunk.type ||
+				chunk.count != otherChunk.count ||
+				chunk.values != otherChunk.values ||
+				chunk.bitmap != otherChunk.bitmap)
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+	return(false);
+}
+
+/******************************* GetMemoryUsed ********************************/
+size_t HybridIndexVec::GetMemoryUsed(void) const
+{
+	size_t	memoryUsed = mChunks.capacity() * sizeof(SHybridChunk);
+	HybridChunks::const_iterator	itr = mChunks.begin();
+	HybridChunks::const_iterator	itrEnd = mChunks.end();
+	for (; itr != itrEnd; ++itr)
+	{
+		memoryUsed += (itr->values.capacity() * sizeof(uint16_t)) + (itr->bitmap.capacity() * sizeof(uint64_t));
+	}
+	return(memoryUsed);
+}
+
+/*************************** HybridIndexVecIterator ***************************/
+HybridIndexVecIterator::HybridIndexVecIterator(
+	const HybridIndexVec*	inIndexVec,
+	bool					inWrap)
+	: mIndexVec(inIndexVec), mWrap(inWrap), mCurrentChunk(0),
+		mCurrentIndex(IndexVecIterator::end), mLastCurrentIndex(IndexVecIterator::end)
+{
+	MoveToStart();
+}
+
+/******************************** SetIndexVec *********************************/
+void HybridIndexVecIterator::SetIndexVec(
+	const HybridIndexVec*	inIndexVec)
+{
+	mCurrentIndex = IndexVecIterator::end;
+	mLastCurrentIndex = IndexVecIterator::end;
+	mIndexVec = inIndexVec;
+	MoveToStart();
+}
+
+/************************************ Next ************************************/
+/*
+*	Same as IndexVecIterator, once the end has been reached only one of the
+*	MoveTo functions clears it.
+*/
+size_t HybridIndexVecIterator::Next(void)
+{
+	if (mIndexVec &&
+		mCurrentIndex != IndexVecIterator::end)
+	{
+		const HybridChunks&	chunks = mIndexVec->mChunks;
+		mLastCurrentIndex = mCurrentIndex;
+		int32_t	next = ChunkNext(chunks[mCurrentChunk], (uint32_t)(mCurrentIndex & 0xFFFF) + 1);
+		if (next == kNoValue)
+		{
+			mCurrentChunk++;
+			if (mCurrentChunk >= chunks.size())
+			{
+				if (mWrap)
+				{
+					mCurrentChunk = 0;
+				} else
+				{
+					mCurrentChunk--;
+					mCurrentIndex = IndexVecIterator::end;
+					return(IndexVecIterator::end);
+				}
+			}
+			next = ChunkNext(chunks[mCurrentChunk], 0);
+		}
+		mCurrentIndex = ((uint32_t)chunks[mCurrentChunk].key << 16) | (uint32_t)next;
+	}
+	return(mCurrentIndex);
+}
+
+/********************************** Previous **********************************/
+size_t HybridIndexVecIterator::Previous(void)
+{
+	if (mIndexVec &&
+		mCurrentIndex != IndexVecIterator::end)
+	{
+		const HybridChunks&	chunks = mIndexVec->mChunks;
+		mLastCurrentIndex = mCurrentIndex;
+		uint32_t	low = (uint32_t)(mCurrentIndex & 0xFFFF);
+		int32_t	previous = low ? ChunkPrevious(chunks[mCurrentChunk], low - 1) : kNoValue;
+		if (previous == kNoValue)
+		{
+			if (mCurrentChunk > 0)
+			{
+				mCurrentChunk--;
+			} else if (mWrap)
+			{
+				mCurrentChunk = chunks.size() - 1;
+			} else
+			{
+				mCurrentIndex = IndexVecIterator::end;
+				return(IndexVecIterator::end);
+			}
+			previous = ChunkPrevious(chunks[mCurrentChunk], 0xFFFF);
+		}
+		mCurrentIndex = ((uint32_t)chunks[mCurrentChunk].key << 16) | (uint32_t)previous;
+	}
+	return(mCurrentIndex);
+}
+
+/******************************** MoveToValue *********************************/
+/*
+*	When inIndex isn't in the vec, the closest index is chosen the same way
+*	as IndexVecIterator (the previous index unless the next is closer to
+*	inIndex than inIndex is to the index following the previous.)
+*/
+size_t HybridIndexVecIterator::MoveToValue(
+	size_t	inIndex)
+{
+	mLastCurrentIndex = mCurrentIndex;
+	mCurrentIndex = IndexVecIterator::end;
+	if (mIndexVec &&
+		!mIndexVec->Empty())
+	{
+		const HybridChunks&	chunks = mIndexVec->mChunks;
+		uint32_t	index = inIndex <= 0xFFFFFFFF ? (uint32_t)inIndex : 0xFFFFFFFF;
+		size_t	chunkIndex = mIndexVec->FindChunk(index >> 16);
+		size_t	nextChunk = chunkIndex;
+		int32_t	next = kNoValue;
+		if (chunkIndex < chunks.size())
+		{
+			next = ChunkNext(chunks[chunkIndex], chunks[chunkIndex].key == (index >> 16) ? (index & 0xFFFF) : 0);
+			if (next == kNoValue &&
+				++nextChunk < chunks.size())
+			{
+				next = ChunkNext(chunks[nextChunk], 0);
+			}
+		}
+		size_t	nextIndex = next != kNoValue ? ((uint32_t)chunks[nextChunk].key << 16) | (uint32_t)next : IndexVecIterator::end;
+		if (nextIndex == index)
+		{
+			mCurrentChunk = nextChunk;
+			mCurrentIndex = nextIndex;
+		} else
+		{
+			size_t	previousChunk = chunkIndex;
+			int32_t	previous = kNoValue;
+			if (chunkIndex < chunks.size() &&
+				chunks[chunkIndex].key == (index >> 16))
+			{
+				previous = ChunkPrevious(chunks[chunkIndex], index & 0xFFFF);
+			}
+			if (previous == kNoValue &&
+				previousChunk > 0)
+			{
+				previousChunk--;
+				previous = ChunkPrevious(chunks[previousChunk], 0xFFFF);
+			}
+			size_t	previousIndex = previous != kNoValue ? ((uint32_t)chunks[previousChunk].key << 16) | (uint32_t)previous : IndexVecIterator::end;
+			if (previousIndex == IndexVecIterator::end ||
+				(nextIndex != IndexVecIterator::end &&
+					(nextIndex - index) < (index - previousIndex - 1)))
+			{
+				mCurrentChunk = nextChunk;
+				mCurrentIndex = nextIndex;
+			} else
+			{
+				mCurrentChunk = previousChunk;
+				mCurrentIndex = previousIndex;
+			}
+		}
+	}
+	return(mCurrentIndex);
+}
+
+/***************************** CurrentIndexNumber *****************************/
+size_t HybridIndexVecIterator::CurrentIndexNumber(void) const
+{
+	return(IndexVecIterator::end != mCurrentIndex ? mIndexVec->GetIndexNumber(mCurrentIndex) : IndexVecIterator::end);
+}
+
+/***************************** MoveToIndexNumber ******************************/
+size_t HybridIndexVecIterator::MoveToIndexNumber(
+	size_t	inIndexNumber)
+{
+	if (mIndexVec &&
+		inIndexNumber < mIndexVec->GetCount())
+	{
+		return(MoveToValue(mIndexVec->GetNthIndex(inIndexNumber)));
+	}
+	return(MoveToEnd());
+}
+
+/******************************** MoveToStart *********************************/
+size_t HybridIndexVecIterator::MoveToStart(void)
+{
+	mLastCurrentIndex = mCurrentIndex;
+	mCurrentIndex = IndexVecIterator::end;
+	mCurrentChunk = 0;
+	if (mIndexVec &&
+		!mIndexVec->Empty())
+	{
+		mCurrentIndex = mIndexVec->GetMin();
+	}
+	return(mCurrentIndex);
+}
+
+/********************************* MoveToEnd **********************************/
+/*
+*	Same as IndexVecIterator, moves to the last index.
+*/
+size_t HybridIndexVecIterator::MoveToEnd(void)
+{
+	mLastCurrentIndex = mCurrentIndex;
+	mCurrentIndex = IndexVecIterator::end;
+	if (mIndexVec &&
+		!mIndexVec->Empty())
+	{
+		mCurrentChunk = mIndexVec->mChunks.size() - 1;
+		mCurrentIndex = mIndexVec->GetMax() - 1;
+	}
+	return(mCurrentIndex);
+}
@@ -0,0 +1,236 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  HybridIndexVec.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+/*
+*	HybridIndexVec has the interface of IndexVec but partitions the 32 bit
+*	index space into chunks of 64K indexes (like a Roaring bitmap.)  Each
+*	chunk that has indexes is stored as whichever of these is smallest:
+*		- eArrayChunk, the sorted low 16 bits of each index, 2 bytes per index
+*		- eRunChunk, first/last pairs of the low 16 bits, 4 bytes per run
+*		- eBitmapChunk, one bit per index of the chunk, 8KB
+*	An IndexVec is a single array of run offsets, so a fragmented set (e.g.
+*	every other flash page) costs 8 bytes per index, and Sect, Union and
+*	Diff are linear in the number of runs.  The same set here is a bitmap
+*	chunk, and Sect, Union and Diff of bitmap chunks are 16 byte vector
+*	AND, OR and ANDNOT (SSSE3 or NEON) with the population count taken in
+*	the same pass.
+*
+*	IndexVec is the better choice for a few long runs.  The two convert to
+*	each other (see Copy and CopyTo), and HybridIndexVecIterator has the
+*	interface of IndexVecIterator, so a caller can switch per use case.
+*
+*	Every chunk is kept in the type chosen for its content, so two equal
+*	vecs have identical chunks.
+*/
+#ifndef HybridIndexVec_h
+#define HybridIndexVec_h
+
+#include "IndexVec.h"
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+enum EHybridChunkType
+{
+	eArrayChunk,
+	eBitmapChunk,
+	eRunChunk
+};
+
+struct SHybridChunk
+{
+	uint16_t				key;		// The high 16 bits of the chunk's indexes
+	uint8_t					type;		// EHybridChunkType
+	uint32_t				count;		// The number of indexes, 1 to 65536
+	std::vector<uint16_t>	values;		// eArrayChunk: the sorted indexes
+										// eRunChunk: first, last pairs
+	std::vector<uint64_t>	bitmap;		// eBitmapChunk: 65536 bits
+};
+
+typedef std::vector<SHybridChunk> HybridChunks;
+
+class HybridIndexVec
+{
+	friend class HybridIndexVecIterator;
+public:
+							HybridIndexVec(void);
+							HybridIndexVec(
+								const HybridIndexVec&	inIndexVec);
+							HybridIndexVec(
+								const IndexVec&			inIndexVec);
+							~HybridIndexVec(void){}
+
+	void					SetRun(
+								uint32_t				inStart,
+								uint32_t				inEnd,
+								uint8_t					inValue);	// Must be 0 or 1
+	bool					Contains(
+								uint32_t				inPosition) const;
+	/*
+	*	Same as IndexVec, GetIndexNumber returns IndexVecIterator::end when
+	*	inIndex isn't in the vec.  Both use a prefix count per chunk that's
+	*	built on first use after the vec changes.  As with IndexVec the build
+	*	is guarded, so these may be called on a shared vec from several
+	*	threads.
+	*/
+	size_t					GetIndexNumber(
+								size_t					inIndex) const;
+	uint32_t				GetNthIndex(
+								size_t					inIndexNumber) const;
+							// Get the Max index (the last index + 1)
+	uint32_t				GetMax(void) const;
+							// Get the Min index
+	uint32_t				GetMin(void) const;
+	size_t					GetCount(void) const;
+	/*
+	*	Same as IndexVec, the range inFrom:inTo is inclusive.
+	*/
+	void					Set(
+								uint32_t				inFrom,
+								uint32_t				inTo);
+	void					Clear(
+								uint32_t				inFrom,
+								uint32_t				inTo);
+	void					Clear(void);
+
+	void					Copy(
+								const HybridIndexVec&	inIndexVec);
+	void					Copy(
+								const IndexVec&			inIndexVec);
+	/*
+	*	Replaces the content of outIndexVec with the indexes of this vec.
+	*/
+	void					CopyTo(
+								IndexVec&				outIndexVec) const;
+	HybridIndexVec&			operator = (	// Same as Copy
+								const HybridIndexVec&	inIndexVec);
+	HybridIndexVec&			operator = (	// Same as Copy
+								const IndexVec&			inIndexVec);
+
+	bool					Empty(void) const
+								{return(mChunks.empty());}
+	/*
+	*	Same as IndexVec, Sect and Diff return true if the result is an
+	*	empty vec.
+	*/
+	bool					Sect(
+								const HybridIndexVec&	inIndexVec);
+	HybridIndexVec&			operator &= (	// Same as Sect
+								const HybridIndexVec&	inIndexVec);
+	void					Union(
+								const HybridIndexVec&	inIndexVec);
+	HybridIndexVec&			operator += (	// Same as Union
+								const HybridIndexVec&	inIndexVec);
+	HybridIndexVec&			operator |= (	// Same as Union
+								const HybridIndexVec&	inIndexVec);
+	bool					Diff(
+								const HybridIndexVec&	inIndexVec);
+	HybridIndexVec&			operator -= (	// Same as Diff
+								const HybridIndexVec&	inIndexVec);
+	bool					IsEqual(
+								const HybridIndexVec&	inIndexVec) const;
+
+	const HybridChunks&		GetChunks(void) const
+								{return(mChunks);}
+	/*
+	*	The bytes allocated for the chunks.
+	*/
+	size_t					GetMemoryUsed(void) const;
+protected:
+	HybridChunks	mChunks;	// Sorted by key
+	/*
+	*	mRankCounts[i] is the number of indexes before the ith chunk.  The
+	*	last entry is the count.
+	*/
+	mutable std::vector<size_t>	mRankCounts;
+	mutable std::atomic<bool>	mRankCountsValid;
+	mutable std::mutex	mRankCountsMutex;
+
+	inline void				PrepareRankCounts(void) const
+								{if (!mRankCountsValid.load(std::memory_order_acquire)) BuildRankCounts();}
+	void					BuildRankCounts(void) const;
+	inline void				InvalidateRankCounts(void)
+								{mRankCountsValid.store(false, std::memory_order_relaxed);}
+	/*
+	*	Returns the index of the first chunk with a key >= inKey.
+	*/
+	size_t					FindChunk(
+								uint32_t				inKey) const;
+	/*
+	*	Replaces the chunks with inA combined with inB (inOp is an
+	*	EHybridMergeOp, see the source.)  Either may be this vec.
+	*/
+	void					Merge(
+								const HybridIndexVec&	inA,
+								const HybridIndexVec&	inB,
+								uint32_t				inOp);
+};
+
+class HybridIndexVecIterator
+{
+public:
+	/*
+	*	Same as IndexVecIterator, the vec must be valid for the life of the
+	*	iterator, and the routines that return an index may return
+	*	IndexVecIterator::end if the vec is empty OR inWrap is false.
+	*/
+							HybridIndexVecIterator(
+								const HybridIndexVec*	inIndexVec = NULL,
+								bool					inWrap = false);
+							~HybridIndexVecIterator(void){}
+
+	void					SetIndexVec(
+								const HybridIndexVec*	inIndexVec);
+	size_t					CurrentIndexNumber(void) const;
+	size_t					Current(void) const
+								{return(mCurrentIndex);}
+	size_t					LastCurrent(void) const
+								{return(mLastCurrentIndex);}
+	size_t					Next(void);
+	size_t					Previous(void);
+	/*
+	*	If inIndex is not in the vec then the closest index is returned.
+	*	The closest index may be before inIndex.
+	*/
+	size_t					MoveToValue(
+								size_t					inIndex);
+	/*
+	*	If inIndexNumber is past the end of the vec then the last index is
+	*	returned or end if the vec is empty.
+	*/
+	size_t					MoveToIndexNumber(
+								size_t					inIndexNumber);
+	size_t					MoveToStart(void);
+	size_t					MoveToEnd(void);
+protected:
+	const HybridIndexVec*	mIndexVec;
+	bool			mWrap;
+	size_t			mCurrentChunk;
+	size_t			mCurrentIndex;
+	size_t			mLastCurrentIndex;
+};
+
+#endif /* HybridIndexVec_h */
@@ -25,10 +25,75 @@
 //  Copyright © 2018 Jon Mackey. All rights reserved.
 //
 #include "IndexVec.h"
+#include "Fingerprint.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <stddef.h>
+#include <string.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/*
+*	The header of the binary form.  All values are little endian.  The
+*	header is followed by the control bytes, then the delta bytes.
+*/
+struct SIndexVecBinaryHeader
+{
+	uint32_t	signature;		// kIndexVecBinarySignature
+	uint8_t		firstRunValue;
+	uint8_t		reserved[3];
+	uint32_t	numDeltas;		// The number of run offsets less the leading 0
+	uint32_t	lastIndex;		// The last run offset, an error check
+	uint32_t	dataLength;		// The length of the delta bytes
+	uint32_t	reserved2;
+	uint64_t	checksum;		// Fingerprint of the preceding header fields
+								// and the control and delta bytes.
+};
+
+static const uint32_t	kIndexVecBinarySignature = 0x31425649;	// IVB1
+
+/*
+*	kStreamVByteTables maps a control byte, the byte lengths less 1 of four
+*	deltas in its 2 bit fields (the first delta in the low bits), to the
+*	total length of the four deltas and to the shuffle that expands them to
+*	four uint32_t.  Shuffle indexes of 0x80 produce 0 (pshufb and tbl.)
+*/
+struct SStreamVByteTables
+{
+	uint8_t	length[256];
+	uint8_t	shuffle[256][16];
+};
+
+static constexpr SStreamVByteTables MakeStreamVByteTables(void)
+{
+	SStreamVByteTables	tables = {};
+	for (uint32_t control = 0; control < 256; control++)
+	{
+		uint32_t	offset = 0;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			uint32_t	length = ((control >> (i*2)) & 3) + 1;
+			for (uint32_t j = 0; j < 4; j++)
+			{
+				tables.shuffle[control][i*4 + j] = j < length ? (uint8_t)(offset + j) : 0x80;
+			}
+			offset += length;
+		}
+		tables.length[control] = (uint8_t)offset;
+	}
+	return(tables);
+}
+
+static constexpr SStreamVByteTables	kStreamVByteTables = MakeStreamVByteTables();
 
 /********************************* IndexVec ***********************************/
 IndexVec::IndexVec(void)
-	: mFirstRunValue(0)
+	: mFirstRunValue(0), mRankCountsValid(false)
 {
 	mRuns.push_back(0);
 }
@@ -37,13 +102,14 @@ IndexVec::IndexVec(void)
 IndexVec::IndexVec(
 	const IndexVec&	inIndexVec)
 	: mFirstRunValue(inIndexVec.GetFirstRunValue()),
-		mRuns(inIndexVec.GetRuns())
+		mRuns(inIndexVec.GetRuns()), mRankCountsValid(false)
 {
 }
 
 /********************************* IndexVec ***********************************/
 IndexVec::IndexVec(
 	const std::string&	inSerializedIndexVec)
+	: mFirstRunValue(0), mRankCountsValid(false)
 {
 	SetFromSerial(inSerializedIndexVec);
 }
@@ -56,6 +122,7 @@ void IndexVec::SetRun(
 {
 	if (inStart < inEnd)
 	{
+		InvalidateRankCounts();
 		if (inStart <= GetMax())
 		{
 			if (inValue != 0 ||
@@ -148,31 +215,15 @@ bool IndexVec::Contains(
 size_t IndexVec::GetIndexNumber(
 	size_t	inIndex) const
 {
-	if (mFirstRunValue != (mRuns.size() & 1))
+	if (mFirstRunValue != (mRuns.size() & 1) &&
+		inIndex <= 0xFFFFFFFF)
 	{
-		size_t	indexNumber = 0;
-		Runs::const_iterator	itr = mRuns.begin();
-		Runs::const_iterator	itrEnd = mRuns.end();
-
-		if (mFirstRunValue == 0)
+		size_t	runIndex = GetRunIndex((uint32_t)inIndex, 0);
+		if (GetRunValue(runIndex) &&
+			inIndex >= mRuns[runIndex])
 		{
-			++itr;
-		}
-		size_t	runStart;
-		for (; itr != itrEnd; ++itr)
-		{
-			runStart = *itr;
-			++itr;
-			if (inIndex >= runStart)
-			{
-				if (inIndex >= *itr)
-				{
-					indexNumber += (*itr - runStart);
-				} else
-				{
-					return(indexNumber + inIndex - runStart);
-				}
-			}
+			PrepareRankCounts();
+			return(mRankCounts[(runIndex - FirstPositiveRun())/2] + inIndex - mRuns[runIndex]);
 		}
 	}
 	return(IndexVecIterator::end);
@@ -187,30 +238,45 @@ uint32_t IndexVec::GetNthIndex(
 {
 	if (mFirstRunValue != (mRuns.size() & 1))
 	{
-		uint32_t	startIndexNumber = 0;
-		uint32_t	endIndexNumber = 0;
-		Runs::const_iterator	itr = mRuns.begin();
-		Runs::const_iterator	itrEnd = mRuns.end();
-
-		if (mFirstRunValue == 0)
+		PrepareRankCounts();
+		if (inIndexNumber < mRankCounts.back())
 		{
-			++itr;
+			// The last run of 1s with fewer indexes before it than inIndexNumber + 1
+			size_t	positiveRun = (std::upper_bound(mRankCounts.begin(), mRankCounts.end() - 1, inIndexNumber) -
+										mRankCounts.begin()) - 1;
+			return(mRuns[FirstPositiveRun() + (positiveRun * 2)] + (uint32_t)(inIndexNumber - mRankCounts[positiveRun]));
 		}
-		uint32_t	runStart;
-		for (; itr != itrEnd; ++itr)
+	}
+	return(GetMax()-1);
+}
+
+/****************************** BuildRankCounts *******************************/
+/*
+*	Called by PrepareRankCounts when the counts are stale.  Another thread
+*	may have built them while this one waited for the lock.
+*/
+void IndexVec::BuildRankCounts(void) const
+{
+	std::lock_guard<std::mutex>	lock(mRankCountsMutex);
+	if (mRankCountsValid.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	mRankCounts.clear();
+	size_t	count = 0;
+	if (mFirstRunValue != (mRuns.size() & 1))
+	{
+		mRankCounts.reserve((mRuns.size() / 2) + 1);
+		Runs::const_iterator	itr = mRuns.begin() + FirstPositiveRun();
+		Runs::const_iterator	itrEnd = mRuns.end();
+		for (; itr != itrEnd; itr += 2)
 		{
-			runStart = *itr;
-			++itr;
-			endIndexNumber += (*itr - runStart);
-			if ((uint32_t)inIndexNumber >= endIndexNumber)
-			{
-				startIndexNumber = endIndexNumber;
-				continue;
-			}
-			return(runStart - startIndexNumber + (uint32_t)inIndexNumber);
+			mRankCounts.push_back(count);
+			count += (itr[1] - itr[0]);
 		}
 	}
-	return(GetMax()-1);
+	mRankCounts.push_back(count);
+	mRankCountsValid.store(true, std::memory_order_release);
 }
 
 /******************************** GetRunIndex *********************************/
@@ -281,6 +347,7 @@ void IndexVec::Clear(void)
 	mRuns.clear();
 	mFirstRunValue = 0;
 	mRuns.push_back(0);
+	InvalidateRankCounts();
 }
 
 /********************************** Empty *************************************/
@@ -292,25 +359,8 @@ bool IndexVec::Empty(void) const
 /********************************* GetCount ***********************************/
 size_t IndexVec::GetCount(void) const
 {
-	size_t	count = 0;
-	if (mFirstRunValue != (mRuns.size() & 1))
-	{
-		Runs::const_iterator	itr = mRuns.begin();
-		Runs::const_iterator	itrEnd = mRuns.end();
-
-		if (mFirstRunValue == 0)
-		{
-			++itr;
-		}
-		size_t	runStart;
-		for (; itr != itrEnd; ++itr)
-		{
-			runStart = *itr;
-			++itr;
-			count += (*itr - runStart);
-		}
-	}
-	return(count);
+	PrepareRankCounts();
+	return(mRankCounts.back());
 }
 
 /*********************************** Copy *************************************/
@@ -319,6 +369,7 @@ void IndexVec::Copy(
 {
 	mFirstRunValue = inIndexVec.GetFirstRunValue();
 	mRuns = inIndexVec.GetRuns();
+	InvalidateRankCounts();
 }
 
 /******************************** operator = **********************************/
@@ -335,27 +386,7 @@ void IndexVec::Union(
 {
 	if (&inIndexVec != this)
 	{
-		/*
-		*	If mFirstRunValue is 0, then there should be an odd number of run offsets.
-		*	If mFirstRunValue is 1, then there should be an even number of run offsets.
-		*/
-		if (mFirstRunValue != (mRuns.size() & 1))
-		{
-			Runs::const_iterator	itr = inIndexVec.GetRuns().begin();
-			Runs::const_iterator	itrEnd = inIndexVec.GetRuns().end();
-
-			if (inIndexVec.GetFirstRunValue() == 0)
-			{
-				++itr;
-			}
-			uint32_t	runStart;
-			for (; itr != itrEnd; ++itr)
-			{
-				runStart = *itr;
-				++itr;
-				SetRun(runStart, *itr, 1);
-			}
-		}
+		Merge(*this, inIndexVec, eMergeUnion);
 	}
 }
 
@@ -380,34 +411,9 @@ IndexVec& IndexVec::operator |= (
 bool IndexVec::Diff(
 	const IndexVec&	inIndexVec)
 {
-	if (&inIndexVec != this)
+	if (!Empty())
 	{
-		/*
-		*	If mFirstRunValue is 0, then there should be an odd number of run offsets.
-		*	If mFirstRunValue is 1, then there should be an even number of run offsets.
-		*/
-		if (mFirstRunValue != (mRuns.size() & 1))
-		{
-			Runs::const_iterator	itr = inIndexVec.GetRuns().begin();
-			Runs::const_iterator	itrEnd = inIndexVec.GetRuns().end();
-
-			if (inIndexVec.GetFirstRunValue() == 0)
-			{
-				++itr;
-			}
-			uint32_t	runStart = 0;
-			uint32_t	max = GetMax();
-			uint32_t	min = GetMin();
-			for (; itr != itrEnd && runStart < max; ++itr)
-			{
-				runStart = *itr;
-				++itr;
-				if (*itr > min)
-				{
-					SetRun(runStart, *itr, 0);
-				}
-			}
-		}
+		Merge(*this, inIndexVec, eMergeDiff);
 	}
 	return(Empty());
 }
@@ -427,34 +433,7 @@ bool IndexVec::Sect(
 	if (&inIndexVec != this &&
 		!Empty())
 	{
-		/*
-		*	If mFirstRunValue is 0, then there should be an odd number of run offsets.
-		*	If mFirstRunValue is 1, then there should be an even number of run offsets.
-		*/
-		if (mFirstRunValue != (mRuns.size() & 1))
-		{
-			Runs::const_iterator	itr = inIndexVec.GetRuns().begin();
-			Runs::const_iterator	itrEnd = inIndexVec.GetRuns().end();
-
-			if (inIndexVec.GetFirstRunValue() == 1)
-			{
-				++itr;
-			}
-			uint32_t	runStart = *itr;
-			++itr;
-			uint32_t	max = GetMax();
-			uint32_t	min = GetMin();
-			for (; itr != itrEnd && runStart < max; ++itr)
-			{
-				if (*itr > min)
-				{
-					SetRun(runStart, *itr, 0);
-				}
-				++itr;
-				runStart = *itr;
-			}
-			SetRun(runStart, 0xFFFFFFFF, 0);
-		}
+		Merge(*this, inIndexVec, eMergeSect);
 	}
 	return(Empty());
 }
@@ -467,6 +446,141 @@ IndexVec& IndexVec::operator &= (
 	return(*this);
 }
 
+/*********************************** Merge ************************************/
+/*
+*	The offsets of both vecs are walked in order as one sorted sequence of
+*	transitions.  Each offset toggles the value of its vec, and an offset is
+*	written whenever the combined value changes.  Duplicate offsets (zero
+*	length runs) toggle twice so they're harmless.
+*/
+void IndexVec::Merge(
+	const IndexVec&	inA,
+	const IndexVec&	inB,
+	uint8_t			inTruthTable)
+{
+	const Runs&	runsA = inA.GetRuns();
+	const Runs&	runsB = inB.GetRuns();
+	size_t		sizeA = runsA.size();
+	size_t		sizeB = runsB.size();
+	Runs		runs;
+	runs.reserve(sizeA + sizeB);
+	runs.push_back(0);
+	uint32_t	valueA = inA.GetFirstRunValue();
+	uint32_t	valueB = inB.GetFirstRunValue();
+	uint8_t		value = (inTruthTable >> ((valueA << 1) | valueB)) & 1;
+	uint8_t		firstRunValue = value;
+	size_t		indexA = 1;
+	size_t		indexB = 1;
+	while (indexA < sizeA ||
+		indexB < sizeB)
+	{
+		uint32_t	position = indexA < sizeA ? runsA[indexA] : 0xFFFFFFFF;
+		if (indexB < sizeB &&
+			runsB[indexB] < position)
+		{
+			position = runsB[indexB];
+		}
+		for (; indexA < sizeA && runsA[indexA] == position; indexA++)
+		{
+			valueA ^= 1;
+		}
+		for (; indexB < sizeB && runsB[indexB] == position; indexB++)
+		{
+			valueB ^= 1;
+		}
+		uint8_t	newValue = (inTruthTable >> ((valueA << 1) | valueB)) & 1;
+		if (newValue != value)
+		{
+			value = newValue;
+			if (position)
+			{
+				runs.push_back(position);
+			} else
+			{
+				firstRunValue = value;
+			}
+		}
+	}
+	mFirstRunValue = firstRunValue;
+	mRuns.swap(runs);
+	InvalidateRankCounts();
+}
+
+/*********************************** Merge ************************************/
+/*
+*	Same as the two vec Merge, with the next offset of each vec kept in a
+*	min heap and a count of the vecs currently within a run of 1s.
+*/
+void IndexVec::Merge(
+	const IndexVec* const*	inIndexVecs,
+	size_t					inCount,
+	size_t					inMinCount,
+	IndexVec&				outIndexVec)
+{
+	typedef std::pair<uint32_t, size_t> SNextOffset;	// Offset, vec index
+	std::priority_queue<SNextOffset, std::vector<SNextOffset>, std::greater<SNextOffset> >	heap;
+	std::vector<size_t>	nextRun(inCount, 1);
+	size_t	minCount = inMinCount ? inMinCount : 1;
+	size_t	count = 0;
+	size_t	totalSize = 0;
+	for (size_t i = 0; i < inCount; i++)
+	{
+		const Runs&	runs = inIndexVecs[i]->GetRuns();
+		count += inIndexVecs[i]->GetFirstRunValue();
+		totalSize += runs.size();
+		if (runs.size() > 1)
+		{
+			heap.push(SNextOffset(runs[1], i));
+		}
+	}
+	Runs	runs;
+	runs.reserve(totalSize);
+	runs.push_back(0);
+	uint8_t	value = inCount && count >= minCount;
+	uint8_t	firstRunValue = value;
+	while (!heap.empty())
+	{
+		uint32_t	position = heap.top().first;
+		do
+		{
+			size_t		vecIndex = heap.top().second;
+			const Runs&	vecRuns = inIndexVecs[vecIndex]->GetRuns();
+			size_t		runIndex = nextRun[vecIndex];
+			heap.pop();
+			// The value before the offset is that of run runIndex - 1
+			if (inIndexVecs[vecIndex]->GetRunValue(runIndex - 1))
+			{
+				count--;
+			} else
+			{
+				count++;
+			}
+			runIndex++;
+			nextRun[vecIndex] = runIndex;
+			if (runIndex < vecRuns.size())
+			{
+				heap.push(SNextOffset(vecRuns[runIndex], vecIndex));
+			}
+		} while (!heap.empty() &&
+			heap.top().first == position);
+		uint8_t	newValue = count >= minCount;
+		if (newValue != value)
+		{
+			value = newValue;
+			if (position)
+			{
+				runs.push_back(position);
+			} else
+			{
+				firstRunValue = value;
+			}
+		}
+	}
+	outIndexVec.mFirstRunValue = firstRunValue;
+	outIndexVec.mRuns.swap(runs);
+	outIndexVec.InvalidateRankCounts();
+}
+
 /********************************** IsEqual ***********************************/
 bool IndexVec::IsEqual(
 	const IndexVec&	inIndexVec)
@@ -496,6 +610,7 @@ bool IndexVec::IsEqual(
 bool IndexVec::SetFromSerial(
 	const std::string&	inSerializedIndexVec)
 {
+	InvalidateRankCounts();
 	const char* charPtr = inSerializedIndexVec.c_str();
 	char		thisChar = *(charPtr++);
 	uint32_t	currIndex = 0;
@@ -612,6 +727,329 @@ const std::string& IndexVec::Serialize(
 	return(outSerializedIndexVec);
 }
 
+/******************************* DecodeDeltas *********************************/
+/*
+*	Decodes inNumDeltas stream-vbyte deltas, writing their running sum to
+*	outRuns.  Groups of four deltas are expanded by a vector shuffle (SSSE3
+*	pshufb or NEON tbl) and summed within the vector.  The vector loop stops
+*	when fewer than 16 delta bytes remain so it never reads past inDataEnd.
+*	Returns false if the delta bytes don't end with the last delta or a
+*	delta is 0 (the run offsets must ascend.)
+*/
+static bool DecodeDeltas(
+	const uint8_t*	inControl,
+	const uint8_t*	inData,
+	const uint8_t*	inDataEnd,
+	uint32_t		inNumDeltas,
+	uint32_t*		outRuns)
+{
+	uint32_t	deltaIndex = 0;
+	uint32_t	runOffset = 0;
+	bool		valid = true;
+#if defined(__SSSE3__)
+	__m128i	runsVec = _mm_setzero_si128();
+	__m128i	zeroDeltaVec = _mm_setzero_si128();
+	for (; (inNumDeltas - deltaIndex) >= 4 &&
+			(inDataEnd - inData) >= 16; deltaIndex += 4)
+	{
+		uint8_t	control = inControl[deltaIndex/4];
+		__m128i	deltas = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)inData),
+								_mm_loadu_si128((const __m128i*)kStreamVByteTables.shuffle[control]));
+		inData += kStreamVByteTables.length[control];
+		zeroDeltaVec = _mm_or_si128(zeroDeltaVec, _mm_cmpeq_epi32(deltas, _mm_setzero_si128()));
+		deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 4));
+		deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 8));
+		runsVec = _mm_add_epi32(deltas, _mm_shuffle_epi32(runsVec, 0xFF));
+		_mm_storeu_si128((__m128i*)&outRuns[deltaIndex], runsVec);
+	}
+	valid = _mm_movemask_epi8(zeroDeltaVec) == 0;
+	runOffset = (uint32_t)_mm_cvtsi128_si32(_mm_shuffle_epi32(runsVec, 0xFF));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	const uint32x4_t	zeroVec = vdupq_n_u32(0);
+	uint32x4_t	runsVec = zeroVec;
+	uint32x4_t	zeroDeltaVec = zeroVec;
+	for (; (inNumDeltas - deltaIndex) >= 4 &&
+			(inDataEnd - inData) >= 16; deltaIndex += 4)
+	{
+		uint8_t	control = inControl[deltaIndex/4];
+		uint32x4_t	deltas = vreinterpretq_u32_u8(vqtbl1q_u8(vld1q_u8(inData),
+								vld1q_u8(kStreamVByteTables.shuffle[control])));
+		inData += kStreamVByteTables.length[control];
+		zeroDeltaVec = vorrq_u32(zeroDeltaVec, vceqzq_u32(deltas));
+		// vextq_u32(zero, deltas, n) shifts deltas up by 4 - n lanes
+		deltas = vaddq_u32(deltas, vextq_u32(zeroVec, deltas, 3));
+		deltas = vaddq_u32(deltas, vextq_u32(zeroVec, deltas, 2));
+		runsVec = vaddq_u32(deltas, vdupq_laneq_u32(runsVec, 3));
+		vst1q_u32(&outRuns[deltaIndex], runsVec);
+	}
+	valid = vmaxvq_u32(zeroDeltaVec) == 0;
+	runOffset = vgetq_lane_u32(runsVec, 3);
+#endif
+	for (; deltaIndex < inNumDeltas; deltaIndex++)
+	{
+		uint32_t	length = ((inControl[deltaIndex/4] >> ((deltaIndex & 3)*2)) & 3) + 1;
+		if ((size_t)(inDataEnd - inData) < length)
+		{
+			valid = false;
+			break;
+		}
+		uint32_t	delta = 0;
+		for (uint32_t i = 0; i < length; i++)
+		{
+			delta |= (uint32_t)inData[i] << (i*8);
+		}
+		inData += length;
+		valid = valid && delta != 0;
+		runOffset += delta;
+		outRuns[deltaIndex] = runOffset;
+	}
+	return(valid && inData == inDataEnd);
+}
+
+/******************************* SetFromBinary ********************************/
+bool IndexVec::SetFromBinary(
+	const void*	inData,
+	size_t		inLength,
+	size_t*		outLength)
+{
+	InvalidateRankCounts();
+	SIndexVecBinaryHeader	header;
+	bool	success = inLength >= sizeof(header);
+	if (success)
+	{
+		memcpy(&header, inData, sizeof(header));
+		const uint8_t*	control = (const uint8_t*)inData + sizeof(header);
+		size_t	controlLength = ((size_t)header.numDeltas + 3)/4;
+		size_t	bodyLength = controlLength + header.dataLength;
+		/*
+		*	Every delta is at least one byte, so a valid dataLength also
+		*	limits the number of runs allocated below.
+		*/
+		success = header.signature == kIndexVecBinarySignature &&
+			header.firstRunValue <= 1 &&
+			header.firstRunValue != ((header.numDeltas + 1) & 1) &&
+			header.dataLength >= header.numDeltas &&
+			(inLength - sizeof(header)) >= bodyLength &&
+			header.checksum == Fingerprint::Hash(control, bodyLength,
+					Fingerprint::Hash(&header, offsetof(SIndexVecBinaryHeader, checksum)));
+		if (success)
+		{
+			Runs	runs(header.numDeltas + 1);
+			success = DecodeDeltas(control, &control[controlLength], &control[bodyLength],
+							header.numDeltas, &runs[1]) &&
+						runs.back() == header.lastIndex;
+			if (success)
+			{
+				mFirstRunValue = header.firstRunValue;
+				mRuns.swap(runs);
+				if (outLength)
+				{
+					*outLength = sizeof(header) + bodyLength;
+				}
+			}
+		}
+	}
+	if (!success)
+	{
+		mFirstRunValue = 0;
+		mRuns.clear();
+		mRuns.push_back(0);
+	}
+	return(success);
+}
+
+/****************************** SerializeBinary *******************************/
+/*
+*	The run offsets are written as the deltas between consecutive offsets
+*	(the leading 0 is implied) using stream-vbyte: each delta is 1 to 4 little
+*	endian bytes, and its length less 1 is a 2 bit field of a control byte.
+*	The control bytes precede all of the delta bytes so that four deltas can
+*	be decoded at a time, see DecodeDeltas.
+*/
+const std::string& IndexVec::SerializeBinary(
+	std::string&	outBinary) const
+{
+	SIndexVecBinaryHeader	header;
+	memset(&header, 0, sizeof(header));
+	header.signature = kIndexVecBinarySignature;
+	header.firstRunValue = mFirstRunValue;
+	header.numDeltas = (uint32_t)(mRuns.size() - 1);
+	header.lastIndex = mRuns.back();
+	size_t	controlLength = ((size_t)header.numDeltas + 3)/4;
+	size_t	headerStart = outBinary.size();
+	outBinary.resize(headerStart + sizeof(header) + controlLength + ((size_t)header.numDeltas * 4));
+	uint8_t*	control = (uint8_t*)&outBinary[headerStart + sizeof(header)];
+	uint8_t*	data = &control[controlLength];
+	memset(control, 0, controlLength);
+	for (uint32_t i = 0; i < header.numDeltas; i++)
+	{
+		uint32_t	delta = mRuns[i+1] - mRuns[i];
+		uint32_t	length = delta < 0x100 ? 1 : (delta < 0x10000 ? 2 : (delta < 0x1000000 ? 3 : 4));
+		control[i/4] |= (uint8_t)((length - 1) << ((i & 3)*2));
+		for (uint32_t j = 0; j < length; j++, delta >>= 8)
+		{
+			*(data++) = (uint8_t)delta;
+		}
+	}
+	header.dataLength = (uint32_t)(data - &control[controlLength]);
+	header.checksum = Fingerprint::Hash(control, controlLength + header.dataLength,
+							Fingerprint::Hash(&header, offsetof(SIndexVecBinaryHeader, checksum)));
+	memcpy(&outBinary[headerStart], &header, sizeof(header));
+	outBinary.resize(headerStart + sizeof(header) + controlLength + header.dataLength);
+	return(outBinary);
+}
+
+/****************************** IndexVecBuilder *******************************/
+IndexVecBuilder::IndexVecBuilder(void)
+	: mFirstRunValue(0), mIsSorted(true), mNumDuplicates(0)
+{
+	mRuns.push_back(0);
+}
+
+/*********************************** AddRun ***********************************/
+void IndexVecBuilder::AddRun(
+	uint32_t	inStart,
+	uint32_t	inEnd)
+{
+	if (inStart < inEnd)
+	{
+		size_t	numOffsets = mRuns.size();
+		if (numOffsets == 1 &&
+			mFirstRunValue == 0)
+		{
+			if (inStart == 0)
+			{
+				mFirstRunValue = 1;
+			} else
+			{
+				mRuns.push_back(inStart);
+			}
+			mRuns.push_back(inEnd);
+		} else if (mIsSorted &&
+			inStart >= mRuns[numOffsets-2])
+		{
+			uint32_t	lastEnd = mRuns.back();
+			if (inStart > lastEnd)
+			{
+				mRuns.push_back(inStart);
+				mRuns.push_back(inEnd);
+			} else
+			{
+				mNumDuplicates += (inEnd < lastEnd ? inEnd : lastEnd) - inStart;
+				if (inEnd > lastEnd)
+				{
+					mRuns.back() = inEnd;
+				}
+			}
+		} else
+		{
+			mIsSorted = false;
+			mRuns.push_back(inStart);
+			mRuns.push_back(inEnd);
+		}
+	}
+}
+
+/*********************************** Build ************************************/
+/*
+*	When ranges were added out of order they're sorted by start and added
+*	again in order.  The duplicates of ranges merged before then have
+*	already been counted.
+*/
+size_t IndexVecBuilder::Build(
+	IndexVec&	outIndexVec)
+{
+	if (!mIsSorted)
+	{
+		typedef std::pair<uint32_t, uint32_t> SRange;
+		std::vector<SRange>	ranges;
+		ranges.reserve(mRuns.size() / 2);
+		for (size_t i = mFirstRunValue ? 0 : 1; (i + 1) < mRuns.size(); i += 2)
+		{
+			ranges.push_back(SRange(mRuns[i], mRuns[i+1]));
+		}
+		std::sort(ranges.begin(), ranges.end());
+		size_t	numDuplicates = mNumDuplicates;	// Those of merged sorted adds
+		Clear();
+		mNumDuplicates = numDuplicates;
+		std::vector<SRange>::const_iterator	itr = ranges.begin();
+		std::vector<SRange>::const_iterator	itrEnd = ranges.end();
+		for (; itr != itrEnd; ++itr)
+		{
+			AddRun(itr->first, itr->second);
+		}
+	}
+	size_t	numDuplicates = mNumDuplicates;
+	outIndexVec.mFirstRunValue = mFirstRunValue;
+	outIndexVec.mRuns.swap(mRuns);
+	outIndexVec.InvalidateRankCounts();
+	Clear();
+	return(numDuplicates);
+}
+
+/*********************************** Clear ************************************/
+void IndexVecBuilder::Clear(void)
+{
+	mRuns.clear();
+	mRuns.push_back(0);
+	mFirstRunValue = 0;
+	mIsSorted = true;
+	mNumDuplicates = 0;
+}
+
+/***************************** BuildFromUnsorted ******************************/
+void IndexVecBuilder::BuildFromUnsorted(
+	std::vector<uint32_t>&	ioIndexes,
+	IndexVec&				outIndexVec)
+{
+	const size_t	kMinIndexesPerThread = 0x10000;
+	size_t	numThreads = std::min((size_t)std::max(std::thread::hardware_concurrency(), 1U),
+									ioIndexes.size() / kMinIndexesPerThread);
+	size_t	numParts = numThreads > 1 ? numThreads : 1;
+	std::vector<IndexVec>	parts(numParts);
+	std::vector<std::thread>	threads;
+	size_t	partSize = (ioIndexes.size() + numParts - 1) / numParts;
+	for (size_t part = 0; part < numParts; part++)
+	{
+		std::vector<uint32_t>::iterator	partBegin = ioIndexes.begin() + std::min(part * partSize, ioIndexes.size());
+		std::vector<uint32_t>::iterator	partEnd = ioIndexes.begin() + std::min((part + 1) * partSize, ioIndexes.size());
+		IndexVec*	partIndexVec = &parts[part];
+		auto	sortAndCoalesce = [partBegin, partEnd, partIndexVec](void)
+		{
+			std::sort(partBegin, partEnd);
+			IndexVecBuilder	builder;
+			for (std::vector<uint32_t>::const_iterator itr = partBegin; itr != partEnd; ++itr)
+			{
+				builder.Add(*itr);
+			}
+			builder.Build(*partIndexVec);
+		};
+		if (numParts > 1)
+		{
+			threads.push_back(std::thread(sortAndCoalesce));
+		} else
+		{
+			sortAndCoalesce();
+		}
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+	if (numParts > 1)
+	{
+		std::vector<const IndexVec*>	partPtrs(numParts);
+		for (size_t part = 0; part < numParts; part++)
+		{
+			partPtrs[part] = &parts[part];
+		}
+		IndexVec::UnionOf(partPtrs.data(), numParts, outIndexVec);
+	} else
+	{
+		outIndexVec.Copy(parts[0]);
+	}
+}
+
 const size_t	IndexVecIterator::end = -1;
 
 /***************************** IndexVecIterator *******************************/
@@ -793,53 +1231,12 @@ size_t IndexVecIterator::CurrentIndexNumber(void) const
 size_t IndexVecIterator::MoveToIndexNumber(
 	size_t	inIndexNumber)
 {
-	mLastCurrentIndex = mCurrentIndex;
-	mCurrentIndex = end;
-	if (mIndexVec)
+	if (mIndexVec &&
+		inIndexNumber < mIndexVec->GetCount())
 	{
-		const Runs&	runs = mIndexVec->GetRuns();
-		size_t	numOffsets = runs.size();
-		/*
-		*	Verify that the IndexVec is not empty and is valid
-		*	(has the expected number of offsets)
-		*/
-		if (numOffsets > 1 &&
-			mIndexVec->GetFirstRunValue() != (numOffsets & 1))
-		{
-			Runs::const_iterator	itr = runs.begin();
-			Runs::const_iterator	itrEnd = runs.end();
-
-			if (mIndexVec->GetFirstRunValue() == 0)
-			{
-				++itr;
-			}
-			size_t	runStart;
-			size_t	count = 0;
-			for (; itr != itrEnd; ++itr)
-			{
-				runStart = *itr;
-				++itr;
-				count += *itr - runStart;
-				if (inIndexNumber >= count)
-				{
-					continue;
-				}
-				mCurrentRun = itr - runs.begin();
-				mRunEndIndex = *itr;
-				mRunStartIndex = runStart;
-				mCurrentIndex = mRunEndIndex - count + inIndexNumber;
-				break;
-			}
-			if (mCurrentIndex == end)
-			{
-				mCurrentRun = numOffsets - 1;
-				mRunEndIndex = runs.at(mCurrentRun);
-				mCurrentIndex = mRunEndIndex -1;
-				mRunStartIndex = runs.at(mCurrentRun-1);
-			}
-		}
+		return(MoveToValue(mIndexVec->GetNthIndex(inIndexNumber)));
 	}
-	return(mCurrentIndex);
+	return(MoveToEnd());
 }
 
 /******************************** MoveToStart *********************************/
@@ -29,6 +29,8 @@
 #define IndexVec_H
 #include <vector>
 #include <string>
+#include <atomic>
+#include <mutex>
 #ifndef __GNUC__
 #include <cstdint>
 #endif
@@ -45,7 +47,7 @@
 *	You would call SetRun(3,7,1) and SetRun(10,14,1)
 *	Resulting in: 0,3,7,10,14 with the mFirstRunValue set to 0.
 *
-*	See the source for Union to see how to iterate/make sense of the index array offsets.
+*	See the source for GetCount to see how to iterate/make sense of the index array offsets.
 *
 *	frv -> first run value, either 1 or 0
 *	lrv -> last run value, sanity check, should always be 0
@@ -78,11 +80,25 @@
 *	0123456789012345678901234567890123
 *	...............................
 *	frv = 0, offsets = 0 lrv = 0
+*
+*	Sect, Union and Diff merge the two offset arrays in a single pass into a
+*	new array, so they're linear in the total number of offsets.
+*
+*	GetIndexNumber (rank), GetNthIndex (select) and GetCount use a prefix
+*	count per run of 1s that's built on first use after the runs change,
+*	making them O(log n), O(log n) and O(1).  Changing the runs only marks
+*	the prefix counts as stale.  The build is guarded by a mutex, so like
+*	the other const routines these can be called on a shared vec from
+*	several threads.  Changing a vec still requires exclusive access.
+*
+*	Besides the text form of Serialize there's a binary form, see
+*	SerializeBinary, that can be decoded directly from a memory mapped file.
 */
 
 typedef std::vector<uint32_t> Runs;
 class IndexVec
 {
+	friend class IndexVecBuilder;
 public:
 							IndexVec(void);
 							IndexVec(
@@ -175,14 +191,140 @@ public:
 								const IndexVec&		inIndexVec);
 	bool					IsEqual(
 								const IndexVec&		inIndexVec);
+	/*
+	*	Sets outIndexVec to the indexes contained in at least inMinCount of
+	*	the inCount vecs, merging all of the offset arrays in one pass.
+	*	UnionOf is a minimum of 1, SectOf is a minimum of inCount.
+	*	outIndexVec may be one of the vecs.
+	*/
+	static void				Merge(
+								const IndexVec* const*	inIndexVecs,
+								size_t					inCount,
+								size_t					inMinCount,
+								IndexVec&				outIndexVec);
+	static void				UnionOf(
+								const IndexVec* const*	inIndexVecs,
+								size_t					inCount,
+								IndexVec&				outIndexVec)
+								{Merge(inIndexVecs, inCount, 1, outIndexVec);}
+	static void				SectOf(
+								const IndexVec* const*	inIndexVecs,
+								size_t					inCount,
+								IndexVec&				outIndexVec)
+								{Merge(inIndexVecs, inCount, inCount, outIndexVec);}
 	
 	bool					SetFromSerial(
 								const std::string&	inSerializedIndexVec);
 	const std::string&		Serialize(
 								std::string&		outSerializedIndexVec) const;
+	/*
+	*	Replaces the runs with those of the binary form at inData.  inData
+	*	needn't be aligned, so it can point into a memory mapped file.
+	*	Returns false, leaving the vec empty, if inLength is too short or the
+	*	checksum doesn't match.  outLength, when not NULL, is set to the
+	*	length of the binary form (it may be followed by other data.)
+	*/
+	bool					SetFromBinary(
+								const void*			inData,
+								size_t				inLength,
+								size_t*				outLength = NULL);
+	/*
+	*	Appends the binary form to outBinary.
+	*/
+	const std::string&		SerializeBinary(
+								std::string&		outBinary) const;
 protected:
 	uint8_t	mFirstRunValue;
 	Runs	mRuns;
+	/*
+	*	mRankCounts[j] is the number of indexes before the jth run of 1s.
+	*	The last entry is the count.
+	*/
+	mutable std::vector<size_t>	mRankCounts;
+	mutable std::atomic<bool>	mRankCountsValid;
+	mutable std::mutex	mRankCountsMutex;
+
+	inline void				PrepareRankCounts(void) const
+								{if (!mRankCountsValid.load(std::memory_order_acquire)) BuildRankCounts();}
+	void					BuildRankCounts(void) const;
+	inline void				InvalidateRankCounts(void)
+								{mRankCountsValid.store(false, std::memory_order_relaxed);}
+	inline size_t			FirstPositiveRun(void) const
+								{return(mFirstRunValue ? 0 : 1);}
+
+	/*
+	*	The truth tables of Merge.  Bit ((a << 1) | b) is the value of an
+	*	index given its value a in inA and b in inB.
+	*/
+	enum EMergeOp
+	{
+		eMergeDiff	= 0x4,	// a & !b
+		eMergeSect	= 0x8,	// a & b
+		eMergeUnion	= 0xE	// a | b
+	};
+	/*
+	*	Replaces the runs with inA combined with inB.  Either may be this vec.
+	*/
+	void					Merge(
+								const IndexVec&		inA,
+								const IndexVec&		inB,
+								uint8_t				inTruthTable);
+};
+
+/*
+*	Builds an IndexVec from indexes or ranges.  When they're added in
+*	ascending order (overlapping and adjacent ranges are fine) each one is
+*	appended to, or extends, the last run in O(1), and Build hands the runs
+*	to the vec without copying them.  Ranges added out of order are sorted
+*	and coalesced by Build.
+*/
+class IndexVecBuilder
+{
+public:
+							IndexVecBuilder(void);
+							~IndexVecBuilder(void){}
+	void					Reserve(
+								size_t					inNumRuns)
+								{mRuns.reserve((inNumRuns * 2) + 1);}
+	void					Add(
+								uint32_t				inIndex)
+								{AddRun(inIndex, inIndex + 1);}
+	/*
+	*	Same as IndexVec::Set, the range inFrom:inTo is inclusive.
+	*/
+	void					Add(
+								uint32_t				inFrom,
+								uint32_t				inTo)
+								{AddRun(inFrom, inTo + 1);}
+	/*
+	*	Same as IndexVec::SetRun with a value of 1, inEnd is exclusive.
+	*/
+	void					AddRun(
+								uint32_t				inStart,
+								uint32_t				inEnd);
+	/*
+	*	Replaces the content of outIndexVec with the indexes added, then
+	*	clears the builder.  Returns the number of indexes added more than
+	*	once.
+	*/
+	size_t					Build(
+								IndexVec&				outIndexVec);
+	void					Clear(void);
+	/*
+	*	Sets outIndexVec to the indexes of ioIndexes, which may be unsorted
+	*	and contain duplicates.  Large inputs are split between threads,
+	*	each sorting and coalescing its part (reordering ioIndexes), and the
+	*	parts are then combined by IndexVec::UnionOf.
+	*/
+	static void				BuildFromUnsorted(
+								std::vector<uint32_t>&	ioIndexes,
+								IndexVec&				outIndexVec);
+protected:
+	Runs		mRuns;			// The IndexVec layout, followed by start/end
+								// pairs once a range is added out of order.
+	uint8_t		mFirstRunValue;
+	bool		mIsSorted;
+	size_t		mNumDuplicates;
 };
 
 class IndexVecIterator
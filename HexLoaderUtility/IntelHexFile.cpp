@@ -0,0 +1,523 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  IntelHexFile.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+#include "IntelHexFile.h"
+#include "FlashImage.h"
+#include <stdio.h>
+#include <string.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/*
+*	kHexPairTable maps a byte to its two uppercase hex digits.  It's used
+*	for whatever isn't handled by the 16 byte vector loop in BytesToHex.
+*/
+struct SHexPairTable
+{
+	char	pair[512];
+};
+
+static constexpr SHexPairTable MakeHexPairTable(void)
+{
+	SHexPairTable	table = {};
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t	hiNibble = i >> 4;
+		uint32_t	loNibble = i & 0xF;
+		table.pair[i*2] = (char)(hiNibble < 10 ? ('0' + hiNibble) : ('A' + hiNibble - 10));
+		table.pair[i*2+1] = (char)(loNibble < 10 ? ('0' + loNibble) : ('A' + loNibble - 10));
+	}
+	return(table);
+}
+
+static constexpr SHexPairTable	kHexPairTable = MakeHexPairTable();
+
+/********************************* BytesToHex *********************************/
+/*
+*	Blocks of 16 bytes are converted using a vector nibble lookup (SSSE3
+*	pshufb or NEON tbl.)  The byte sum used for the record checksum is
+*	accumulated in the same pass.
+*/
+uint32_t IntelHexFile::BytesToHex(
+	const uint8_t*	inData,
+	uint32_t		inLength,
+	char*			outHexChars)
+{
+	uint32_t	sum = 0;
+	const uint8_t*	dataEnd = &inData[inLength];
+#if defined(__SSSE3__)
+	const __m128i	kHexDigits = _mm_setr_epi8('0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F');
+	const __m128i	kNibbleMask = _mm_set1_epi8(0x0F);
+	__m128i	sumVec = _mm_setzero_si128();
+	for (; (dataEnd - inData) >= 16; inData += 16, outHexChars += 32)
+	{
+		__m128i	bytes = _mm_loadu_si128((const __m128i*)inData);
+		__m128i	hiDigits = _mm_shuffle_epi8(kHexDigits, _mm_and_si128(_mm_srli_epi16(bytes, 4), kNibbleMask));
+		__m128i	loDigits = _mm_shuffle_epi8(kHexDigits, _mm_and_si128(bytes, kNibbleMask));
+		_mm_storeu_si128((__m128i*)outHexChars, _mm_unpacklo_epi8(hiDigits, loDigits));
+		_mm_storeu_si128((__m128i*)&outHexChars[16], _mm_unpackhi_epi8(hiDigits, loDigits));
+		sumVec = _mm_add_epi64(sumVec, _mm_sad_epu8(bytes, _mm_setzero_si128()));
+	}
+	sum = (uint32_t)(_mm_cvtsi128_si32(sumVec) + _mm_cvtsi128_si32(_mm_srli_si128(sumVec, 8)));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	static const uint8_t	kHexDigitChars[16] = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'};
+	const uint8x16_t	hexDigits = vld1q_u8(kHexDigitChars);
+	const uint8x16_t	nibbleMask = vdupq_n_u8(0x0F);
+	for (; (dataEnd - inData) >= 16; inData += 16, outHexChars += 32)
+	{
+		uint8x16_t	bytes = vld1q_u8(inData);
+		uint8x16x2_t	digits;
+		digits.val[0] = vqtbl1q_u8(hexDigits, vshrq_n_u8(bytes, 4));
+		digits.val[1] = vqtbl1q_u8(hexDigits, vandq_u8(bytes, nibbleMask));
+		vst2q_u8((uint8_t*)outHexChars, digits);	// Interleaves hi, lo
+		sum += vaddlvq_u8(bytes);
+	}
+#endif
+	for (; inData < dataEnd; inData++, outHexChars += 2)
+	{
+		outHexChars[0] = kHexPairTable.pair[*inData*2];
+		outHexChars[1] = kHexPairTable.pair[*inData*2+1];
+		sum += *inData;
+	}
+	return(sum);
+}
+
+/******************************** AppendRecord ********************************/
+/*
+*	Writes the record to outRecord and returns the address following the
+*	record.  outRecord must have room for 13 + 2*inLength characters.
+*/
+char* IntelHexFile::AppendRecord(
+	uint8_t			inRecordType,
+	uint16_t		inAddress,
+	const uint8_t*	inData,
+	uint32_t		inLength,
+	char*			outRecord)
+{
+	uint8_t	header[4] = {(uint8_t)inLength, (uint8_t)(inAddress >> 8), (uint8_t)inAddress, inRecordType};
+	*(outRecord++) = ':';
+	uint32_t	sum = BytesToHex(header, 4, outRecord);
+	outRecord += 8;
+	sum += BytesToHex(inData, inLength, outRecord);
+	outRecord += inLength*2;
+	uint8_t	checksum = (uint8_t)(0x100 - (sum & 0xFF));
+	BytesToHex(&checksum, 1, outRecord);
+	outRecord += 2;
+	*(outRecord++) = '\r';
+	*(outRecord++) = '\n';
+	return(outRecord);
+}
+
+/******************************* MaxEncodedSize *******************************/
+/*
+*	The worst case size: every 64KB boundary crossed adds an extended linear
+*	address record and splits a data record.
+*/
+size_t IntelHexFile::MaxEncodedSize(
+	uint32_t	inLength,
+	uint32_t	inBytesPerRecord)
+{
+	size_t	numSegments = (inLength >> 16) + 2;
+	return(((inLength / inBytesPerRecord) + numSegments) * (13 + (inBytesPerRecord * 2)) +
+				(numSegments * (13 + 4)));
+}
+
+/********************************* EncodeRun **********************************/
+/*
+*	Writes the records for a contiguous run of data to outRecords and returns
+*	the address following the last record.  ioCurrentUpper is the upper 16
+*	bits of the address currently in effect, 0xFFFFFFFF if unknown.
+*/
+char* IntelHexFile::EncodeRun(
+	const uint8_t*	inData,
+	uint32_t		inLength,
+	uint32_t		inStartAddress,
+	uint32_t		inBytesPerRecord,
+	uint32_t&		ioCurrentUpper,
+	char*			outRecords)
+{
+	uint32_t	address = inStartAddress;
+	const uint8_t*	dataEnd = &inData[inLength];
+	while (inData < dataEnd)
+	{
+		uint32_t	upper = address >> 16;
+		if (upper != ioCurrentUpper)
+		{
+			uint8_t	upperBytes[2] = {(uint8_t)(upper >> 8), (uint8_t)upper};
+			outRecords = AppendRecord(eExtLinearAddrRecord, 0, upperBytes, 2, outRecords);
+			ioCurrentUpper = upper;
+		}
+		uint32_t	recordLength = inBytesPerRecord;
+		if (recordLength > (uint32_t)(dataEnd - inData))
+		{
+			recordLength = (uint32_t)(dataEnd - inData);
+		}
+		// Don't cross a 64KB boundary
+		if (recordLength > (0x10000 - (address & 0xFFFF)))
+		{
+			recordLength = 0x10000 - (address & 0xFFFF);
+		}
+		outRecords = AppendRecord(eDataRecord, (uint16_t)address, inData, recordLength, outRecords);
+		inData += recordLength;
+		address += recordLength;
+	}
+	return(outRecords);
+}
+
+/*********************************** Encode ***********************************/
+void IntelHexFile::Encode(
+	const uint8_t*	inData,
+	uint32_t		inLength,
+	uint32_t		inStartAddress,
+	std::string&	ioHexText,
+	uint32_t		inBytesPerRecord)
+{
+	if (inBytesPerRecord == 0 ||
+		inBytesPerRecord > 255)
+	{
+		inBytesPerRecord = 16;
+	}
+	size_t	startSize = ioHexText.size();
+	ioHexText.resize(startSize + MaxEncodedSize(inLength, inBytesPerRecord));
+	/*
+	*	The address is assumed to have an upper 16 bits of 0 only when
+	*	this is the start of the text.
+	*/
+	uint32_t	currentUpper = startSize ? 0xFFFFFFFF : 0;
+	char*	recordPtr = EncodeRun(inData, inLength, inStartAddress, inBytesPerRecord, currentUpper, &ioHexText[startSize]);
+	ioHexText.resize(recordPtr - ioHexText.data());
+}
+
+/*********************************** Encode ***********************************/
+void IntelHexFile::Encode(
+	const FlashImage&	inImage,
+	std::string&		ioHexText,
+	uint32_t			inBytesPerRecord)
+{
+	if (inBytesPerRecord == 0 ||
+		inBytesPerRecord > 255)
+	{
+		inBytesPerRecord = 16;
+	}
+	const IndexVec&	occupied = inImage.GetOccupied();
+	const Runs&	runs = occupied.GetRuns();
+	size_t	startSize = ioHexText.size();
+	size_t	maxSize = 0;
+	size_t	runIndex = occupied.GetFirstRunValue() ? 0 : 1;
+	for (size_t i = runIndex; (i + 1) < runs.size(); i += 2)
+	{
+		maxSize += MaxEncodedSize(runs[i+1] - runs[i], inBytesPerRecord);
+	}
+	ioHexText.resize(startSize + maxSize);
+	char*	recordPtr = &ioHexText[startSize];
+	uint32_t	currentUpper = startSize ? 0xFFFFFFFF : 0;
+	std::vector<uint8_t>	runData;
+	for (; (runIndex + 1) < runs.size(); runIndex += 2)
+	{
+		uint32_t	runLength = runs[runIndex+1] - runs[runIndex];
+		runData.resize(runLength);
+		inImage.Read(runs[runIndex], runData.data(), runLength);
+		recordPtr = EncodeRun(runData.data(), runLength, runs[runIndex], inBytesPerRecord, currentUpper, recordPtr);
+	}
+	ioHexText.resize(recordPtr - ioHexText.data());
+}
+
+/******************************* AppendEOFRecord ******************************/
+void IntelHexFile::AppendEOFRecord(
+	std::string&	ioHexText)
+{
+	ioHexText.append(":00000001FF\r\n");
+}
+
+/********************************* WriteFile **********************************/
+bool IntelHexFile::WriteFile(
+	const char*			inPath,
+	const std::string&	inHexText)
+{
+	bool success = false;
+	FILE*    file = fopen(inPath, "wb");
+	if (file)
+	{
+		success = fwrite(inHexText.data(), 1, inHexText.size(), file) == inHexText.size();
+		fclose(file);
+	}
+	return(success);
+}
+
+/********************************* HexToBytes *********************************/
+/*
+*	Blocks of 16 hex digits are converted and validated using SSSE3 or
+*	AArch64 NEON.  A digit's value is its offset from '0' when that is less
+*	than 10, else its offset (lowercased) from 'a' + 10 when that is less
+*	than 6.  Anything else is invalid.
+*/
+uint32_t IntelHexFile::HexToBytes(
+	const char*	inHexChars,
+	uint32_t	inLength,
+	uint8_t*	outData,
+	bool&		outValid)
+{
+	uint32_t	sum = 0;
+	bool		valid = true;
+	const uint8_t*	hexChars = (const uint8_t*)inHexChars;
+	const uint8_t*	dataEnd = &outData[inLength];
+#if defined(__SSSE3__)
+	const __m128i	kZeroChar = _mm_set1_epi8('0');
+	const __m128i	kLowerA = _mm_set1_epi8('a');
+	const __m128i	kCaseBit = _mm_set1_epi8(0x20);
+	const __m128i	kNine = _mm_set1_epi8(9);
+	const __m128i	kFive = _mm_set1_epi8(5);
+	const __m128i	kTen = _mm_set1_epi8(10);
+	const __m128i	kNibbleWeights = _mm_set1_epi16(0x0110);	// hi digit * 16 + lo digit * 1
+	__m128i	sumVec = _mm_setzero_si128();
+	__m128i	invalidVec = _mm_setzero_si128();
+	for (; (dataEnd - outData) >= 8; hexChars += 16, outData += 8)
+	{
+		__m128i	chars = _mm_loadu_si128((const __m128i*)hexChars);
+		__m128i	digitValue = _mm_sub_epi8(chars, kZeroChar);
+		__m128i	alphaValue = _mm_sub_epi8(_mm_or_si128(chars, kCaseBit), kLowerA);
+		// Unsigned x <= n is min(x, n) == x
+		__m128i	isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digitValue, kNine), digitValue);
+		__m128i	isAlpha = _mm_cmpeq_epi8(_mm_min_epu8(alphaValue, kFive), alphaValue);
+		invalidVec = _mm_or_si128(invalidVec, _mm_andnot_si128(_mm_or_si128(isDigit, isAlpha), _mm_set1_epi8(-1)));
+		__m128i	nibbles = _mm_or_si128(_mm_and_si128(isDigit, digitValue),
+								_mm_andnot_si128(isDigit, _mm_add_epi8(alphaValue, kTen)));
+		__m128i	bytes = _mm_packus_epi16(_mm_maddubs_epi16(nibbles, kNibbleWeights), _mm_setzero_si128());
+		_mm_storel_epi64((__m128i*)outData, bytes);
+		sumVec = _mm_add_epi64(sumVec, _mm_sad_epu8(bytes, _mm_setzero_si128()));
+	}
+	sum = (uint32_t)_mm_cvtsi128_si32(sumVec);
+	valid = _mm_movemask_epi8(invalidVec) == 0;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	const uint8x16_t	zeroChar = vdupq_n_u8('0');
+	const uint8x16_t	lowerA = vdupq_n_u8('a');
+	const uint8x16_t	caseBit = vdupq_n_u8(0x20);
+	uint8x16_t	invalidVec = vdupq_n_u8(0);
+	for (; (dataEnd - outData) >= 8; hexChars += 16, outData += 8)
+	{
+		uint8x16_t	chars = vld1q_u8(hexChars);
+		uint8x16_t	digitValue = vsubq_u8(chars, zeroChar);
+		uint8x16_t	alphaValue = vsubq_u8(vorrq_u8(chars, caseBit), lowerA);
+		uint8x16_t	isDigit = vcleq_u8(digitValue, vdupq_n_u8(9));
+		uint8x16_t	isAlpha = vcleq_u8(alphaValue, vdupq_n_u8(5));
+		invalidVec = vorrq_u8(invalidVec, vmvnq_u8(vorrq_u8(isDigit, isAlpha)));
+		uint8x16_t	nibbles = vbslq_u8(isDigit, digitValue, vaddq_u8(alphaValue, vdupq_n_u8(10)));
+		// Each 16 bit lane holds the hi digit in its low byte, the lo digit in its high byte.
+		uint16x8_t	pairs = vreinterpretq_u16_u8(nibbles);
+		uint8x8_t	bytes = vmovn_u16(vorrq_u16(vshlq_n_u16(pairs, 4), vshrq_n_u16(pairs, 8)));
+		vst1_u8(outData, bytes);
+		sum += vaddlv_u8(bytes);
+	}
+	valid = vmaxvq_u8(invalidVec) == 0;
+#endif
+	for (; outData < dataEnd; hexChars += 2, outData++)
+	{
+		uint8_t	byte = 0;
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			uint8_t	thisChar = hexChars[i];
+			uint8_t	nibble;
+			if ((uint8_t)(thisChar - '0') <= 9)
+			{
+				nibble = thisChar - '0';
+			} else if ((uint8_t)((thisChar | 0x20) - 'a') <= 5)
+			{
+				nibble = (thisChar | 0x20) - 'a' + 10;
+			} else
+			{
+				nibble = 0;
+				valid = false;
+			}
+			byte = (byte << 4) | nibble;
+		}
+		*outData = byte;
+		sum += byte;
+	}
+	outValid = valid;
+	return(sum);
+}
+
+/******************************** DecodeRecords *******************************/
+/*
+*	Decodes the complete records between ioHexText and inHexTextEnd.  When
+*	a record is incomplete (the rest of it is in the next block of text),
+*	ioHexText is left pointing at the start of the record and
+*	eRecordIncomplete is returned, unless inAtEndOfText is true.
+*/
+uint8_t IntelHexFile::DecodeRecords(
+	const char*&	ioHexText,
+	const char*		inHexTextEnd,
+	bool			inAtEndOfText,
+	SDecodeState&	ioState,
+	FlashImage&		outImage)
+{
+	uint8_t	result = eRecordIncomplete;
+	const char*	hexText = ioHexText;
+	uint8_t	record[5 + 255];
+	while (true)
+	{
+		// Skip the line ending(s) and any other whitespace
+		for (; hexText < inHexTextEnd && (uint8_t)*hexText <= ' '; hexText++)
+		{
+			if (*hexText == '\n')
+			{
+				ioState.lineNumber++;
+			}
+		}
+		ioHexText = hexText;
+		if (hexText >= inHexTextEnd)
+		{
+			result = inAtEndOfText ? eRecordInvalid : eRecordIncomplete;	// No EOF record
+			break;
+		}
+		if (*hexText != ':')
+		{
+			result = eRecordInvalid;
+			break;
+		}
+		// The minimum record is :LLAAAATTCC
+		if ((inHexTextEnd - hexText) < 11)
+		{
+			result = inAtEndOfText ? eRecordInvalid : eRecordIncomplete;
+			break;
+		}
+		bool	valid;
+		HexToBytes(&hexText[1], 1, record, valid);
+		uint32_t	recordLength = 5 + record[0];
+		if (!valid)
+		{
+			result = eRecordInvalid;
+			break;
+		}
+		if ((size_t)(inHexTextEnd - hexText) < (1 + (recordLength * 2)))
+		{
+			result = inAtEndOfText ? eRecordInvalid : eRecordIncomplete;
+			break;
+		}
+		uint32_t	sum = HexToBytes(&hexText[1], recordLength, record, valid);
+		if (!valid ||
+			(sum & 0xFF) != 0)
+		{
+			result = eRecordInvalid;
+			break;
+		}
+		hexText += 1 + (recordLength * 2);
+		uint32_t	dataLength = record[0];
+		const uint8_t*	data = &record[4];
+		switch (record[3])
+		{
+			case eDataRecord:
+				if (!outImage.Write(ioState.baseAddress + (((uint32_t)record[1] << 8) | record[2]), data, dataLength))
+				{
+					return(eRecordInvalid);	// Extends past 0xFFFFFFFF
+				}
+				break;
+			case eEOFRecord:
+				ioHexText = hexText;
+				return(eEOFDecoded);
+			case eExtSegmentAddrRecord:
+				if (dataLength != 2)
+				{
+					return(eRecordInvalid);
+				}
+				ioState.baseAddress = (((uint32_t)data[0] << 8) | data[1]) << 4;
+				break;
+			case eExtLinearAddrRecord:
+				if (dataLength != 2)
+				{
+					return(eRecordInvalid);
+				}
+				ioState.baseAddress = (((uint32_t)data[0] << 8) | data[1]) << 16;
+				break;
+			case eStartSegmentAddrRecord:
+			case eStartLinearAddrRecord:
+				break;	// The start address doesn't apply to a flash image
+			default:
+				return(eRecordInvalid);
+		}
+		result = eRecordDecoded;
+	}
+	return(result);
+}
+
+/*********************************** Decode ***********************************/
+bool IntelHexFile::Decode(
+	const char*	inHexText,
+	size_t		inLength,
+	FlashImage&	outImage,
+	uint32_t*	outErrorLine)
+{
+	SDecodeState	state = {0, 1};
+	uint8_t	result = DecodeRecords(inHexText, &inHexText[inLength], true, state, outImage);
+	if (result != eEOFDecoded &&
+		outErrorLine)
+	{
+		*outErrorLine = state.lineNumber;
+	}
+	return(result == eEOFDecoded);
+}
+
+/********************************** ReadFile **********************************/
+bool IntelHexFile::ReadFile(
+	const char*	inPath,
+	FlashImage&	outImage,
+	uint32_t*	outErrorLine)
+{
+	uint8_t	result = eRecordInvalid;
+	SDecodeState	state = {0, 1};
+	FILE*    file = fopen(inPath, "rb");
+	if (file)
+	{
+		const size_t	kBlockSize = 0x10000;
+		std::vector<char>	block(kBlockSize);
+		size_t	carryLength = 0;
+		while (true)
+		{
+			size_t	bytesRead = fread(&block[carryLength], 1, kBlockSize - carryLength, file);
+			bool	atEndOfText = bytesRead < (kBlockSize - carryLength);
+			const char*	hexText = block.data();
+			const char*	hexTextEnd = &block[carryLength + bytesRead];
+			result = DecodeRecords(hexText, hexTextEnd, atEndOfText, state, outImage);
+			if (result != eRecordIncomplete)
+			{
+				break;
+			}
+			// Move the incomplete record to the start of the block.
+			carryLength = hexTextEnd - hexText;
+			memmove(block.data(), hexText, carryLength);
+		}
+		fclose(file);
+	}
+	if (result != eEOFDecoded &&
+		outErrorLine)
+	{
+		*outErrorLine = state.lineNumber;
+	}
+	return(result == eEOFDecoded);
+}
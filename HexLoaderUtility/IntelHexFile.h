@@ -0,0 +1,161 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  IntelHexFile.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+/*
+*	Intel HEX encoding and decoding.
+*
+*	Records are written with 16 data bytes (the same as avr-objcopy) and
+*	CRLF line endings.  Data records never cross a 64KB boundary.  An
+*	extended linear address record (type 04) is written whenever the upper
+*	16 bits of the address change, so images for parts with more than 64KB
+*	of flash are addressed correctly.
+*
+*	Decoding validates every record (hex digits, length and checksum) and
+*	writes the data to a FlashImage.  Both extended segment (type 02) and
+*	extended linear (type 04) address records are supported.
+*/
+#ifndef IntelHexFile_h
+#define IntelHexFile_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class FlashImage;
+
+class IntelHexFile
+{
+public:
+	enum ERecordType
+	{
+		eDataRecord,
+		eEOFRecord,
+		eExtSegmentAddrRecord,
+		eStartSegmentAddrRecord,
+		eExtLinearAddrRecord,
+		eStartLinearAddrRecord
+	};
+	/*
+	*	Appends the records for inLength bytes of inData starting at
+	*	inStartAddress to ioHexText.  AppendEOFRecord must be called after the
+	*	last data has been encoded.
+	*/
+	static void				Encode(
+								const uint8_t*			inData,
+								uint32_t				inLength,
+								uint32_t				inStartAddress,
+								std::string&			ioHexText,
+								uint32_t				inBytesPerRecord = 16);
+	/*
+	*	Appends the records for the occupied ranges of inImage.
+	*/
+	static void				Encode(
+								const FlashImage&		inImage,
+								std::string&			ioHexText,
+								uint32_t				inBytesPerRecord = 16);
+	static void				AppendEOFRecord(
+								std::string&			ioHexText);
+	static bool				WriteFile(
+								const char*				inPath,
+								const std::string&		inHexText);
+	/*
+	*	Decodes the records in inHexText to outImage.  Decoding stops at the
+	*	EOF record.  Returns false if any record is invalid, in which case
+	*	outErrorLine (when not NULL) is set to the 1 based line number of
+	*	the invalid record.
+	*/
+	static bool				Decode(
+								const char*				inHexText,
+								size_t					inLength,
+								FlashImage&				outImage,
+								uint32_t*				outErrorLine = NULL);
+	/*
+	*	Reads and decodes the file in fixed size blocks.  Only one block of
+	*	text is in memory at a time.
+	*/
+	static bool				ReadFile(
+								const char*				inPath,
+								FlashImage&				outImage,
+								uint32_t*				outErrorLine = NULL);
+	/*
+	*	Converts inLength hex digit pairs to bytes.  Returns the sum of the
+	*	bytes.  outValid is set to false if any character isn't a hex digit.
+	*/
+	static uint32_t			HexToBytes(
+								const char*				inHexChars,
+								uint32_t				inLength,
+								uint8_t*				outData,
+								bool&					outValid);
+	/*
+	*	Writes a single record to outRecord and returns the address following
+	*	the record's line ending.  A record is 13 + (2 * inLength) characters.
+	*/
+	static char*			AppendRecord(
+								uint8_t					inRecordType,
+								uint16_t				inAddress,
+								const uint8_t*			inData,
+								uint32_t				inLength,
+								char*					outRecord);
+	/*
+	*	Writes inLength bytes as 2 * inLength uppercase hex digits to
+	*	outHexChars and returns the sum of the bytes (for the checksum.)
+	*/
+	static uint32_t			BytesToHex(
+								const uint8_t*			inData,
+								uint32_t				inLength,
+								char*					outHexChars);
+protected:
+	enum EDecodeResult
+	{
+		eRecordDecoded,
+		eEOFDecoded,
+		eRecordIncomplete,
+		eRecordInvalid
+	};
+	struct SDecodeState
+	{
+		uint32_t	baseAddress;
+		uint32_t	lineNumber;
+	};
+	static char*			EncodeRun(
+								const uint8_t*			inData,
+								uint32_t				inLength,
+								uint32_t				inStartAddress,
+								uint32_t				inBytesPerRecord,
+								uint32_t&				ioCurrentUpper,
+								char*					outRecords);
+	static size_t			MaxEncodedSize(
+								uint32_t				inLength,
+								uint32_t				inBytesPerRecord);
+	static uint8_t			DecodeRecords(
+								const char*&			ioHexText,
+								const char*				inHexTextEnd,
+								bool					inAtEndOfText,
+								SDecodeState&			ioState,
+								FlashImage&				outImage);
+};
+
+#endif /* IntelHexFile_h */
@@ -39,10 +39,18 @@
 */
 #import "MainWindowController.h"
 #include "AVRElfFile.h"
+#include "ElfFileCache.h"
+#include "Fingerprint.h"
+#include "SizeProfile.h"
+#include "SymbolExportRules.h"
 #include "ConfigurationFile.h"
 #include "AvrdudeConfigFile.h"
 #include "FileInputBuffer.h"
 #include "JSONElement.h"
+#include "IntelHexFile.h"
+#include "FlashImage.h"
+#include "AVRDisassembler.h"
+#include "AVRCycleAnalyzer.h"
 
 // Defining AVR_OBJ_DUMP will run avr-objdump for all elf files.
 // Saved as xxxM.ino.elf.txt, where xxx is the sketch name.
@@ -67,6 +75,8 @@ NSString *const kExportFolderPathKey = @"exportFolderPath";
 #endif
 NSString *const kArduinoBundleIdentifier = @"cc.arduino.Arduino";
 NSString *const kSelectPrompt = @"Select";
+NSString *const kExportManifestName = @"fingerprints.txt";	// See readExportManifest
+NSString *const kSymbolExportRulesName = @"exportrules.txt";	// See readSymbolExportRules
 extern NSUInteger const kNumTableColumns;
 extern NSString *const kNameKey;
 extern NSString *const kLengthKey;
@@ -100,6 +110,7 @@ SMenuItemDesc	menuItems[] = {
 
 BoardsConfigFiles* _configFiles;
 AvrdudeConfigFiles* _avrdudeConfigFiles;
+ElfFileCache* _elfFileCache;
 
 - (void)windowDidLoad
 {
@@ -107,6 +118,7 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
     
 	_configFiles = new BoardsConfigFiles;
 	_avrdudeConfigFiles = new AvrdudeConfigFiles;
+	_elfFileCache = new ElfFileCache;
 	{
 		const SMenuItemDesc*	miDesc = menuItems;
 		const SMenuItemDesc*	miDescEnd = &menuItems[sizeof(menuItems)/sizeof(SMenuItemDesc)];
@@ -198,6 +210,7 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 {
     delete _configFiles;
     delete _avrdudeConfigFiles;
+    delete _elfFileCache;
 }
 
 /************************** checkForTempFolderChanges *************************/
@@ -663,29 +676,90 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 		__block NSMutableArray<NSMutableDictionary*>*	sketches = _hexLoaderTableViewController.sketches;
 		if (selectedRows.count)
 		{
+			NSURL*	manifestURL = [_exportFolderURL URLByAppendingPathComponent:kExportManifestName];
+			NSMutableDictionary<NSString*, NSString*>*	manifest = [MainWindowController readExportManifest:manifestURL];
+			__block BOOL	manifestChanged = NO;
+			SymbolExportRules	exportRules;
+			[self readSymbolExportRules:exportRules];
 			[selectedRows enumerateIndexesUsingBlock:^(NSUInteger inIndex, BOOL *outStop)
 			{
 				NSMutableDictionary* sketchRec = [sketches objectAtIndex:inIndex];
 				std::string	configText;
-				[self configTextForSketch:sketchRec configText:configText];
+				[self configTextForSketch:sketchRec exportRules:exportRules configText:configText];
 				NSString*	configTextS = [NSString stringWithUTF8String:configText.c_str()];
 				
 				NSURL*	sourceHexFileURL = [((NSURL*)sketchRec[kTempURLKey]) URLByAppendingPathComponent:[sketchRec[kNameKey] stringByAppendingPathExtension:@"hex"]];
 				NSURL*	configFileURL = [_exportFolderURL URLByAppendingPathComponent:[sketchRec[kNameKey] stringByAppendingPathExtension:@"txt"]];
 				NSURL*	destFileURL = [_exportFolderURL URLByAppendingPathComponent:[sketchRec[kNameKey] stringByAppendingPathExtension:@"hex"]];
+				/*
+				*	The fingerprint covers the flash and EEPROM images and the
+				*	config text.  If it matches the fingerprint recorded by the
+				*	last export AND every file the export writes still exists
+				*	THEN there's nothing to export.
+				*/
+				NSString*	fingerprint = nil;
+				{
+					AVRElfFilePtr	elfFile = _elfFileCache->GetElfFile([MainWindowController elfPathFor:sketchRec forKey:kTempURLKey]);
+					if (elfFile)
+					{
+						std::string	fingerprintStr;
+						Fingerprint::ToString(Fingerprint::Hash(configText, elfFile->GetImageFingerprint()), fingerprintStr);
+						fingerprint = [NSString stringWithUTF8String:fingerprintStr.c_str()];
+					}
+				}
+				if (fingerprint &&
+					[fingerprint isEqualToString:manifest[sketchRec[kNameKey]]] &&
+					[self exportedFilesExistForSketch:sketchRec])
+				{
+					[_hexLoaderLogViewController postInfoString: [NSString stringWithFormat:@"%@ is unchanged since the last export.", sketchRec[kNameKey]]];
+					return;
+				}
+				/*
+				*	Keep the previously exported flash image, if any, so that
+				*	the pages that changed can be determined.  If there isn't
+				*	one previousImage is left empty.
+				*/
+				FlashImage	previousImage;
+				IntelHexFile::ReadFile(destFileURL.path.UTF8String, previousImage);
 				[[NSFileManager defaultManager] removeItemAtURL:configFileURL error:nil];
 				[[NSFileManager defaultManager] removeItemAtURL:destFileURL error:nil];
+				/*
+				*	If the IDE didn't leave a .hex file THEN
+				*	generate it from the elf file.
+				*/
+				BOOL	hexFromElf = ![[NSFileManager defaultManager] fileExistsAtPath:sourceHexFileURL.path];
 				BOOL success = [configTextS writeToURL:configFileURL atomically:NO encoding:NSUTF8StringEncoding error:nil] &&
-							[[NSFileManager defaultManager] copyItemAtURL:sourceHexFileURL toURL:destFileURL error:nil];
+							(hexFromElf ? [self writeHexForSketch:sketchRec toURL:destFileURL] :
+								[[NSFileManager defaultManager] copyItemAtURL:sourceHexFileURL toURL:destFileURL error:nil]);
 				if (success)
 				{
-					[_hexLoaderLogViewController postInfoString: [NSString stringWithFormat:@"%@.hex has been copied to the Export folder.", sketchRec[kNameKey]]];
+					[_hexLoaderLogViewController postInfoString: [NSString stringWithFormat:
+						hexFromElf ? @"%@.hex has been generated from the elf file in the Export folder." :
+							@"%@.hex has been copied to the Export folder.", sketchRec[kNameKey]]];
 					[_hexLoaderLogViewController postInfoString: [NSString stringWithFormat:@"%@.txt has been created in the Export folder.", sketchRec[kNameKey]]];
+					[self writeDirtyPagesForSketch:sketchRec previousImage:previousImage hexURL:destFileURL];
+					NSURL*	eepromFileURL = [_exportFolderURL URLByAppendingPathComponent:[sketchRec[kNameKey] stringByAppendingPathExtension:@"eep"]];
+					[[NSFileManager defaultManager] removeItemAtURL:eepromFileURL error:nil];
+					if ([self writeEEPROMHexForSketch:sketchRec toURL:eepromFileURL])
+					{
+						[_hexLoaderLogViewController postInfoString: [NSString stringWithFormat:@"%@.eep has been created in the Export folder.", sketchRec[kNameKey]]];
+					}
+					if (fingerprint)
+					{
+						manifest[sketchRec[kNameKey]] = fingerprint;
+						manifestChanged = YES;
+					}
+					[self recordSizeProfileForSketch:sketchRec];
 				} else
 				{
 					[_hexLoaderLogViewController postErrorString: [NSString stringWithFormat:@"Unable to export %@.", sketchRec[kNameKey]]];
 				}
 			}];
+			if (manifestChanged &&
+				![MainWindowController writeExportManifest:manifest toURL:manifestURL])
+			{
+				[_hexLoaderLogViewController postErrorString: [NSString stringWithFormat:@"Unable to update %@ in the Export folder.", kExportManifestName]];
+			}
 		} else
 		{
 			[_hexLoaderLogViewController postWarningString: @"No sketches selected."];
@@ -697,6 +771,263 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 	
 }
 
+/***************************** readExportManifest *****************************/
+/*
+*	The export manifest maps each exported sketch name to the fingerprint
+*	of its last export.  Each line is the fingerprint followed by a space
+*	and the sketch name.  Returns an empty dictionary if the manifest
+*	doesn't exist.
+*/
++ (NSMutableDictionary<NSString*, NSString*>*)readExportManifest:(NSURL*)inURL
+{
+	NSMutableDictionary<NSString*, NSString*>*	manifest = [NSMutableDictionary dictionary];
+	NSString*	manifestContents = [NSString stringWithContentsOfURL:inURL encoding:NSUTF8StringEncoding error:nil];
+	for (NSString* line in [manifestContents componentsSeparatedByString:@"\n"])
+	{
+		NSRange	separator = [line rangeOfString:@" "];
+		if (separator.location != NSNotFound)
+		{
+			manifest[[line substringFromIndex:separator.location + 1]] = [line substringToIndex:separator.location];
+		}
+	}
+	return(manifest);
+}
+
+/**************************** writeExportManifest *****************************/
++ (BOOL)writeExportManifest:(NSDictionary<NSString*, NSString*>*)inManifest toURL:(NSURL*)inURL
+{
+	NSMutableString*	manifestContents = [NSMutableString string];
+	for (NSString* name in [inManifest.allKeys sortedArrayUsingSelector:@selector(compare:)])
+	{
+		[manifestContents appendFormat:@"%@ %@\n", inManifest[name], name];
+	}
+	return([manifestContents writeToURL:inURL atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+}
+
+/************************* recordSizeProfileForSketch *************************/
+/*
+*	Adds the size profile of the sketch's current build to its history in
+*	profiles/<name>.json within the Export folder, then logs the symbols
+*	that changed the most since the previous build in the history.
+*/
+- (void)recordSizeProfileForSketch:(NSDictionary*)inSketchRec
+{
+	AVRElfFilePtr	elfFile = _elfFileCache->GetElfFile([MainWindowController elfPathFor:inSketchRec forKey:kTempURLKey]);
+	SizeProfile	profile;
+	if (elfFile &&
+		profile.Build(*elfFile))
+	{
+		NSURL*	profilesURL = [_exportFolderURL URLByAppendingPathComponent:@"profiles"];
+		if (![[NSFileManager defaultManager] fileExistsAtPath:profilesURL.path] &&
+			![[NSFileManager defaultManager] createDirectoryAtURL:profilesURL withIntermediateDirectories:NO attributes:nil error:nil])
+		{
+			[_hexLoaderLogViewController postErrorString: @"Unable to create the folder \"profiles\" within the Export folder"];
+			return;
+		}
+		NSURL*	historyURL = [profilesURL URLByAppendingPathComponent:[inSketchRec[kNameKey] stringByAppendingPathExtension:@"json"]];
+		NSISO8601DateFormatter*	dateFormatter = [[NSISO8601DateFormatter alloc] init];
+		profile.SetLabel([dateFormatter stringFromDate:[NSDate date]].UTF8String);
+		SizeProfileHistory	history;
+		history.ReadFile(historyURL.path.UTF8String);
+		if (!history.GetProfiles().empty())
+		{
+			const SizeProfile&	previousProfile = history.GetProfiles().back();
+			SymbolSizeDeltas	deltas;
+			profile.Diff(previousProfile, deltas, 10);
+			if (!deltas.empty())
+			{
+				NSMutableString*	deltasString = [NSMutableString stringWithFormat:@"%@ flash %+d, RAM %+d since %s:\n",
+					inSketchRec[kNameKey],
+					(int32_t)profile.GetFlashSize() - (int32_t)previousProfile.GetFlashSize(),
+					(int32_t)profile.GetRAMSize() - (int32_t)previousProfile.GetRAMSize(),
+					previousProfile.GetLabel().c_str()];
+				SymbolSizeDeltas::const_iterator	itr = deltas.begin();
+				SymbolSizeDeltas::const_iterator	itrEnd = deltas.end();
+				for (; itr != itrEnd; ++itr)
+				{
+					[deltasString appendFormat:@"%+8d %+8d  %s\n", itr->flashDelta, itr->ramDelta, itr->name.c_str()];
+				}
+				[[[_hexLoaderLogViewController
+					setColor:_hexLoaderLogViewController.blackColor]
+					appendUTF8String:deltasString.UTF8String] post];
+			}
+		}
+		history.AddProfile(profile);
+		if (!history.WriteFile(historyURL.path.UTF8String))
+		{
+			[_hexLoaderLogViewController postErrorString: [NSString stringWithFormat:@"Unable to update profiles/%@.json in the Export folder.", inSketchRec[kNameKey]]];
+		}
+	}
+}
+
+/***************************** writeHexForSketch ******************************/
+/*
+*	Generates the Intel HEX file from the sketch's elf file flash image.
+*/
+- (BOOL)writeHexForSketch:(NSDictionary*)inSketchRec toURL:(NSURL*)inURL
+{
+	BOOL	success = NO;
+	AVRElfFilePtr	elfFile = _elfFileCache->GetElfFile([MainWindowController elfPathFor:inSketchRec forKey:kTempURLKey]);
+	if (elfFile)
+	{
+		std::vector<uint8_t>	flashImage;
+		uint32_t	flashImageAddr;
+		if (elfFile->GetFlashImage(flashImage, flashImageAddr))
+		{
+			std::string	hexText;
+			IntelHexFile::Encode(flashImage.data(), (uint32_t)flashImage.size(), flashImageAddr, hexText);
+			IntelHexFile::AppendEOFRecord(hexText);
+			success = IntelHexFile::WriteFile(inURL.path.UTF8String, hexText);
+		}
+	}
+	return(success);
+}
+
+/************************** writeEEPROMHexForSketch ***************************/
+/*
+*	Generates the EEPROM Intel HEX file from the sketch's elf file .eeprom
+*	section.  Returns NO if the sketch has no initial EEPROM content.
+*/
+- (BOOL)writeEEPROMHexForSketch:(NSDictionary*)inSketchRec toURL:(NSURL*)inURL
+{
+	BOOL	success = NO;
+	AVRElfFilePtr	elfFile = _elfFileCache->GetElfFile([MainWindowController elfPathFor:inSketchRec forKey:kTempURLKey]);
+	if (elfFile)
+	{
+		std::vector<uint8_t>	eepromImage;
+		uint32_t	eepromImageAddr;
+		if (elfFile->GetEEPROMImage(eepromImage, eepromImageAddr))
+		{
+			std::string	hexText;
+			IntelHexFile::Encode(eepromImage.data(), (uint32_t)eepromImage.size(), eepromImageAddr, hexText);
+			IntelHexFile::AppendEOFRecord(hexText);
+			success = IntelHexFile::WriteFile(inURL.path.UTF8String, hexText);
+		}
+	}
+	return(success);
+}
+
+/************************** writeDirtyPagesForSketch **************************/
+/*
+*	Compares the exported hex file to the previously exported flash image
+*	using the device's flash page size.  The pages that changed are written
+*	to <name>.pages.hex so that only these pages need to be programmed.  The
+*	file is written even when no pages changed (it then has only the EOF
+*	record) so that every export leaves the same set of files.  When
+*	inPreviousImage is empty every programmed page is written.
+*/
+- (void)writeDirtyPagesForSketch:(NSDictionary*)inSketchRec previousImage:(const FlashImage&)inPreviousImage hexURL:(NSURL*)inHexURL
+{
+	NSURL*	pagesFileURL = [[inHexURL URLByDeletingPathExtension] URLByAppendingPathExtension:@"pages.hex"];
+	[[NSFileManager defaultManager] removeItemAtURL:pagesFileURL error:nil];
+	uint32_t	pageSize = [self deviceValueForKey:"flash.page_size" sketch:inSketchRec];
+	FlashImage	currentImage;
+	if (pageSize &&
+		IntelHexFile::ReadFile(inHexURL.path.UTF8String, currentImage))
+	{
+		IndexVec	dirtyPages;
+		currentImage.GetDirtyPages(inPreviousImage, pageSize, dirtyPages);
+		FlashImage	pagesImage;
+		currentImage.CopyPages(dirtyPages, pageSize, pagesImage);
+		std::string	hexText;
+		IntelHexFile::Encode(pagesImage, hexText);
+		IntelHexFile::AppendEOFRecord(hexText);
+		if (IntelHexFile::WriteFile(pagesFileURL.path.UTF8String, hexText))
+		{
+			if (inPreviousImage.Empty())
+			{
+				[_hexLoaderLogViewController postInfoString: [NSString stringWithFormat:
+					@"%@ has no previous export.  All %d programmed flash pages have been written to %@.",
+						inSketchRec[kNameKey], (uint32_t)dirtyPages.GetCount(), pagesFileURL.lastPathComponent]];
+			} else if (dirtyPages.Empty())
+			{
+				[_hexLoaderLogViewController postInfoString: [NSString stringWithFormat:@"%@ is unchanged from the previous export.", inSketchRec[kNameKey]]];
+			} else
+			{
+				uint32_t	totalPages = (uint32_t)((currentImage.GetOccupied().GetMax() + pageSize - 1) / pageSize);
+				[_hexLoaderLogViewController postInfoString: [NSString stringWithFormat:
+					@"%@ has %d of %d flash pages changed from the previous export.  The changed pages have been written to %@.",
+						inSketchRec[kNameKey], (uint32_t)dirtyPages.GetCount(), totalPages, pagesFileURL.lastPathComponent]];
+			}
+		}
+	}
+}
+
+/************************ exportedFilesExistForSketch *************************/
+/*
+*	Returns YES if every file that exportHex writes for the sketch exists in
+*	the Export folder.  <name>.eep is only expected when the elf file has
+*	initial EEPROM content, and <name>.pages.hex only when the device's
+*	flash page size is known.
+*/
+- (BOOL)exportedFilesExistForSketch:(NSDictionary*)inSketchRec
+{
+	NSString*	name = inSketchRec[kNameKey];
+	NSMutableArray<NSURL*>*	fileURLs = [NSMutableArray arrayWithObjects:
+		[_exportFolderURL URLByAppendingPathComponent:[name stringByAppendingPathExtension:@"hex"]],
+		[_exportFolderURL URLByAppendingPathComponent:[name stringByAppendingPathExtension:@"txt"]],
+		[[_exportFolderURL URLByAppendingPathComponent:@"profiles"] URLByAppendingPathComponent:[name stringByAppendingPathExtension:@"json"]], nil];
+	AVRElfFilePtr	elfFile = _elfFileCache->GetElfFile([MainWindowController elfPathFor:inSketchRec forKey:kTempURLKey]);
+	std::vector<uint8_t>	eepromImage;
+	uint32_t	eepromImageAddr;
+	if (elfFile &&
+		elfFile->GetEEPROMImage(eepromImage, eepromImageAddr))
+	{
+		[fileURLs addObject:[_exportFolderURL URLByAppendingPathComponent:[name stringByAppendingPathExtension:@"eep"]]];
+	}
+	if ([self deviceValueForKey:"flash.page_size" sketch:inSketchRec])
+	{
+		[fileURLs addObject:[_exportFolderURL URLByAppendingPathComponent:[name stringByAppendingPathExtension:@"pages.hex"]]];
+	}
+	for (NSURL* fileURL in fileURLs)
+	{
+		if (![[NSFileManager defaultManager] fileExistsAtPath:fileURL.path])
+		{
+			return(NO);
+		}
+	}
+	return(YES);
+}
+
+/***************************** deviceValueForKey ******************************/
+/*
+*	Returns the numeric value of inKey (e.g. "flash.page_size") from the
+*	device's avrdude.conf entry, or 0 if it can't be determined.
+*/
+- (uint32_t)deviceValueForKey:(const char*)inKey sketch:(NSDictionary*)inSketchRec
+{
+	uint32_t	value = 0;
+	NSString*	fqbnKey = inSketchRec[kFQBNKey];
+	NSString*	deviceName = inSketchRec[kDeviceNameKey];
+	if (fqbnKey &&
+		deviceName)
+	{
+		std::string	avrdudeConfigPath;
+		BoardsConfigFile*	configFile = _configFiles->GetConfigForFQBN(fqbnKey.UTF8String);
+		uint32_t	keysNotFound = 0;
+		if (configFile &&
+			configFile->ValueForKey("config.path", avrdudeConfigPath, keysNotFound) &&
+			keysNotFound == 0)
+		{
+			AvrdudeConfigFile*	avrConfigFile = _avrdudeConfigFiles->GetConfigForPath(avrdudeConfigPath.c_str());
+			if (avrConfigFile)
+			{
+				JSONObject* devEntry = avrConfigFile->Export(deviceName.UTF8String);
+				if (devEntry)
+				{
+					JSONString*	valueStr = (JSONString*)devEntry->GetElement(inKey, IJSONElement::eString);
+					if (valueStr)
+					{
+						value = (uint32_t)strtoul(valueStr->GetString().c_str(), nullptr, 0);
+					}
+					delete devEntry;
+				}
+			}
+		}
+	}
+	return(value);
+}
+
 /********************************* dumpConfig *********************************/
 - (IBAction)dumpConfig:(id)sender
 {
@@ -704,16 +1035,19 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 	__block NSMutableArray<NSMutableDictionary*>*	sketches = _hexLoaderTableViewController.sketches;
 	if (selectedRows.count)
 	{
+		SymbolExportRules	exportRules;
+		[self readSymbolExportRules:exportRules];
 		[selectedRows enumerateIndexesUsingBlock:^(NSUInteger inIndex, BOOL *outStop)
 		{
 			NSMutableDictionary* sketchRec = [sketches objectAtIndex:inIndex];
 			std::string	configText;
-			[self configTextForSketch:sketchRec configText:configText];
+			[self configTextForSketch:sketchRec exportRules:exportRules configText:configText];
 			[_hexLoaderLogViewController postInfoString:[NSString stringWithFormat:@"Config summary for %@", sketchRec[kNameKey]]];
 			[[[[_hexLoaderLogViewController
 				setColor:_hexLoaderLogViewController.blackColor]
 				appendUTF8String:configText.c_str()]
 				appendColoredString:_hexLoaderLogViewController.lightBlueColor string:@"----- end -----\n"] post];
+			[self logISRCyclesForSketch:sketchRec];
 		}];
 	} else
 	{
@@ -721,6 +1055,35 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 	}
 }
 
+/*************************** logISRCyclesForSketch ****************************/
+/*
+*	Logs the estimated cycles of each implemented interrupt handler.  The
+*	core is determined from the device name and flash size.
+*/
+- (void)logISRCyclesForSketch:(NSDictionary*)inSketchRec
+{
+	NSString*	deviceName = inSketchRec[kDeviceNameKey];
+	AVRElfFilePtr	elfFile = _elfFileCache->GetElfFile([MainWindowController elfPathFor:inSketchRec forKey:kTempURLKey]);
+	if (elfFile &&
+		deviceName)
+	{
+		bool	has22BitPC;
+		EAVRCore	core = AVRCycleAnalyzer::CoreForDevice(deviceName.UTF8String,
+							[self deviceValueForKey:"flash.size" sketch:inSketchRec], has22BitPC);
+		AVRCycleAnalyzer	analyzer(*elfFile, core, has22BitPC);
+		ISRCycles	isrCycles;
+		if (analyzer.AnalyzeVectors(isrCycles) &&
+			!isrCycles.empty())
+		{
+			std::string	reportText;
+			analyzer.Report(isrCycles, reportText);
+			[[[_hexLoaderLogViewController
+				setColor:_hexLoaderLogViewController.blackColor]
+				appendUTF8String:reportText.c_str()] post];
+		}
+	}
+}
+
 /**************************** configTextForSketch *****************************/
 /*
 *	When writing the config file exported with the hex file, some of the
@@ -734,8 +1097,11 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 *
 *	Note that any additional keys you actually need to use in the HexLoader
 *	sketch needs to be added to AVRConfig.cpp.
+*
+*	inExportRules are read once per export or dump by the caller (see
+*	readSymbolExportRules.)
 */
-- (void)configTextForSketch:(NSMutableDictionary*)inSketchRec configText:(std::string&)outConfigText
+- (void)configTextForSketch:(NSMutableDictionary*)inSketchRec exportRules:(const SymbolExportRules&)inExportRules configText:(std::string&)outConfigText
 {
 	NSString*	fqbnKey = inSketchRec[kFQBNKey];
 	NSString*	deviceName = inSketchRec[kDeviceNameKey];
@@ -806,26 +1172,37 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 						devEntry->InsertElement("byte_count", new JSONString(byteCountStr));
 					}
 					/*
+					*	The elf file is the source of the fuses, lock bits and
+					*	signature when the sketch declares them (FUSES,
+					*	LOCKBITS, SIGNATURE.)
+					*/
+					AVRElfFilePtr	elfFile = _elfFileCache->GetElfFile([MainWindowController elfPathFor:inSketchRec forKey:kTempURLKey]);
+					/*
 					*	Add the fuses
 					*	fuses extended, high, and low are merged into a single uint32_t.
 					*/
 					{
-						std::string	value;
 						char fusesStr[15];
-						uint32_t	hexVal, fuses;
-						keysNotFound = 0;
-						configFile->ValueForKey("bootloader.extended_fuses", value, keysNotFound);
-						sscanf(value.c_str(), "%x", &fuses);
-						value.clear();
-						keysNotFound = 0;
-						configFile->ValueForKey("bootloader.high_fuses", value, keysNotFound);
-						sscanf(value.c_str(), "%x", &hexVal);
-						fuses = (fuses<<8) + hexVal;
-						value.clear();
-						keysNotFound = 0;
-						configFile->ValueForKey("bootloader.low_fuses", value, keysNotFound);
-						sscanf(value.c_str(), "%x", &hexVal);
-						fuses = (fuses<<8) + hexVal;
+						uint32_t	fuses;
+						if (!elfFile ||
+							!elfFile->GetFuses(fuses))
+						{
+							std::string	value;
+							uint32_t	hexVal;
+							keysNotFound = 0;
+							configFile->ValueForKey("bootloader.extended_fuses", value, keysNotFound);
+							sscanf(value.c_str(), "%x", &fuses);
+							value.clear();
+							keysNotFound = 0;
+							configFile->ValueForKey("bootloader.high_fuses", value, keysNotFound);
+							sscanf(value.c_str(), "%x", &hexVal);
+							fuses = (fuses<<8) + hexVal;
+							value.clear();
+							keysNotFound = 0;
+							configFile->ValueForKey("bootloader.low_fuses", value, keysNotFound);
+							sscanf(value.c_str(), "%x", &hexVal);
+							fuses = (fuses<<8) + hexVal;
+						}
 						snprintf(fusesStr, 15, "0x%x", fuses);
 						valueStr.assign(fusesStr);
 						devEntry->InsertElement("fuses", new JSONString(valueStr));
@@ -861,8 +1238,12 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 								}
 							}
 						}
-						configFile->ValueForKey("bootloader.lock_bits", value, keysNotFound);
-						sscanf(value.c_str(), "%x", &hexVal);
+						if (!elfFile ||
+							!elfFile->GetLockBits(hexVal))
+						{
+							configFile->ValueForKey("bootloader.lock_bits", value, keysNotFound);
+							sscanf(value.c_str(), "%x", &hexVal);
+						}
 						hexVal &= lockMask;
 						lockBits = (lockBits<<8) + hexVal;
 						value.clear();
@@ -878,6 +1259,39 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 						devEntry->InsertElement("lock_bits", new JSONString(valueStr));
 					}
 					/*
+					*	If the sketch declares a signature and it doesn't match
+					*	the device signature THEN
+					*	the sketch was built for a different device.
+					*/
+					{
+						uint32_t	signature;
+						JSONString*	deviceSignature = (JSONString*)devEntry->GetElement("signature", IJSONElement::eString);
+						if (elfFile &&
+							deviceSignature &&
+							elfFile->GetSignature(signature) &&
+							signature != (uint32_t)strtoul(deviceSignature->GetString().c_str(), nullptr, 16))
+						{
+							[self->_hexLoaderLogViewController postWarningString: [NSString stringWithFormat:
+								@"The signature 0x%06x declared in %@ doesn't match the %@ signature %s.",
+									signature, inSketchRec[kNameKey], deviceName, deviceSignature->GetString().c_str()]];
+						}
+					}
+					/*
+					*	Add the size of the initial EEPROM content, if any.
+					*	The content is exported as <name>.eep (see exportHex)
+					*/
+					{
+						std::vector<uint8_t>	eepromImage;
+						uint32_t	eepromImageAddr;
+						if (elfFile &&
+							elfFile->GetEEPROMImage(eepromImage, eepromImageAddr))
+						{
+							char byteCountStr[15];
+							snprintf(byteCountStr, 15, "%d", (int)eepromImage.size());
+							devEntry->InsertElement("eeprom_byte_count", new JSONString(byteCountStr));
+						}
+					}
+					/*
 					*	Get the bootloader ID.  It's set to 0 on error and if
 					*	this device doesn't have one.
 					*/
@@ -888,60 +1302,46 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 						devEntry->InsertElement("bootloader", new JSONString(valueStr));
 					}
 					/*
-					*	If this is the DCSensor...
+					*	Add the load address and size of each symbol named by
+					*	the export rules that apply to this sketch.
 					*/
-					if ([(NSString*)(inSketchRec[kNameKey]) compare:@"DCSensor.ino"] == 0)
 					{
-						AVRElfFile	elfFile;
-						if (elfFile.ReadFile([MainWindowController elfPathFor:inSketchRec forKey:kTempURLKey]))
+						SymbolExports	symbolExports;
+						SymbolExportRulePtrs	unresolved;
+						const char*	sketchName = ((NSString*)inSketchRec[kNameKey]).UTF8String;
+						if (elfFile)
 						{
-							/*
-								The DCSensor.ino has a uint32_t unix timestamp created from the various time
-								and date environment variables in gcc.  The unix timestamp needs to be
-								unique for the DCSensor.ino because the CAN ID is initially created from it.
-								 If the CAN ID is the same as another DCSensor on the bus, the bus may go
-								into an error state. Because the Hex Loader copies the executable from an SD
-								card, the timestamp is the same for every board.  This experiment extracts
-								the address of the timestamp and dynamically replaces it while loading with
-								the current timestamp.
-
-								In order to do this the flash address of the timestamp needs to be
-								determined. Normally the timestamp would be treated by the compiler as const
-								and its value would be hard coded wherever it's used.  To keep this from
-								happening the variable is marked as volitile.  This will force the
-								initialization code to copy the initial value from flash to SRAM when the
-								mcu boots.
-
-								Calculating the flash address of the timestamp:  Find the symbol in the data
-								section.  The address will be offset by the start of the data section.
-								Example: if the data is initialized from flash (aka text) starting at 0x0C6E
-								and the data section starts at 0x0060 in SRAM.  The initialization for the
-								kTimestamp symbol at address 0x64 would be 0x0064 - 0x0060 + 0x0C6E = 0x0C72.
-							*/
-							const SSymbolTblEntry*	symTableEntry = nullptr;
-							uint8_t*	symbolValuePtr = elfFile.GetSymbolValuePtr("kTimestamp", &symTableEntry);
-							SSectEntry*	dataSect = elfFile.GetSectEntry(eData);
-							SSectEntry*	textSect = elfFile.GetSectEntry(eText);
-							if (symbolValuePtr && symbolValuePtr && dataSect && textSect)
+							inExportRules.Resolve(sketchName, *elfFile, symbolExports, unresolved);
+							SymbolExports::const_iterator	itr = symbolExports.begin();
+							SymbolExports::const_iterator	itrEnd = symbolExports.end();
+							for (; itr != itrEnd; ++itr)
 							{
-								uint32_t	timeStampAddr = textSect->addrInMem +
-															textSect->size +
-															symTableEntry->value -
-															dataSect->addrInMem;
-								/*
-								*	Add this address to the AvrdudeConfig for this device.
-								*/
-								if (avrConfigFile)
+								char valueStr[15];
+								snprintf(valueStr, 15, "0x%x", itr->loadAddress);
+								devEntry->InsertElement(itr->rule->configKey, new JSONString(valueStr));
+								if (itr->rule->exportSize)
 								{
-									char timeStampAddrStr[15];
-									snprintf(timeStampAddrStr, 15, "0x%x", timeStampAddr);
-									devEntry->InsertElement("timestamp", new JSONString(timeStampAddrStr));
+									snprintf(valueStr, 15, "%d", itr->size);
+									devEntry->InsertElement(SymbolExportRules::SizeKey(*itr->rule), new JSONString(valueStr));
 								}
 							}
+							SymbolExportRulePtrs::const_iterator	uItr = unresolved.begin();
+							SymbolExportRulePtrs::const_iterator	uItrEnd = unresolved.end();
+							for (; uItr != uItrEnd; ++uItr)
+							{
+								[self->_hexLoaderLogViewController postWarningString: [NSString stringWithFormat:
+									@"The symbol %s named by the export rules isn't a flash or initialized data symbol of %@.",
+										(*uItr)->symbolName.c_str(), inSketchRec[kNameKey]]];
+							}
 						} else
 						{
-							[self->_hexLoaderLogViewController postErrorString: [NSString stringWithFormat:
-								@"Unable to open the %@.elf file and/or the elf file is damaged and/or this is not an AVR device.", inSketchRec[kNameKey]]];
+							SymbolExportRulePtrs	rules;
+							inExportRules.RulesForSketch(sketchName, rules);
+							if (rules.size())
+							{
+								[self->_hexLoaderLogViewController postErrorString: [NSString stringWithFormat:
+									@"Unable to open the %@.elf file and/or the elf file is damaged and/or this is not an AVR device.", inSketchRec[kNameKey]]];
+							}
 						}
 					}
 					AvrdudeConfigFile::Write(devEntry, outConfigText);
@@ -952,6 +1352,26 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 	}
 }
 
+/*************************** readSymbolExportRules ****************************/
+/*
+*	The rules are read from the rules file in the Export folder, if any,
+*	else the default rules are used.  See SymbolExportRules.h for the format.
+*/
+- (void)readSymbolExportRules:(SymbolExportRules&)outRules
+{
+	if (_exportFolderURL)
+	{
+		NSURL*	rulesURL = [_exportFolderURL URLByAppendingPathComponent:kSymbolExportRulesName];
+		uint32_t	badLines;
+		if (outRules.ReadFile(rulesURL.path.UTF8String, badLines) &&
+			badLines)
+		{
+			[_hexLoaderLogViewController postWarningString: [NSString stringWithFormat:
+				@"%d line(s) of %@ in the Export folder aren't rules.", badLines, kSymbolExportRulesName]];
+		}
+	}
+}
+
 /************************* exportBootloaderForConfig **************************/
 /*
 *	If the BoardsConfigFile has a bootloader associated with it the ID of the
@@ -1032,6 +1452,7 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 					BOOL pathsFileExists = [[NSFileManager defaultManager] fileExistsAtPath:pathsPath isDirectory:&isDirectory] && isDirectory == NO;
 					
 					IndexVec	usedIDs;
+					IndexVecBuilder	usedIDsBuilder;
 					BOOL		idError = false;
 					if (pathsFileExists &&
 						pathsFile.ReadFile(pathsPath.UTF8String))
@@ -1044,10 +1465,15 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 						for (; itr != itrEnd; ++itr)
 						{
 							thisID = atoi(itr->first.c_str());
-							if (thisID &&
-								!usedIDs.Contains(thisID))
+							if (thisID)
 							{
-								usedIDs.Set(thisID, thisID);
+								/*
+								*	The keys are sorted as strings rather
+								*	than numbers, so the builder sorts the IDs
+								*	and counts the duplicates when it builds
+								*	usedIDs.
+								*/
+								usedIDsBuilder.Add(thisID);
 								if (!itr->second->IsJSONString() ||
 									((const JSONString*)(itr->second))->GetString().compare(bootloaderfullPath))
 								{
@@ -1071,6 +1497,13 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 								break;
 							}
 						}
+						if (usedIDsBuilder.Build(usedIDs) &&
+							!idError)
+						{
+							idError = true;
+							bootloaderID = 0;
+							[_hexLoaderLogViewController postErrorString: @"Duplicate or invalid IDs found in bootloaders/paths.txt.  Operation can't continue."];
+						}
 					}
 					if (!idError &&
 						bootloaderID == 0)
@@ -1084,7 +1517,16 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 						snprintf(idStr, 15, "%d", newID);
 						pathsFile.InsertKeyValue(idStr, bootloaderfullPath);
 						NSString*	exportedBootloaderPath = [bootloadersURL.path stringByAppendingPathComponent:[NSString stringWithFormat:@"B%d.hex", newID]];
-						if ([[NSFileManager defaultManager] copyItemAtPath:bootloaderPath toPath:exportedBootloaderPath error:nil])
+						/*
+						*	Verify the bootloader is a valid hex file before
+						*	adding it.
+						*/
+						FlashImage	bootloaderImage;
+						uint32_t	errorLine = 0;
+						if (!IntelHexFile::ReadFile(bootloaderPath.UTF8String, bootloaderImage, &errorLine))
+						{
+							[_hexLoaderLogViewController postErrorString: [NSString stringWithFormat:@"The bootloader is not a valid hex file (line %d).  Operation can't continue.", errorLine]];
+						} else if ([[NSFileManager defaultManager] copyItemAtPath:bootloaderPath toPath:exportedBootloaderPath error:nil])
 						{
 							std::string	paths;
 							AvrdudeConfigFile::Write(pathsFile.GetRootObject(), paths);
@@ -1139,6 +1581,26 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 			[selectedRows enumerateIndexesUsingBlock:^(NSUInteger inIndex, BOOL *outStop)
 			{
 				NSMutableDictionary* sketchRec = [sketches objectAtIndex:inIndex];
+				/*
+				*	The dump is created by the built in disassembler.  The
+				*	elfdump recipe (avr-objdump) is only used if the elf file
+				*	can't be read.
+				*/
+				AVRElfFilePtr	elfFile = _elfFileCache->GetElfFile([MainWindowController elfPathFor:sketchRec forKey:kTempURLKey]);
+				if (elfFile)
+				{
+					NSString*	elfName = [sketchRec[kNameKey] stringByAppendingPathExtension:@"elf"];
+					NSURL*	dumpFileURL = [_exportFolderURL URLByAppendingPathComponent:[elfName stringByAppendingPathExtension:@"txt"]];
+					AVRDisassembler	disassembler(*elfFile);
+					if (disassembler.WriteFile(dumpFileURL.path.UTF8String, elfName.UTF8String))
+					{
+						[_hexLoaderLogViewController postInfoString: [NSString stringWithFormat:@"%@.elf.txt has been created in the Export folder.", sketchRec[kNameKey]]];
+					} else
+					{
+						[_hexLoaderLogViewController postErrorString: [NSString stringWithFormat:@"Unable to export dump of %@.elf to the Export folder.", sketchRec[kNameKey]]];
+					}
+					return;
+				}
 				BoardsConfigFile*	configFile = _configFiles->GetConfigForFQBN(((NSString*)sketchRec[kFQBNKey]).UTF8String);
 				if (configFile)
 				{
@@ -1659,10 +2121,10 @@ AvrdudeConfigFiles* _avrdudeConfigFiles;
 						*	Get the flash used
 						*/
 						{
-							AVRElfFile	elfFile;
-							if (elfFile.ReadFile([MainWindowController elfPathFor:sketchRec forKey:kTempURLKey]))
+							AVRElfFilePtr	elfFile = _elfFileCache->GetElfFile([MainWindowController elfPathFor:sketchRec forKey:kTempURLKey]);
+							if (elfFile)
 							{
-								uint32_t	length = elfFile.GetFlashUsed();
+								uint32_t	length = elfFile->GetFlashUsed();
 								[sketchRec setObject:[NSNumber numberWithUnsignedLong:length] forKey:kLengthKey];
 							} else
 							{
@@ -0,0 +1,364 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  SizeProfile.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#include "SizeProfile.h"
+#include "AVRElfFile.h"
+#include "JSONElement.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+const char* const	SizeProfile::kUnattributed = "(unattributed)";
+
+/******************************** SizeProfile *********************************/
+SizeProfile::SizeProfile(void)
+	: mFlashSize(0), mRAMSize(0)
+{
+}
+
+/*********************************** Build ************************************/
+bool SizeProfile::Build(
+	const AVRElfFile&	inElfFile)
+{
+	struct SSizedSymbol
+	{
+		const char*	name;
+		uint32_t	flashSize;
+		uint32_t	ramSize;
+		bool operator < (const SSizedSymbol& inSymbol) const
+			{return(strcmp(name, inSymbol.name) < 0);}
+	};
+	mSymbols.clear();
+	mFlashSize = mRAMSize = 0;
+	const SSectEntry*	textSect = inElfFile.GetSectEntry(eText);
+	if (!textSect)
+	{
+		return(false);
+	}
+	uint32_t	numSymTableEntries;
+	const SSymbolTblEntry*	symbolTable = inElfFile.GetSymbolTable(numSymTableEntries);
+	const char*	stringTable = inElfFile.GetStringTable();
+	std::vector<SSizedSymbol>	sizedSymbols;
+	uint32_t	attributedFlash = 0;
+	uint32_t	attributedRAM = 0;
+	for (uint32_t i = 0; i < numSymTableEntries; i++)
+	{
+		const SSymbolTblEntry&	symbol = symbolTable[i];
+		uint8_t	symbolType = symbol.info & 0xF;
+		if (symbol.size == 0 ||
+			symbolType > eSymFunc)
+		{
+			continue;
+		}
+		SSizedSymbol	sizedSymbol = {&stringTable[symbol.name], 0, 0};
+		switch (inElfFile.GetSectName(symbol.shndx))
+		{
+			case eText:
+				sizedSymbol.flashSize = symbol.size;
+				break;
+			case eData:
+				sizedSymbol.flashSize = symbol.size;
+				sizedSymbol.ramSize = symbol.size;
+				break;
+			case eBSS:
+			case eNoInit:
+				sizedSymbol.ramSize = symbol.size;
+				break;
+			default:
+				continue;
+		}
+		attributedFlash += sizedSymbol.flashSize;
+		attributedRAM += sizedSymbol.ramSize;
+		sizedSymbols.push_back(sizedSymbol);
+	}
+	const SSectEntry*	dataSect = inElfFile.GetSectEntry(eData);
+	const SSectEntry*	bssSect = inElfFile.GetSectEntry(eBSS);
+	const SSectEntry*	noInitSect = inElfFile.GetSectEntry(eNoInit);
+	mFlashSize = textSect->size + (dataSect ? dataSect->size : 0);
+	mRAMSize = (dataSect ? dataSect->size : 0) + (bssSect ? bssSect->size : 0) + (noInitSect ? noInitSect->size : 0);
+	if (mFlashSize > attributedFlash ||
+		mRAMSize > attributedRAM)
+	{
+		SSizedSymbol	unattributed = {kUnattributed,
+							mFlashSize > attributedFlash ? mFlashSize - attributedFlash : 0,
+							mRAMSize > attributedRAM ? mRAMSize - attributedRAM : 0};
+		sizedSymbols.push_back(unattributed);
+	}
+	/*
+	*	Sort by name and combine symbols with the same name.
+	*/
+	std::sort(sizedSymbols.begin(), sizedSymbols.end());
+	mSymbols.reserve(sizedSymbols.size());
+	for (size_t i = 0; i < sizedSymbols.size(); i++)
+	{
+		if (!mSymbols.empty() &&
+			mSymbols.back().name == sizedSymbols[i].name)
+		{
+			mSymbols.back().flashSize += sizedSymbols[i].flashSize;
+			mSymbols.back().ramSize += sizedSymbols[i].ramSize;
+		} else
+		{
+			SSymbolSize	symbolSize = {sizedSymbols[i].name, sizedSymbols[i].flashSize, sizedSymbols[i].ramSize};
+			mSymbols.push_back(symbolSize);
+		}
+	}
+	return(true);
+}
+
+/************************************ Diff ************************************/
+/*
+*	Both symbol lists are sorted by name so the symbols are matched in a
+*	single merge pass.
+*/
+void SizeProfile::Diff(
+	const SizeProfile&	inPrevious,
+	SymbolSizeDeltas&	outDeltas,
+	size_t				inMaxDeltas) const
+{
+	outDeltas.clear();
+	SymbolSizes::const_iterator	itr = mSymbols.begin();
+	SymbolSizes::const_iterator	itrEnd = mSymbols.end();
+	SymbolSizes::const_iterator	prevItr = inPrevious.mSymbols.begin();
+	SymbolSizes::const_iterator	prevItrEnd = inPrevious.mSymbols.end();
+	while (itr != itrEnd || prevItr != prevItrEnd)
+	{
+		SSymbolSizeDelta	delta;
+		int	cmpResult = itr == itrEnd ? 1 : (prevItr == prevItrEnd ? -1 : itr->name.compare(prevItr->name));
+		if (cmpResult < 0)
+		{
+			delta.name = itr->name;
+			delta.flashDelta = itr->flashSize;
+			delta.ramDelta = itr->ramSize;
+			++itr;
+		} else if (cmpResult > 0)
+		{
+			delta.name = prevItr->name;
+			delta.flashDelta = -(int32_t)prevItr->flashSize;
+			delta.ramDelta = -(int32_t)prevItr->ramSize;
+			++prevItr;
+		} else
+		{
+			delta.name = itr->name;
+			delta.flashDelta = (int32_t)itr->flashSize - (int32_t)prevItr->flashSize;
+			delta.ramDelta = (int32_t)itr->ramSize - (int32_t)prevItr->ramSize;
+			++itr;
+			++prevItr;
+		}
+		if (delta.flashDelta || delta.ramDelta)
+		{
+			outDeltas.push_back(delta);
+		}
+	}
+	struct SGrowthOrder
+	{
+		bool operator () (const SSymbolSizeDelta& inA, const SSymbolSizeDelta& inB) const
+		{
+			bool	aGrew = inA.flashDelta > 0 || (inA.flashDelta == 0 && inA.ramDelta > 0);
+			bool	bGrew = inB.flashDelta > 0 || (inB.flashDelta == 0 && inB.ramDelta > 0);
+			if (aGrew != bGrew)
+			{
+				return(aGrew);
+			}
+			int32_t	aFlash = aGrew ? inA.flashDelta : -inA.flashDelta;
+			int32_t	bFlash = aGrew ? inB.flashDelta : -inB.flashDelta;
+			if (aFlash != bFlash)
+			{
+				return(aFlash > bFlash);
+			}
+			return(aGrew ? inA.ramDelta > inB.ramDelta : inA.ramDelta < inB.ramDelta);
+		}
+	};
+	if (inMaxDeltas &&
+		inMaxDeltas < outDeltas.size())
+	{
+		std::partial_sort(outDeltas.begin(), outDeltas.begin() + inMaxDeltas, outDeltas.end(), SGrowthOrder());
+		outDeltas.resize(inMaxDeltas);
+	} else
+	{
+		std::sort(outDeltas.begin(), outDeltas.end(), SGrowthOrder());
+	}
+}
+
+/*********************************** Export ***********************************/
+/*
+*	{"label":"...", "flash":n, "ram":n, "symbols":{"name":[flash, ram],...}}
+*/
+JSONObject* SizeProfile::Export(void) const
+{
+	JSONObject*	profileObject = new JSONObject;
+	profileObject->InsertElement("label", new JSONString(mLabel));
+	profileObject->InsertElement("flash", new JSONNumber(mFlashSize));
+	profileObject->InsertElement("ram", new JSONNumber(mRAMSize));
+	JSONObject*	symbolsObject = new JSONObject;
+	SymbolSizes::const_iterator	itr = mSymbols.begin();
+	SymbolSizes::const_iterator	itrEnd = mSymbols.end();
+	for (; itr != itrEnd; ++itr)
+	{
+		JSONArray*	sizes = new JSONArray;
+		sizes->AddElement(new JSONNumber(itr->flashSize));
+		sizes->AddElement(new JSONNumber(itr->ramSize));
+		symbolsObject->InsertElement(itr->name, sizes);
+	}
+	profileObject->InsertElement("symbols", symbolsObject);
+	return(profileObject);
+}
+
+/*********************************** Import ***********************************/
+bool SizeProfile::Import(
+	const JSONObject*	inObject)
+{
+	mSymbols.clear();
+	const JSONString*	label = (const JSONString*)inObject->GetElement("label", IJSONElement::eString);
+	const JSONNumber*	flashSize = (const JSONNumber*)inObject->GetElement("flash", IJSONElement::eNumber);
+	const JSONNumber*	ramSize = (const JSONNumber*)inObject->GetElement("ram", IJSONElement::eNumber);
+	const JSONObject*	symbolsObject = (const JSONObject*)inObject->GetElement("symbols", IJSONElement::eObject);
+	bool	success = label && flashSize && ramSize && symbolsObject;
+	if (success)
+	{
+		mLabel = label->GetString();
+		mFlashSize = (uint32_t)flashSize->GetValue();
+		mRAMSize = (uint32_t)ramSize->GetValue();
+		const JSONElementMap&	symbolsMap = symbolsObject->GetMap();
+		JSONElementMap::const_iterator	itr = symbolsMap.begin();
+		JSONElementMap::const_iterator	itrEnd = symbolsMap.end();
+		// The map is sorted by name
+		mSymbols.reserve(symbolsMap.size());
+		for (; itr != itrEnd; ++itr)
+		{
+			const JSONArray*	sizes = itr->second->IsJSONArray() ? (const JSONArray*)itr->second : NULL;
+			const JSONNumber*	symbolFlashSize = sizes ? (const JSONNumber*)sizes->GetNthElement(0, IJSONElement::eNumber) : NULL;
+			const JSONNumber*	symbolRAMSize = sizes ? (const JSONNumber*)sizes->GetNthElement(1, IJSONElement::eNumber) : NULL;
+			if (!symbolFlashSize ||
+				!symbolRAMSize)
+			{
+				success = false;
+				break;
+			}
+			SSymbolSize	symbolSize = {itr->first, (uint32_t)symbolFlashSize->GetValue(), (uint32_t)symbolRAMSize->GetValue()};
+			mSymbols.push_back(symbolSize);
+		}
+	}
+	if (!success)
+	{
+		mSymbols.clear();
+		mFlashSize = mRAMSize = 0;
+	}
+	return(success);
+}
+
+/********************************** ReadFile **********************************/
+/*
+*	{"profiles":[profile,...]}
+*/
+bool SizeProfileHistory::ReadFile(
+	const char*	inPath)
+{
+	bool	success = false;
+	mProfiles.clear();
+	FILE*	file = fopen(inPath, "rb");
+	if (file)
+	{
+		std::string	historyText;
+		char	buffer[4096];
+		size_t	bytesRead;
+		while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) != 0)
+		{
+			historyText.append(buffer, bytesRead);
+		}
+		fclose(file);
+		IJSONElement*	rootElement = IJSONElement::Create(historyText);
+		if (rootElement)
+		{
+			const JSONArray*	profilesArray = rootElement->IsJSONObject() ?
+				(const JSONArray*)((JSONObject*)rootElement)->GetElement("profiles", IJSONElement::eArray) : NULL;
+			if (profilesArray)
+			{
+				success = true;
+				for (size_t i = 0; ; i++)
+				{
+					const JSONObject*	profileObject = (const JSONObject*)profilesArray->GetNthElement(i, IJSONElement::eObject);
+					if (!profileObject)
+					{
+						break;
+					}
+					SizeProfile	profile;
+					if (profile.Import(profileObject))
+					{
+						mProfiles.push_back(profile);
+					}
+				}
+			}
+			delete rootElement;
+		}
+	}
+	return(success);
+}
+
+/********************************* WriteFile **********************************/
+bool SizeProfileHistory::WriteFile(
+	const char*	inPath) const
+{
+	bool	success = false;
+	JSONObject*	historyObject = Export();
+	std::string	historyText;
+	historyObject->Write(0, historyText);
+	delete historyObject;
+	historyText += '\n';
+	FILE*	file = fopen(inPath, "wb");
+	if (file)
+	{
+		success = fwrite(historyText.data(), 1, historyText.size(), file) == historyText.size();
+		fclose(file);
+	}
+	return(success);
+}
+
+/********************************* AddProfile *********************************/
+void SizeProfileHistory::AddProfile(
+	const SizeProfile&	inProfile)
+{
+	mProfiles.push_back(inProfile);
+	if (mProfiles.size() > kMaxProfiles)
+	{
+		mProfiles.erase(mProfiles.begin(), mProfiles.end() - kMaxProfiles);
+	}
+}
+
+/*********************************** Export ***********************************/
+JSONObject* SizeProfileHistory::Export(void) const
+{
+	JSONObject*	historyObject = new JSONObject;
+	JSONArray*	profilesArray = new JSONArray;
+	SizeProfiles::const_iterator	itr = mProfiles.begin();
+	SizeProfiles::const_iterator	itrEnd = mProfiles.end();
+	for (; itr != itrEnd; ++itr)
+	{
+		profilesArray->AddElement(itr->Export());
+	}
+	historyObject->InsertElement("profiles", profilesArray);
+	return(historyObject);
+}
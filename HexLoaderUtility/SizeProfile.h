@@ -0,0 +1,136 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  SizeProfile.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#ifndef SizeProfile_h
+#define SizeProfile_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class AVRElfFile;
+class JSONObject;
+
+struct SSymbolSize
+{
+	std::string	name;
+	uint32_t	flashSize;	// .text, and the initial values of .data
+	uint32_t	ramSize;	// .data, .bss and .noinit
+};
+
+typedef std::vector<SSymbolSize> SymbolSizes;
+
+struct SSymbolSizeDelta
+{
+	std::string	name;
+	int32_t		flashDelta;
+	int32_t		ramDelta;
+};
+
+typedef std::vector<SSymbolSizeDelta> SymbolSizeDeltas;
+
+/*
+*	SizeProfile is the flash and RAM used by each sized symbol of a build,
+*	taken from .symtab.  Symbols with the same name (e.g. file statics)
+*	are combined.  The space used within .text, .data, .bss and .noinit
+*	that isn't attributed to a symbol (vectors, padding, unsized library
+*	code) is reported as the symbol kUnattributed.
+*/
+class SizeProfile
+{
+public:
+							SizeProfile(void);
+							~SizeProfile(void){}
+	bool					Build(
+								const AVRElfFile&		inElfFile);
+	/*
+	*	Sorted by name.
+	*/
+	const SymbolSizes&		GetSymbols(void) const
+								{return(mSymbols);}
+	uint32_t				GetFlashSize(void) const
+								{return(mFlashSize);}
+	uint32_t				GetRAMSize(void) const
+								{return(mRAMSize);}
+	/*
+	*	The label identifies the build, e.g. the export date and time.
+	*/
+	const std::string&		GetLabel(void) const
+								{return(mLabel);}
+	void					SetLabel(
+								const std::string&		inLabel)
+								{mLabel = inLabel;}
+	/*
+	*	Sets outDeltas to the symbols whose size changed from inPrevious
+	*	to this profile, largest flash growth first, then largest RAM
+	*	growth.  Symbols that shrank follow in the same order.  When
+	*	inMaxDeltas is not 0, only the first inMaxDeltas are returned.
+	*/
+	void					Diff(
+								const SizeProfile&		inPrevious,
+								SymbolSizeDeltas&		outDeltas,
+								size_t					inMaxDeltas = 0) const;
+	/*
+	*	Export returns a new JSONObject owned by the caller.
+	*/
+	JSONObject*				Export(void) const;
+	bool					Import(
+								const JSONObject*		inObject);
+	static const char* const	kUnattributed;
+protected:
+	SymbolSizes	mSymbols;
+	uint32_t	mFlashSize;
+	uint32_t	mRAMSize;
+	std::string	mLabel;
+};
+
+typedef std::vector<SizeProfile> SizeProfiles;
+
+/*
+*	The size profiles of a sketch's builds, oldest first, persisted as a
+*	JSON file.  Only the most recent kMaxProfiles are kept.
+*/
+class SizeProfileHistory
+{
+public:
+							SizeProfileHistory(void){}
+							~SizeProfileHistory(void){}
+	bool					ReadFile(
+								const char*				inPath);
+	bool					WriteFile(
+								const char*				inPath) const;
+	void					AddProfile(
+								const SizeProfile&		inProfile);
+	const SizeProfiles&		GetProfiles(void) const
+								{return(mProfiles);}
+	JSONObject*				Export(void) const;
+	enum {kMaxProfiles = 32};
+protected:
+	SizeProfiles	mProfiles;
+};
+
+#endif /* SizeProfile_h */
@@ -0,0 +1,636 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  SketchLinker.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+#include "SketchLinker.h"
+#include "AVRElfFile.h"
+#include "AVRXrefIndex.h"
+#include "FlashImage.h"
+#include <string.h>
+#include <algorithm>
+
+enum EOpcodeClass
+{
+	eOp16,		// Any instruction not listed below
+	eOpLDS,
+	eOpSTS,
+	eOpJMP,
+	eOpCALL,
+	eOpLDI,
+	eOpCPI
+};
+
+/*
+*	The opcode class table is indexed by the opcode's upper 7 bits and lower
+*	4 bits, which is enough to identify the instructions of interest.
+*/
+struct SOpcodeClassTable
+{
+	uint8_t	opClass[2048];
+	static constexpr uint32_t Key(
+		uint16_t	inOpcode)
+		{return(((inOpcode >> 9) << 4) | (inOpcode & 0xF));}
+	constexpr SOpcodeClassTable(void)
+	: opClass()
+	{
+		for (uint32_t key = 0; key < 2048; key++)
+		{
+			uint32_t	upper7 = key >> 4;
+			uint32_t	lower4 = key & 0xF;
+			uint8_t	thisClass = eOp16;
+			if (upper7 == 0x48 && lower4 == 0)					// 1001 000d dddd 0000
+			{
+				thisClass = eOpLDS;
+			} else if (upper7 == 0x49 && lower4 == 0)			// 1001 001r rrrr 0000
+			{
+				thisClass = eOpSTS;
+			} else if (upper7 == 0x4A && (lower4 & 0xE) == 0xC)	// 1001 010k kkkk 110k
+			{
+				thisClass = eOpJMP;
+			} else if (upper7 == 0x4A && (lower4 & 0xE) == 0xE)	// 1001 010k kkkk 111k
+			{
+				thisClass = eOpCALL;
+			} else if ((upper7 >> 3) == 0xE)					// 1110 KKKK dddd KKKK
+			{
+				thisClass = eOpLDI;
+			} else if ((upper7 >> 3) == 0x3)					// 0011 KKKK dddd KKKK
+			{
+				thisClass = eOpCPI;
+			}
+			opClass[key] = thisClass;
+		}
+	}
+};
+
+static constexpr SOpcodeClassTable	kOpcodeClassTable;
+
+/*
+*	The flash address constants loaded by the startup routines.  shift is
+*	applied to the symbol's byte address, so lo8, hi8 and hh8 are 0, 8 and
+*	16, and the word address forms pm_lo8, pm_hi8 and pm_hh8 (used by
+*	libgcc's __do_global_ctors/dtors with __tablejump2__) are 1, 9 and 17.
+*	Each constant is only replaced when its current value matches the value
+*	derived from the original symbol.  If a constant that isn't optional
+*	isn't found (e.g. an older libgcc) the sketch can't be relocated.
+*/
+struct SStartupConstant
+{
+	const char*	routine;
+	uint8_t		opClass;	// eOpLDI or eOpCPI
+	uint8_t		reg;
+	const char*	symbol;
+	uint8_t		shift;
+	bool		optional;	// Only on devices with more than 64KB of flash
+};
+
+static const SStartupConstant	kStartupConstants[] =
+{
+	{"__do_copy_data", eOpLDI, 30, "__data_load_start", 0, false},
+	{"__do_copy_data", eOpLDI, 31, "__data_load_start", 8, false},
+	{"__do_copy_data", eOpLDI, 16, "__data_load_start", 16, true},		// ELPM
+	{"__do_global_ctors", eOpLDI, 17, "__ctors_start", 9, false},
+	{"__do_global_ctors", eOpLDI, 28, "__ctors_end", 1, false},
+	{"__do_global_ctors", eOpLDI, 29, "__ctors_end", 9, false},
+	{"__do_global_ctors", eOpLDI, 16, "__ctors_end", 17, true},		// EIJMP
+	{"__do_global_ctors", eOpLDI, 24, "__ctors_start", 17, true},	// EIJMP
+	{"__do_global_ctors", eOpCPI, 28, "__ctors_start", 1, false},
+	{"__do_global_dtors", eOpLDI, 17, "__dtors_end", 9, false},
+	{"__do_global_dtors", eOpLDI, 28, "__dtors_start", 1, false},
+	{"__do_global_dtors", eOpLDI, 29, "__dtors_start", 9, false},
+	{"__do_global_dtors", eOpLDI, 16, "__dtors_start", 17, true},	// EIJMP
+	{"__do_global_dtors", eOpLDI, 24, "__dtors_end", 17, true},		// EIJMP
+	{"__do_global_dtors", eOpCPI, 28, "__dtors_end", 1, false}
+};
+
+static const char* const	kStartupRoutines[] = {"__do_copy_data", "__do_global_ctors", "__do_global_dtors"};
+static const uint32_t	kMaxRoutineWords = 24;
+
+/*
+*	The values assumed to be flash pointers: the word address of each of
+*	the sketch's functions (the form of a function pointer) and any byte
+*	address within one of its PROGMEM objects.  A value that's the address
+*	of one of the sketch's SRAM objects is assumed to be that instead.
+*/
+typedef std::pair<uint32_t, uint32_t> AddressRange;
+
+struct SFlashPointerTargets
+{
+	std::vector<uint32_t>		functions;		// Sorted word addresses
+	std::vector<AddressRange>	objects;		// Sorted PROGMEM object ranges
+	std::vector<uint32_t>		sramObjects;	// Sorted SRAM addresses
+	bool	Contains(
+				uint32_t	inValue) const
+	{
+		if (std::binary_search(sramObjects.begin(), sramObjects.end(), inValue))
+		{
+			return(false);
+		}
+		if (std::binary_search(functions.begin(), functions.end(), inValue))
+		{
+			return(true);
+		}
+		std::vector<AddressRange>::const_iterator	itr = std::upper_bound(objects.begin(), objects.end(), AddressRange(inValue, 0xFFFFFFFF));
+		return(itr != objects.begin() && inValue < (itr-1)->second);
+	}
+};
+
+/****************************** NoteFlashPointer ******************************/
+static void NoteFlashPointer(
+	SLinkedSketch&	ioSketch,
+	uint32_t		inAddress)
+{
+	if (ioSketch.numFlashPointers++ == 0)
+	{
+		ioSketch.firstFlashPointer = inAddress;
+	}
+}
+
+/******************************** SketchLinker ********************************/
+SketchLinker::SketchLinker(
+	uint32_t	inFlashSize,
+	uint32_t	inSRAMStart,
+	uint32_t	inSRAMSize,
+	uint32_t	inFlashAlignment)
+	: mFlashSize(inFlashSize), mSRAMStart(inSRAMStart), mSRAMSize(inSRAMSize),
+	  mFlashAlignment(inFlashAlignment ? inFlashAlignment : 2), mNumVectors(0)
+{
+}
+
+/******************************** CountVectors ********************************/
+/*
+*	Same as GetVectorIndexes, the vector table is the leading JMP
+*	instructions.
+*/
+uint32_t SketchLinker::CountVectors(
+	const uint8_t*	inText,
+	uint32_t		inTextSize)
+{
+	uint32_t	numVectors = 0;
+	for (; ((numVectors + 1) * 4) <= inTextSize; numVectors++)
+	{
+		uint16_t	opcode = inText[numVectors*4] | (inText[numVectors*4 + 1] << 8);
+		if (kOpcodeClassTable.opClass[SOpcodeClassTable::Key(opcode)] != eOpJMP)
+		{
+			break;
+		}
+	}
+	return(numVectors);
+}
+
+/********************************* AddSketch **********************************/
+bool SketchLinker::AddSketch(
+	const AVRElfFile*	inElfFile)
+{
+	std::vector<uint8_t>	image;
+	uint32_t	imageAddr;
+	const SSectEntry*	textSectEntry = inElfFile->GetSectEntry(eText);
+	bool	success = textSectEntry &&
+				inElfFile->GetFlashImage(image, imageAddr) &&
+				imageAddr == 0;
+	if (success)
+	{
+		uint32_t	numVectors = CountVectors(image.data(), textSectEntry->size);
+		success = numVectors > 0 &&
+					(mSketches.empty() || numVectors == mNumVectors);
+		if (success)
+		{
+			mNumVectors = numVectors;
+			SLinkedSketch	sketch;
+			memset(&sketch, 0, sizeof(sketch));
+			sketch.elfFile = inElfFile;
+			sketch.flashSize = (uint32_t)image.size();
+			const SSectEntry*	dataSectEntry = inElfFile->GetSectEntry(eData);
+			const SSectEntry*	bssSectEntry = inElfFile->GetSectEntry(eBSS);
+			uint32_t	sramStart = 0xFFFFFFFF;
+			uint32_t	sramEnd = 0;
+			if (dataSectEntry && dataSectEntry->size)
+			{
+				sramStart = dataSectEntry->addrInMem & 0xFFFF;
+				sramEnd = sramStart + dataSectEntry->size;
+			}
+			if (bssSectEntry && bssSectEntry->size)
+			{
+				sramStart = std::min(sramStart, bssSectEntry->addrInMem & 0xFFFF);
+				sramEnd = std::max(sramEnd, (bssSectEntry->addrInMem & 0xFFFF) + bssSectEntry->size);
+			}
+			if (sramEnd)
+			{
+				sketch.sramStart = (uint16_t)sramStart;
+				sketch.sramSize = (uint16_t)(sramEnd - sramStart);
+			}
+			mSketches.push_back(sketch);
+		}
+	}
+	return(success);
+}
+
+/*********************************** Link *************************************/
+bool SketchLinker::Link(
+	uint32_t	inPersonality,
+	FlashImage&	outImage)
+{
+	outImage.Clear();
+	bool	success = inPersonality < mSketches.size();
+	uint32_t	alignMask = mFlashAlignment - 1;
+	uint32_t	flashAddr = ((mNumVectors * 4) + alignMask) & ~alignMask;
+	std::vector<SLinkedSketch>::iterator	itr = mSketches.begin();
+	std::vector<SLinkedSketch>::iterator	itrEnd = mSketches.end();
+	for (; success && itr != itrEnd; ++itr)
+	{
+		itr->flashOffset = flashAddr;
+		itr->numJmpCallPatched = 0;
+		itr->numTablePatched = 0;
+		itr->numFlashPointers = 0;
+		itr->firstFlashPointer = 0;
+		flashAddr = (flashAddr + itr->flashSize + alignMask) & ~alignMask;
+		std::vector<uint8_t>	image;
+		uint32_t	imageAddr;
+		/*
+		*	The sketches share SRAM, each keeping its own layout.
+		*/
+		success = flashAddr <= mFlashSize &&
+					(itr->sramSize == 0 ||
+						(itr->sramStart >= mSRAMStart &&
+						(itr->sramStart + itr->sramSize) <= (mSRAMStart + mSRAMSize))) &&
+					itr->elfFile->GetFlashImage(image, imageAddr) &&
+					RelocateSketch(*itr, image);
+		if (success)
+		{
+			outImage.Write(itr->flashOffset, image.data(), (uint32_t)image.size());
+		}
+	}
+	return(success &&
+		WriteVectorTable(inPersonality, outImage));
+}
+
+/****************************** WriteVectorTable ******************************/
+/*
+*	The personality's relocated vector table is copied to address 0.
+*/
+bool SketchLinker::WriteVectorTable(
+	uint32_t	inPersonality,
+	FlashImage&	ioImage) const
+{
+	bool	success = inPersonality < mSketches.size();
+	if (success)
+	{
+		std::vector<uint8_t>	vectorTable(mNumVectors * 4);
+		success = ioImage.Read(mSketches[inPersonality].flashOffset, vectorTable.data(), (uint32_t)vectorTable.size());
+		if (success)
+		{
+			ioImage.Write(0, vectorTable.data(), (uint32_t)vectorTable.size());
+		}
+	}
+	return(success);
+}
+
+/******************************* RelocateSketch *******************************/
+/*
+*	Returns false if the sketch has flash pointers that can't be relocated
+*	or a startup routine's constants weren't found.
+*/
+bool SketchLinker::RelocateSketch(
+	SLinkedSketch&			ioSketch,
+	std::vector<uint8_t>&	ioImage) const
+{
+	const AVRElfFile*	elfFile = ioSketch.elfFile;
+	uint32_t	textSize = elfFile->GetSectEntry(eText)->size;
+	uint32_t	flashOffset = ioSketch.flashOffset;
+	uint32_t	numSymbols = 0;
+	const SSymbolTblEntry*	symbols = elfFile->GetSymbolTable(numSymbols);
+	if (textSize > ioImage.size() ||
+		(flashOffset & 1) ||
+		numSymbols == 0)
+	{
+		return(false);
+	}
+	uint16_t*	words = (uint16_t*)ioImage.data();
+	/*
+	*	The constructor and destructor tables are word addresses.
+	*/
+	static const char* const	kTableSymbols[] = {"__ctors_start", "__ctors_end", "__dtors_start", "__dtors_end"};
+	const SSymbolTblEntry*	tableSymbols[4];
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		tableSymbols[i] = elfFile->FindSymbol(kTableSymbols[i]);
+	}
+	for (uint32_t i = 0; i < 4; i += 2)
+	{
+		if (tableSymbols[i] && tableSymbols[i+1] &&
+			tableSymbols[i+1]->value <= textSize)
+		{
+			for (uint32_t wordIndex = tableSymbols[i]->value/2; wordIndex < tableSymbols[i+1]->value/2; wordIndex++)
+			{
+				words[wordIndex] += flashOffset/2;
+				ioSketch.numTablePatched++;
+			}
+		}
+	}
+	/*
+	*	The PROGMEM data, trampolines and tables between the vectors and
+	*	the code are skipped.  The code starts at the end of the last table.
+	*/
+	uint32_t	vectorsEnd = mNumVectors * 4;
+	uint32_t	codeStart = vectorsEnd;
+	for (uint32_t i = 1; i < 4; i += 2)
+	{
+		if (tableSymbols[i] &&
+			tableSymbols[i]->value > codeStart &&
+			tableSymbols[i]->value <= textSize)
+		{
+			codeStart = tableSymbols[i]->value;
+		}
+	}
+	SFlashPointerTargets	targets;
+	for (uint32_t i = 0; i < numSymbols; i++)
+	{
+		const SSymbolTblEntry&	symbol = symbols[i];
+		uint8_t	type = symbol.info & 0xF;
+		switch (elfFile->GetSectName(symbol.shndx))
+		{
+			case eText:
+				if (symbol.value >= vectorsEnd &&
+					symbol.value < textSize)
+				{
+					if (type == eSymFunc)
+					{
+						targets.functions.push_back(symbol.value/2);
+					} else if (type == eSymObject && symbol.size)
+					{
+						targets.objects.push_back(AddressRange(symbol.value, symbol.value + symbol.size));
+					}
+				}
+				break;
+			case eData:
+			case eBSS:
+			case eNoInit:
+				if (type == eSymObject)
+				{
+					targets.sramObjects.push_back(symbol.value & 0xFFFF);
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	std::sort(targets.functions.begin(), targets.functions.end());
+	std::sort(targets.objects.begin(), targets.objects.end());
+	std::sort(targets.sramObjects.begin(), targets.sramObjects.end());
+	/*
+	*	The startup routines' constants are relocated by
+	*	RelocateStartupRoutine, so their LDI pairs aren't checked.
+	*/
+	const uint32_t	kNumStartupRoutines = sizeof(kStartupRoutines)/sizeof(kStartupRoutines[0]);
+	AddressRange	startupRoutines[kNumStartupRoutines];
+	for (uint32_t i = 0; i < kNumStartupRoutines; i++)
+	{
+		const SSymbolTblEntry*	routineSymbol = elfFile->FindSymbol(kStartupRoutines[i]);
+		startupRoutines[i] = routineSymbol ?
+			AddressRange(routineSymbol->value, routineSymbol->value + (kMaxRoutineWords * 2)) : AddressRange(0, 0);
+	}
+	uint32_t	wordIndex = 0;
+	uint32_t	endWordIndex = textSize/2;
+	while (wordIndex < endWordIndex)
+	{
+		if (wordIndex >= vectorsEnd/2 &&
+			wordIndex < codeStart/2)
+		{
+			wordIndex = codeStart/2;
+			continue;
+		}
+		uint16_t	opcode = words[wordIndex];
+		switch (kOpcodeClassTable.opClass[SOpcodeClassTable::Key(opcode)])
+		{
+			case eOpLDS:
+			case eOpSTS:
+				wordIndex += 2;
+				break;
+			case eOpJMP:
+			case eOpCALL:
+				if ((wordIndex + 1) < endWordIndex)
+				{
+					uint32_t	target = ((((opcode >> 3) & 0x3E) | (opcode & 1)) << 17) | (words[wordIndex+1] << 1);
+					if (target < textSize)
+					{
+						uint32_t	instruction = AVRElfFile::JmpInstructionFor(target + flashOffset) | (opcode & 2);
+						words[wordIndex] = (uint16_t)instruction;
+						words[wordIndex+1] = (uint16_t)(instruction >> 16);
+						ioSketch.numJmpCallPatched++;
+					}
+				}
+				wordIndex += 2;
+				break;
+			case eOpLDI:
+			{
+				SXref	xref;
+				AVRXrefIndex::Decode(words, endWordIndex, wordIndex, xref);
+				if (xref.kind == eXrefLDIPair)
+				{
+					uint32_t	i = 0;
+					for (; i < kNumStartupRoutines &&
+						(xref.source < startupRoutines[i].first || xref.source >= startupRoutines[i].second); i++){}
+					if (i == kNumStartupRoutines &&
+						targets.Contains(xref.target))
+					{
+						NoteFlashPointer(ioSketch, xref.source);
+					}
+					wordIndex += 2;
+				} else
+				{
+					wordIndex++;
+				}
+				break;
+			}
+			default:
+				wordIndex++;
+				break;
+		}
+	}
+	bool	success = true;
+	for (uint32_t i = 0; i < kNumStartupRoutines; i++)
+	{
+		success = RelocateStartupRoutine(elfFile, kStartupRoutines[i], ioSketch, ioImage, ioSketch.numTablePatched) && success;
+	}
+	RelocateDataPointers(elfFile, targets, ioSketch, ioImage);
+	return(success &&
+		ioSketch.numFlashPointers == 0);
+}
+
+/*************************** RelocateStartupRoutine ***************************/
+/*
+*	The routine ends with the BRNE of its loop.  Returns false if a constant
+*	that isn't optional wasn't found.  Returns true if the sketch doesn't
+*	have the routine.
+*/
+bool SketchLinker::RelocateStartupRoutine(
+	const AVRElfFile*		inElfFile,
+	const char*				inRoutineName,
+	const SLinkedSketch&	inSketch,
+	std::vector<uint8_t>&	ioImage,
+	uint32_t&				ioNumPatched)
+{
+	const SSymbolTblEntry*	routineSymbol = inElfFile->FindSymbol(inRoutineName);
+	if (routineSymbol == NULL)
+	{
+		return(true);
+	}
+	if (routineSymbol->value >= ioImage.size())
+	{
+		return(false);
+	}
+	const uint32_t	kNumConstants = sizeof(kStartupConstants)/sizeof(SStartupConstant);
+	bool	found[kNumConstants] = {false};
+	uint32_t	numWords = std::min(kMaxRoutineWords, (uint32_t)(ioImage.size() - routineSymbol->value)/2);
+	uint16_t*	words = (uint16_t*)&ioImage[routineSymbol->value];
+	for (uint32_t wordIndex = 0; wordIndex < numWords; wordIndex++)
+	{
+		uint16_t	opcode = words[wordIndex];
+		if ((opcode & 0xFC07) == 0xF401)	// BRNE
+		{
+			break;
+		}
+		uint8_t	opClass = kOpcodeClassTable.opClass[SOpcodeClassTable::Key(opcode)];
+		if (opClass == eOpLDS ||
+			opClass == eOpSTS ||
+			opClass == eOpJMP ||
+			opClass == eOpCALL)
+		{
+			wordIndex++;	// Skip the 32 bit instruction's operand
+			continue;
+		}
+		if (opClass != eOpLDI &&
+			opClass != eOpCPI)
+		{
+			continue;
+		}
+		uint8_t	reg = 16 + ((opcode >> 4) & 0xF);
+		uint8_t	immediate = ((opcode >> 4) & 0xF0) | (opcode & 0xF);
+		for (uint32_t i = 0; i < kNumConstants; i++)
+		{
+			const SStartupConstant&	constant = kStartupConstants[i];
+			if (constant.opClass != opClass ||
+				constant.reg != reg ||
+				strcmp(constant.routine, inRoutineName) != 0)
+			{
+				continue;
+			}
+			const SSymbolTblEntry*	symbol = inElfFile->FindSymbol(constant.symbol);
+			if (symbol &&
+				!found[i] &&
+				immediate == (uint8_t)(symbol->value >> constant.shift))
+			{
+				uint8_t	newImmediate = (uint8_t)((symbol->value + inSketch.flashOffset) >> constant.shift);
+				words[wordIndex] = (opcode & 0xF0F0) | ((newImmediate & 0xF0) << 4) | (newImmediate & 0xF);
+				found[i] = true;
+				ioNumPatched++;
+			}
+			break;
+		}
+	}
+	for (uint32_t i = 0; i < kNumConstants; i++)
+	{
+		const SStartupConstant&	constant = kStartupConstants[i];
+		if (!found[i] &&
+			!constant.optional &&
+			strcmp(constant.routine, inRoutineName) == 0 &&
+			inElfFile->FindSymbol(constant.symbol))
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+/**************************** RelocateDataPointers ****************************/
+/*
+*	Relocates the function pointers of the C++ vtables (_ZTV symbols) in
+*	the .data initial values, then checks the rest of the initial values,
+*	at every byte offset, for flash pointers.
+*/
+void SketchLinker::RelocateDataPointers(
+	const AVRElfFile*			inElfFile,
+	const SFlashPointerTargets&	inTargets,
+	SLinkedSketch&				ioSketch,
+	std::vector<uint8_t>&		ioImage)
+{
+	const SSectEntry*	dataSectEntry = inElfFile->GetSectEntry(eData);
+	const SSymbolTblEntry*	dataLoadStart = inElfFile->FindSymbol("__data_load_start");
+	if (dataSectEntry == NULL ||
+		dataSectEntry->size == 0)
+	{
+		return;
+	}
+	uint32_t	dataStart = dataSectEntry->addrInMem & 0xFFFF;
+	uint32_t	dataSize = dataSectEntry->size;
+	if (dataLoadStart == NULL ||
+		(dataLoadStart->value + dataSize) > ioImage.size())
+	{
+		NoteFlashPointer(ioSketch, 0);	// The initial values can't be checked
+		return;
+	}
+	uint8_t*	data = &ioImage[dataLoadStart->value];
+	std::vector<bool>	isVTable(dataSize, false);
+	uint32_t	numSymbols = 0;
+	const SSymbolTblEntry*	symbols = inElfFile->GetSymbolTable(numSymbols);
+	const char*	stringTable = inElfFile->GetStringTable();
+	for (uint32_t i = 0; i < numSymbols; i++)
+	{
+		const SSymbolTblEntry&	symbol = symbols[i];
+		uint32_t	offset = (symbol.value & 0xFFFF) - dataStart;
+		if (inElfFile->GetSectName(symbol.shndx) != eData ||
+			(symbol.info & 0xF) != eSymObject ||
+			strncmp(&stringTable[symbol.name], "_ZTV", 4) != 0 ||
+			offset >= dataSize ||
+			symbol.size > (dataSize - offset))
+		{
+			continue;
+		}
+		for (uint32_t j = 0; (j + 1) < symbol.size; j += 2)
+		{
+			uint32_t	value = data[offset + j] | (data[offset + j + 1] << 8);
+			if (std::binary_search(inTargets.functions.begin(), inTargets.functions.end(), value))
+			{
+				value += ioSketch.flashOffset/2;
+				if (value > 0xFFFF)
+				{
+					NoteFlashPointer(ioSketch, dataLoadStart->value + offset + j);
+				}
+				data[offset + j] = (uint8_t)value;
+				data[offset + j + 1] = (uint8_t)(value >> 8);
+				ioSketch.numTablePatched++;
+			}
+		}
+		std::fill(isVTable.begin() + offset, isVTable.begin() + offset + symbol.size, true);
+	}
+	for (uint32_t offset = 0; (offset + 1) < dataSize; offset++)
+	{
+		if (!isVTable[offset] &&
+			!isVTable[offset + 1] &&
+			inTargets.Contains(data[offset] | (data[offset + 1] << 8)))
+		{
+			NoteFlashPointer(ioSketch, dataLoadStart->value + offset);
+		}
+	}
+}
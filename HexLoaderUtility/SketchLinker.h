@@ -0,0 +1,141 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  SketchLinker.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+/*
+*	Links several sketches for the same device into one flash image.
+*
+*	Each sketch's flash image is placed at its own aligned flash offset.
+*	Only one sketch (the personality) runs at a time, so every sketch keeps
+*	its own SRAM layout and the sketches share SRAM.  SRAM addresses,
+*	whether LDS/STS operands, LDI pairs or pointers in .data, are never
+*	relocated.
+*
+*	A single pass over each sketch's code, driven by an opcode class table,
+*	relocates JMP/CALL targets within the sketch (including its vector
+*	table.)  RJMP/RCALL are relative so they don't need relocation.  The
+*	constructor/destructor tables, the C++ vtables in .data, and the flash
+*	address constants loaded by the startup routines (__do_copy_data,
+*	__do_global_ctors and __do_global_dtors) are relocated using the
+*	symbol table.
+*
+*	Other flash pointers can't be told apart from integer constants, so
+*	they aren't relocated.  Instead Link fails if a sketch has an LDI pair
+*	or a .data word whose value is the word address of one of its functions
+*	(a function pointer) or an address within one of its PROGMEM objects,
+*	e.g. a string loaded by the F() macro.  A constant that happens to have
+*	such a value also fails the link.  Pointers stored in PROGMEM data are
+*	not checked.
+*
+*	The vector table at address 0 is synthesized to dispatch to one of the
+*	sketches (the personality.)  Sketches are placed at multiples of the
+*	alignment, so switching personalities only requires reprogramming the
+*	page(s) containing the vector table (see WriteVectorTable.)
+*/
+#ifndef SketchLinker_h
+#define SketchLinker_h
+
+#include <vector>
+#include <stdint.h>
+
+class AVRElfFile;
+class FlashImage;
+struct SFlashPointerTargets;
+
+struct SLinkedSketch
+{
+	const AVRElfFile*	elfFile;
+	uint32_t	flashOffset;		// Flash address of the sketch's reset vector
+	uint32_t	flashSize;			// .text + .data initial values
+	uint16_t	sramStart;			// .data/.bss start
+	uint16_t	sramSize;			// .data + .bss
+	uint32_t	numJmpCallPatched;
+	uint32_t	numTablePatched;	// ctor/dtor table and vtable entries, startup constants
+	uint32_t	numFlashPointers;	// Flash pointers that can't be relocated
+	uint32_t	firstFlashPointer;	// Unlinked flash address of the first (LDI pair or .data initial value)
+};
+
+class SketchLinker
+{
+public:
+							SketchLinker(
+								uint32_t				inFlashSize,
+								uint32_t				inSRAMStart,
+								uint32_t				inSRAMSize,
+								uint32_t				inFlashAlignment = 256);
+							~SketchLinker(void){}
+	/*
+	*	inElfFile must remain valid until Link is called.  All sketches
+	*	must be built for the same device (same number of vectors.)
+	*/
+	bool					AddSketch(
+								const AVRElfFile*		inElfFile);
+	/*
+	*	Returns false if the sketches don't fit in flash or SRAM, or a sketch
+	*	can't be relocated (see numFlashPointers.)  outImage is cleared before
+	*	linking.
+	*/
+	bool					Link(
+								uint32_t				inPersonality,
+								FlashImage&				outImage);
+	/*
+	*	Writes the vector table that dispatches to inPersonality.  ioImage
+	*	must be a linked image.
+	*/
+	bool					WriteVectorTable(
+								uint32_t				inPersonality,
+								FlashImage&				ioImage) const;
+	const std::vector<SLinkedSketch>& GetSketches(void) const
+								{return(mSketches);}
+	uint32_t				GetNumVectors(void) const
+								{return(mNumVectors);}
+protected:
+	uint32_t	mFlashSize;
+	uint32_t	mSRAMStart;
+	uint32_t	mSRAMSize;
+	uint32_t	mFlashAlignment;
+	uint32_t	mNumVectors;
+	std::vector<SLinkedSketch>	mSketches;
+
+	static uint32_t			CountVectors(
+								const uint8_t*			inText,
+								uint32_t				inTextSize);
+	bool					RelocateSketch(
+								SLinkedSketch&			ioSketch,
+								std::vector<uint8_t>&	ioImage) const;
+	static bool				RelocateStartupRoutine(
+								const AVRElfFile*		inElfFile,
+								const char*				inRoutineName,
+								const SLinkedSketch&	inSketch,
+								std::vector<uint8_t>&	ioImage,
+								uint32_t&				ioNumPatched);
+	static void				RelocateDataPointers(
+								const AVRElfFile*		inElfFile,
+								const SFlashPointerTargets&	inTargets,
+								SLinkedSketch&			ioSketch,
+								std::vector<uint8_t>&	ioImage);
+};
+
+#endif /* SketchLinker_h */
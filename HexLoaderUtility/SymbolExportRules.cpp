@@ -0,0 +1,181 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  SymbolExportRules.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+
+#include "SymbolExportRules.h"
+#include "AVRElfFile.h"
+#include "FileInputBuffer.h"
+#include <ctype.h>
+#include <fnmatch.h>
+
+/***************************** SymbolExportRules ******************************/
+SymbolExportRules::SymbolExportRules(void)
+{
+	SetDefaultRules();
+}
+
+/****************************** SetDefaultRules *******************************/
+/*
+*	The DCSensor.ino has a uint32_t unix timestamp, kTimestamp, created from
+*	the gcc time and date macros.  Its CAN ID is initially created from the
+*	timestamp, so it needs to be unique per board, else the bus may go into
+*	an error state.  Because the Hex Loader copies the same executable to
+*	every board, the loader replaces the timestamp's initial value with the
+*	current time while loading.  kTimestamp is volatile so that it's copied
+*	from flash to SRAM by the startup code rather than being hard coded
+*	wherever it's used.
+*/
+void SymbolExportRules::SetDefaultRules(void)
+{
+	mRules.clear();
+	AddRule("DCSensor.ino", "kTimestamp", "timestamp", false);
+}
+
+/********************************** AddRule ***********************************/
+void SymbolExportRules::AddRule(
+	const std::string&	inSketchPattern,
+	const std::string&	inSymbolName,
+	const std::string&	inConfigKey,
+	bool				inExportSize)
+{
+	SSymbolExportRule	rule;
+	rule.sketchPattern = inSketchPattern;
+	rule.symbolName = inSymbolName;
+	rule.configKey = inConfigKey.empty() ? inSymbolName : inConfigKey;
+	rule.exportSize = inExportSize;
+	mRules.push_back(rule);
+}
+
+/********************************** ReadFile **********************************/
+bool SymbolExportRules::ReadFile(
+	const char*	inPath,
+	uint32_t&	outBadLines)
+{
+	outBadLines = 0;
+	FileInputBuffer	inputBuffer(inPath);
+	bool	success = inputBuffer.IsValid();
+	if (success)
+	{
+		std::string	text;
+		inputBuffer.AppendBuffer(text);
+		mRules.clear();
+		size_t	lineStart = 0;
+		while (lineStart < text.size())
+		{
+			size_t	lineEnd = text.find('\n', lineStart);
+			if (lineEnd == std::string::npos)
+			{
+				lineEnd = text.size();
+			}
+			size_t	commentStart = text.find('#', lineStart);
+			size_t	end = commentStart < lineEnd ? commentStart : lineEnd;
+			/*
+			*	Split the line into whitespace delimited fields.
+			*/
+			std::string	fields[4];
+			uint32_t	numFields = 0;
+			for (size_t i = lineStart; i < end;)
+			{
+				if (isspace((uint8_t)text[i]))
+				{
+					i++;
+					continue;
+				}
+				size_t	fieldStart = i;
+				for (; i < end && !isspace((uint8_t)text[i]); i++){}
+				if (numFields < 4)
+				{
+					fields[numFields].assign(text, fieldStart, i - fieldStart);
+				}
+				numFields++;
+			}
+			if (numFields == 2 ||
+				numFields == 3)
+			{
+				AddRule(fields[0], fields[1], fields[2]);
+			} else if (numFields)
+			{
+				outBadLines++;
+			}
+			lineStart = lineEnd + 1;
+		}
+	}
+	return(success);
+}
+
+/******************************* RulesForSketch *******************************/
+void SymbolExportRules::RulesForSketch(
+	const char*				inSketchName,
+	SymbolExportRulePtrs&	outRules) const
+{
+	SymbolExportRuleVec::const_iterator	itr = mRules.begin();
+	SymbolExportRuleVec::const_iterator	itrEnd = mRules.end();
+	for (; itr != itrEnd; ++itr)
+	{
+		if (fnmatch(itr->sketchPattern.c_str(), inSketchName, 0) == 0)
+		{
+			outRules.push_back(&(*itr));
+		}
+	}
+}
+
+/********************************** Resolve ***********************************/
+/*
+*	Each symbol is found using the elf file's symbol hash, so resolving
+*	doesn't rescan the symbol table per rule.  Symbols without a flash
+*	address (.bss, .noinit) can't be patched so they're unresolved.
+*/
+uint32_t SymbolExportRules::Resolve(
+	const char*				inSketchName,
+	const AVRElfFile&		inElfFile,
+	SymbolExports&			outExports,
+	SymbolExportRulePtrs&	outUnresolved) const
+{
+	SymbolExportRulePtrs	rules;
+	RulesForSketch(inSketchName, rules);
+	SymbolExportRulePtrs::const_iterator	itr = rules.begin();
+	SymbolExportRulePtrs::const_iterator	itrEnd = rules.end();
+	for (; itr != itrEnd; ++itr)
+	{
+		const SSymbolTblEntry*	symTableEntry = inElfFile.FindSymbol((*itr)->symbolName.c_str());
+		uint32_t	loadAddress = 0;
+		if (symTableEntry &&
+			symTableEntry->shndx != eShndxUndef &&
+			symTableEntry->shndx < eShndxLoReserve &&
+			AVRElfFile::AddressSpaceFor(loadAddress = inElfFile.GetLoadAddress(symTableEntry)) == eFlashSpace)
+		{
+			SSymbolExport	symbolExport;
+			symbolExport.rule = *itr;
+			symbolExport.loadAddress = loadAddress;
+			symbolExport.size = symTableEntry->size;
+			outExports.push_back(symbolExport);
+		} else
+		{
+			outUnresolved.push_back(*itr);
+		}
+	}
+	return((uint32_t)rules.size());
+}
@@ -0,0 +1,129 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  SymbolExportRules.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+/*
+*	Symbol export rules name the symbols whose flash (load) address and
+*	size are added to a sketch's exported config so that the loader can
+*	patch them while loading (e.g. a per-board timestamp or serial number.)
+*
+*	The rules file has one rule per line:
+*		<sketch glob> <symbol> [<config key>]
+*	The glob is matched against the sketch name (e.g. DCSensor.ino) using
+*	fnmatch.  The config key defaults to the symbol name.  The load address
+*	is exported as <config key> and the size as <config key>_size.  Text
+*	following a # is a comment.
+*
+*	The default rule doesn't export the size so that the config of a sketch
+*	without a rules file is unchanged from earlier versions.
+*
+*	For .data symbols the load address is the address of the initial value
+*	within the flash image (see AVRElfFile::GetLoadAddress.)
+*/
+#ifndef SymbolExportRules_h
+#define SymbolExportRules_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class AVRElfFile;
+
+struct SSymbolExportRule
+{
+	std::string	sketchPattern;
+	std::string	symbolName;
+	std::string	configKey;
+	bool		exportSize;	// Export <config key>_size
+};
+
+typedef std::vector<SSymbolExportRule> SymbolExportRuleVec;
+typedef std::vector<const SSymbolExportRule*> SymbolExportRulePtrs;
+
+struct SSymbolExport
+{
+	const SSymbolExportRule*	rule;
+	uint32_t	loadAddress;
+	uint32_t	size;
+};
+
+typedef std::vector<SSymbolExport> SymbolExports;
+
+class SymbolExportRules
+{
+public:
+	/*
+	*	Starts with the default rules.
+	*/
+							SymbolExportRules(void);
+							~SymbolExportRules(void){}
+	/*
+	*	Replaces the rules with those of the file.  Returns false if the file
+	*	can't be read or is empty, leaving the rules unchanged.  outBadLines is set to
+	*	the number of lines that aren't rules.
+	*/
+	bool					ReadFile(
+								const char*				inPath,
+								uint32_t&				outBadLines);
+	/*
+	*	The DCSensor.ino kTimestamp rule, used when there's no rules file.
+	*	It doesn't export the size.
+	*/
+	void					SetDefaultRules(void);
+	void					AddRule(
+								const std::string&		inSketchPattern,
+								const std::string&		inSymbolName,
+								const std::string&		inConfigKey = std::string(),
+								bool					inExportSize = true);
+	const SymbolExportRuleVec& GetRules(void) const
+								{return(mRules);}
+	/*
+	*	Returns the rules that apply to inSketchName, in file order.
+	*/
+	void					RulesForSketch(
+								const char*				inSketchName,
+								SymbolExportRulePtrs&	outRules) const;
+	/*
+	*	Resolves the rules that apply to inSketchName against the symbol
+	*	table of inElfFile, appending to outExports.  The rules of symbols
+	*	that aren't defined or aren't in flash are appended to outUnresolved.  Returns the
+	*	number of rules that apply.
+	*/
+	uint32_t				Resolve(
+								const char*				inSketchName,
+								const AVRElfFile&		inElfFile,
+								SymbolExports&			outExports,
+								SymbolExportRulePtrs&	outUnresolved) const;
+	/*
+	*	The config key of the export's size.
+	*/
+	static std::string		SizeKey(
+								const SSymbolExportRule& inRule)
+								{return(inRule.configKey + "_size");}
+protected:
+	SymbolExportRuleVec		mRules;
+};
+
+#endif /* SymbolExportRules_h */
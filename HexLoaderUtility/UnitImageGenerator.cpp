@@ -0,0 +1,289 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  UnitImageGenerator.cpp
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+#include "UnitImageGenerator.h"
+#include "AVRElfFile.h"
+#include "IntelHexFile.h"
+#include <thread>
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+
+/***************************** UnitImageGenerator *****************************/
+UnitImageGenerator::UnitImageGenerator(void)
+	: mFlashImageAddr(0)
+{
+}
+
+/********************************* Initialize *********************************/
+bool UnitImageGenerator::Initialize(
+	const AVRElfFile&	inElfFile)
+{
+	mBaseHexText.clear();
+	mRecords.clear();
+	mPatchedRecords.clear();
+	mPatches.clear();
+	bool	success = inElfFile.GetFlashImage(mFlashImage, mFlashImageAddr);
+	if (success)
+	{
+		IntelHexFile::Encode(mFlashImage.data(), (uint32_t)mFlashImage.size(), mFlashImageAddr, mBaseHexText);
+		IntelHexFile::AppendEOFRecord(mBaseHexText);
+		/*
+		*	Index the data records so the records overlapping a patch can be
+		*	found.  The text was just encoded so it's known to be valid.
+		*/
+		const char*	hexText = mBaseHexText.data();
+		const char*	hexTextEnd = &hexText[mBaseHexText.size()];
+		uint32_t	upperAddress = 0;
+		while (hexText < hexTextEnd &&
+			*hexText == ':')
+		{
+			uint8_t	header[4];	// length, address (2), type
+			bool	valid;
+			IntelHexFile::HexToBytes(&hexText[1], 4, header, valid);
+			if (header[3] == IntelHexFile::eDataRecord)
+			{
+				SRecordRef	record;
+				record.address = upperAddress + (((uint32_t)header[1] << 8) | header[2]);
+				record.textOffset = (uint32_t)(hexText - mBaseHexText.data());
+				record.length = header[0];
+				mRecords.push_back(record);
+			} else if (header[3] == IntelHexFile::eExtLinearAddrRecord)
+			{
+				uint8_t	upper[2];
+				IntelHexFile::HexToBytes(&hexText[9], 2, upper, valid);
+				upperAddress = (((uint32_t)upper[0] << 8) | upper[1]) << 16;
+			}
+			hexText += 13 + (header[0] * 2);
+		}
+	}
+	return(success);
+}
+
+/********************************* AddSymbol **********************************/
+bool UnitImageGenerator::AddSymbol(
+	const AVRElfFile&		inElfFile,
+	const char*				inSymbolName,
+	const ValueGenerator&	inGenerator)
+{
+	const SSymbolTblEntry*	symTblEntry = inElfFile.FindSymbol(inSymbolName);
+	return(symTblEntry &&
+		AddPatch(inElfFile.GetLoadAddress(symTblEntry), symTblEntry->size, inGenerator));
+}
+
+/********************************** AddPatch **********************************/
+bool UnitImageGenerator::AddPatch(
+	uint32_t				inAddress,
+	uint32_t				inSize,
+	const ValueGenerator&	inGenerator)
+{
+	bool	success = inSize != 0 &&
+				inAddress >= mFlashImageAddr &&
+				(inAddress + inSize) <= (mFlashImageAddr + mFlashImage.size());
+	if (success)
+	{
+		SPatch	patch;
+		patch.address = inAddress;
+		patch.size = inSize;
+		patch.generator = inGenerator;
+		mPatches.push_back(patch);
+		/*
+		*	Find the first record containing the patch, then add all of the
+		*	records up to the end of the patch.
+		*/
+		size_t	recordIndex = std::upper_bound(mRecords.begin(), mRecords.end(), inAddress,
+			[](uint32_t inPatchAddress, const SRecordRef& inRecord){return(inPatchAddress < inRecord.address);}) - mRecords.begin();
+		if (recordIndex)
+		{
+			recordIndex--;
+		}
+		for (; recordIndex < mRecords.size() &&
+				mRecords[recordIndex].address < (inAddress + inSize); recordIndex++)
+		{
+			mPatchedRecords.push_back((uint32_t)recordIndex);
+		}
+		std::sort(mPatchedRecords.begin(), mPatchedRecords.end());
+		mPatchedRecords.erase(std::unique(mPatchedRecords.begin(), mPatchedRecords.end()), mPatchedRecords.end());
+	}
+	return(success);
+}
+
+/******************************* GenerateUnits ********************************/
+/*
+*	Generates every inUnitStride unit from inFirstUnit up to inEndUnit.
+*/
+void UnitImageGenerator::GenerateUnits(
+	uint32_t				inFirstUnit,
+	uint32_t				inEndUnit,
+	uint32_t				inUnitStride,
+	const UnitImageWriter&	inWriter,
+	std::atomic<bool>&		ioStop) const
+{
+	// Copy on write: the only copies made are for this thread.
+	std::string	hexText(mBaseHexText);
+	std::vector<uint8_t>	flashImage(mFlashImage);
+	for (uint32_t unit = inFirstUnit; unit < inEndUnit && !ioStop; unit += inUnitStride)
+	{
+		std::vector<SPatch>::const_iterator	itr = mPatches.begin();
+		std::vector<SPatch>::const_iterator	itrEnd = mPatches.end();
+		for (; itr != itrEnd; ++itr)
+		{
+			itr->generator(unit, &flashImage[itr->address - mFlashImageAddr], itr->size);
+		}
+		std::vector<uint32_t>::const_iterator	rItr = mPatchedRecords.begin();
+		std::vector<uint32_t>::const_iterator	rItrEnd = mPatchedRecords.end();
+		for (; rItr != rItrEnd; ++rItr)
+		{
+			const SRecordRef&	record = mRecords[*rItr];
+			IntelHexFile::AppendRecord(IntelHexFile::eDataRecord, (uint16_t)record.address,
+				&flashImage[record.address - mFlashImageAddr], record.length, &hexText[record.textOffset]);
+		}
+		if (!inWriter(unit, hexText))
+		{
+			ioStop = true;
+		}
+	}
+}
+
+/********************************** Generate **********************************/
+bool UnitImageGenerator::Generate(
+	uint32_t				inFirstUnit,
+	uint32_t				inNumUnits,
+	const UnitImageWriter&	inWriter,
+	uint32_t				inNumThreads) const
+{
+	std::atomic<bool>	stop(false);
+	if (inNumThreads == 0)
+	{
+		inNumThreads = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+	if (inNumThreads > inNumUnits)
+	{
+		inNumThreads = inNumUnits;
+	}
+	uint32_t	endUnit = inFirstUnit + inNumUnits;
+	if (inNumThreads <= 1)
+	{
+		GenerateUnits(inFirstUnit, endUnit, 1, inWriter, stop);
+	} else
+	{
+		std::vector<std::thread>	threads;
+		for (uint32_t i = 0; i < inNumThreads; i++)
+		{
+			threads.push_back(std::thread(&UnitImageGenerator::GenerateUnits, this,
+				inFirstUnit + i, endUnit, inNumThreads, std::cref(inWriter), std::ref(stop)));
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+	return(!stop);
+}
+
+/******************************* GenerateFiles ********************************/
+bool UnitImageGenerator::GenerateFiles(
+	const char*	inFolderPath,
+	const char*	inBaseName,
+	uint32_t	inFirstUnit,
+	uint32_t	inNumUnits,
+	uint32_t	inNumThreads) const
+{
+	std::string	pathPrefix(inFolderPath);
+	if (!pathPrefix.empty() &&
+		pathPrefix.back() != '/')
+	{
+		pathPrefix += '/';
+	}
+	pathPrefix.append(inBaseName);
+	return(Generate(inFirstUnit, inNumUnits,
+		[&pathPrefix](uint32_t inUnit, const std::string& inHexText)
+		{
+			char	unitStr[20];
+			snprintf(unitStr, sizeof(unitStr), "-%u.hex", inUnit);
+			return(IntelHexFile::WriteFile((pathPrefix + unitStr).c_str(), inHexText));
+		}, inNumThreads));
+}
+
+/****************************** SerialGenerator *******************************/
+ValueGenerator UnitImageGenerator::SerialGenerator(
+	uint64_t	inFirstSerial)
+{
+	return([inFirstSerial](uint32_t inUnit, uint8_t* outValue, uint32_t inSize)
+	{
+		uint64_t	value = inFirstSerial + inUnit;
+		for (uint32_t i = 0; i < inSize; i++, value >>= 8)
+		{
+			outValue[i] = (uint8_t)value;
+		}
+	});
+}
+
+/***************************** TimestampGenerator *****************************/
+ValueGenerator UnitImageGenerator::TimestampGenerator(
+	time_t	inTimestamp)
+{
+	return(SerialGenerator((uint64_t)inTimestamp));
+}
+
+/******************************* CANIDGenerator *******************************/
+ValueGenerator UnitImageGenerator::CANIDGenerator(
+	uint32_t	inFirstID,
+	bool		inExtended)
+{
+	uint32_t	idMask = inExtended ? 0x1FFFFFFF : 0x7FF;
+	return([inFirstID, idMask](uint32_t inUnit, uint8_t* outValue, uint32_t inSize)
+	{
+		uint32_t	value = (inFirstID + inUnit) & idMask;
+		for (uint32_t i = 0; i < inSize; i++, value >>= 8)
+		{
+			outValue[i] = (uint8_t)value;
+		}
+	});
+}
+
+/******************************* BlobGenerator ********************************/
+ValueGenerator UnitImageGenerator::BlobGenerator(
+	const std::vector<uint8_t>&	inBlobs,
+	uint32_t					inBlobSize,
+	uint32_t					inFirstUnit)
+{
+	return([inBlobs, inBlobSize, inFirstUnit](uint32_t inUnit, uint8_t* outValue, uint32_t inSize)
+	{
+		size_t	blobOffset = (size_t)(inUnit - inFirstUnit) * inBlobSize;
+		if (inUnit >= inFirstUnit &&
+			inBlobSize &&
+			(blobOffset + inBlobSize) <= inBlobs.size())
+		{
+			uint32_t	length = std::min(inSize, inBlobSize);
+			memcpy(outValue, &inBlobs[blobOffset], length);
+			memset(&outValue[length], 0xFF, inSize - length);
+		} else
+		{
+			memset(outValue, 0xFF, inSize);
+		}
+	});
+}
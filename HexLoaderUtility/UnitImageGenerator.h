@@ -0,0 +1,155 @@
+/*******************************************************************************
+	License
+	****************************************************************************
+	This program is free software; you can redistribute it
+	and/or modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation; either version 3 of the License, or
+	(at your option) any later version.
+ 
+	This program is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the
+	implied warranty of MERCHANTABILITY or FITNESS FOR A
+	PARTICULAR PURPOSE. See the GNU General Public
+	License for more details.
+ 
+	Licence can be viewed at
+	http://www.gnu.org/licenses/gpl-3.0.txt
+
+	Please maintain this license information along with authorship
+	and copyright notices in any redistribution of this code
+*******************************************************************************/
+//
+//  UnitImageGenerator.h
+//
+//  Copyright © 2026 Jon Mackey. All rights reserved.
+//
+/*
+*	Generates a unique Intel HEX image per unit from a single loaded elf
+*	file.  Each patch replaces the initial value of a symbol (or any flash
+*	range) with a value produced by a generator for the unit number, such as
+*	a serial number, timestamp, CAN ID or calibration blob.
+*
+*	The base image is encoded once.  Each worker thread makes one copy of
+*	the base text and flash image, then for each unit only the records
+*	overlapping a patch are re-encoded in place.  Because every record keeps
+*	its length, the rest of the text never changes.
+*/
+#ifndef UnitImageGenerator_h
+#define UnitImageGenerator_h
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <stdint.h>
+#include <time.h>
+
+class AVRElfFile;
+
+/*
+*	Writes inSize bytes for inUnit to outValue.  Generators are called
+*	concurrently from the worker threads so they must not modify shared
+*	state.
+*/
+typedef std::function<void(uint32_t inUnit, uint8_t* outValue, uint32_t inSize)> ValueGenerator;
+/*
+*	Receives the complete hex text for inUnit.  Called from the worker
+*	threads.  Return false to stop generating.
+*/
+typedef std::function<bool(uint32_t inUnit, const std::string& inHexText)> UnitImageWriter;
+
+class UnitImageGenerator
+{
+public:
+							UnitImageGenerator(void);
+							~UnitImageGenerator(void){}
+	/*
+	*	Encodes the flash image of inElfFile.  Any existing patches are removed.
+	*/
+	bool					Initialize(
+								const AVRElfFile&		inElfFile);
+	/*
+	*	Patches the flash address the symbol is loaded from.  The symbol must
+	*	have a size and be initialized from flash (i.e. not .bss.)
+	*/
+	bool					AddSymbol(
+								const AVRElfFile&		inElfFile,
+								const char*				inSymbolName,
+								const ValueGenerator&	inGenerator);
+	bool					AddPatch(
+								uint32_t				inAddress,
+								uint32_t				inSize,
+								const ValueGenerator&	inGenerator);
+	/*
+	*	Generates inNumUnits images starting with unit inFirstUnit.  When
+	*	inNumThreads is 0 the number of hardware threads is used.  Returns
+	*	false if any writer call returned false.
+	*/
+	bool					Generate(
+								uint32_t				inFirstUnit,
+								uint32_t				inNumUnits,
+								const UnitImageWriter&	inWriter,
+								uint32_t				inNumThreads = 0) const;
+	/*
+	*	Writes each image to <inFolderPath>/<inBaseName>-<unit>.hex
+	*/
+	bool					GenerateFiles(
+								const char*				inFolderPath,
+								const char*				inBaseName,
+								uint32_t				inFirstUnit,
+								uint32_t				inNumUnits,
+								uint32_t				inNumThreads = 0) const;
+	const std::string&		GetBaseHexText(void) const
+								{return(mBaseHexText);}
+	/*
+	*	Generators
+	*	All values are written little endian (the AVR byte order.)
+	*/
+	// inFirstSerial + unit
+	static ValueGenerator	SerialGenerator(
+								uint64_t				inFirstSerial);
+	// inTimestamp + unit, so each unit's timestamp is unique.
+	static ValueGenerator	TimestampGenerator(
+								time_t					inTimestamp);
+	// inFirstID + unit masked to a 29 bit extended or 11 bit standard CAN ID.
+	static ValueGenerator	CANIDGenerator(
+								uint32_t				inFirstID,
+								bool					inExtended = true);
+	/*
+	*	inBlobs is a table of inBlobSize blobs, the first belonging to unit
+	*	inFirstUnit.  Units without a blob are filled with 0xFF.
+	*/
+	static ValueGenerator	BlobGenerator(
+								const std::vector<uint8_t>&	inBlobs,
+								uint32_t				inBlobSize,
+								uint32_t				inFirstUnit);
+protected:
+	struct SRecordRef
+	{
+		uint32_t	address;
+		uint32_t	textOffset;
+		uint32_t	length;
+	};
+	struct SPatch
+	{
+		uint32_t		address;
+		uint32_t		size;
+		ValueGenerator	generator;
+	};
+	std::vector<uint8_t>	mFlashImage;
+	uint32_t				mFlashImageAddr;
+	std::string				mBaseHexText;
+	std::vector<SRecordRef>	mRecords;			// Data records, sorted by address
+	std::vector<uint32_t>	mPatchedRecords;	// Indexes into mRecords, sorted, unique
+	std::vector<SPatch>		mPatches;
+
+	void					GenerateUnits(
+								uint32_t				inFirstUnit,
+								uint32_t				inEndUnit,
+								uint32_t				inUnitStride,
+								const UnitImageWriter&	inWriter,
+								std::atomic<bool>&		ioStop) const;
+};
+
+#endif /* UnitImageGenerator_h */